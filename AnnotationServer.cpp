@@ -0,0 +1,734 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "AnnotationServer.h"
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/algorithm/string.hpp>
+#include <iostream>
+#include <sstream>
+
+namespace{
+	const size_t MAX_HEADER_SIZE = 16 * 1024;
+	const size_t MAX_BODY_SIZE = 64 * 1024 * 1024;
+	const int DEFAULT_LIMIT = 1000;
+
+	const char* StatusText(int status)
+	{
+		switch (status){
+		case 200: return "OK";
+		case 206: return "Partial Content";
+		case 400: return "Bad Request";
+		case 403: return "Forbidden";
+		case 404: return "Not Found";
+		case 405: return "Method Not Allowed";
+		case 413: return "Payload Too Large";
+		case 416: return "Range Not Satisfiable";
+		case 431: return "Request Header Fields Too Large";
+		case 503: return "Service Unavailable";
+		default: return "Internal Server Error";
+		}
+	}
+
+	//! JSONの文字列として書き出す
+	void WriteJsonString(std::ostream& os, const std::string& str)
+	{
+		os << '"';
+		for (size_t i = 0; i < str.size(); i++){
+			char c = str[i];
+			if (c == '"' || c == '\\')
+				os << '\\' << c;
+			else if ((unsigned char)c < 0x20)
+				os << ' ';
+			else
+				os << c;
+		}
+		os << '"';
+	}
+
+	//! マーカーをJSONの配列として書き出す
+	void WriteJsonRects(std::ostream& os, const std::vector<cv::Rect>& rects)
+	{
+		os << '[';
+		for (size_t i = 0; i < rects.size(); i++){
+			if (i > 0)
+				os << ',';
+			os << '[' << rects[i].x << ',' << rects[i].y << ',' << rects[i].width << ',' << rects[i].height << ']';
+		}
+		os << ']';
+	}
+
+	//! クエリの数値を取得
+	int QueryInt(const std::map<std::string, std::string>& query, const std::string& name, int default_value)
+	{
+		std::map<std::string, std::string>::const_iterator it = query.find(name);
+		if (it == query.end())
+			return default_value;
+		return atoi(it->second.c_str());
+	}
+
+	//! パスの画像IDの解析（10進数の数字のみ）
+	bool ParseIndex(const std::string& str, int& idx)
+	{
+		if (str.empty() || str.size() > 9)
+			return false;
+		for (size_t i = 0; i < str.size(); i++){
+			if (str[i] < '0' || str[i] > '9')
+				return false;
+		}
+		idx = atoi(str.c_str());
+		return true;
+	}
+
+	//! 拡張子に対応するContent-Type
+	std::string ContentType(const std::string& filename)
+	{
+		std::string ext = boost::filesystem::path(filename).extension().string();
+		boost::algorithm::to_lower(ext);
+		if (ext == ".jpg" || ext == ".jpeg")
+			return "image/jpeg";
+		else if (ext == ".png")
+			return "image/png";
+		else if (ext == ".bmp")
+			return "image/bmp";
+		return "application/octet-stream";
+	}
+
+	//! Rangeヘッダ（"bytes=first-last"の単一範囲）の解析
+	/*!
+	\return 範囲が正しいかどうか
+	*/
+	bool ParseRange(const std::string& range, size_t size, size_t& first, size_t& length)
+	{
+		if (range.compare(0, 6, "bytes=") != 0 || range.find(',') != std::string::npos)
+			return false;
+		size_t dash = range.find('-', 6);
+		if (dash == std::string::npos)
+			return false;
+		std::string first_str = range.substr(6, dash - 6);
+		std::string last_str = range.substr(dash + 1);
+		if (first_str.empty()){
+			// 末尾からの長さ
+			size_t suffix = strtoul(last_str.c_str(), NULL, 10);
+			if (suffix == 0 || size == 0)
+				return false;
+			suffix = std::min(suffix, size);
+			first = size - suffix;
+			length = suffix;
+			return true;
+		}
+		first = strtoul(first_str.c_str(), NULL, 10);
+		size_t last = last_str.empty() ? size - 1 : std::min((size_t)strtoul(last_str.c_str(), NULL, 10), size - 1);
+		if (first >= size || last < first)
+			return false;
+		length = last - first + 1;
+		return true;
+	}
+}
+
+
+//! 1つの接続（Keep-Aliveで複数のリクエストを順に処理する）
+class HttpConnection : public std::enable_shared_from_this<HttpConnection>
+{
+public:
+	HttpConnection(boost::asio::io_service& io_service, AnnotationServer& server)
+		: _socket(io_service), _buffer(MAX_HEADER_SIZE + MAX_BODY_SIZE), _server(server){}
+
+	boost::asio::ip::tcp::socket& socket(){
+		return _socket;
+	}
+
+	void Start(){
+		ReadHeader();
+	}
+
+private:
+	boost::asio::ip::tcp::socket _socket;
+	boost::asio::streambuf _buffer;
+	AnnotationServer& _server;
+	AnnotationServer::Request _request;
+	AnnotationServer::Response _response;
+	std::string _response_header;
+	bool _keep_alive;
+
+	void ReadHeader()
+	{
+		std::shared_ptr<HttpConnection> self = shared_from_this();
+		boost::asio::async_read_until(_socket, _buffer, "\r\n\r\n",
+			[self](const boost::system::error_code& ec, size_t header_size){
+				if (!ec)
+					self->ParseHeader(header_size);
+				else if (ec == boost::asio::error::not_found)
+					self->RejectHeader();	// ヘッダの終わりが見つからないままバッファが満杯になった
+			});
+	}
+
+	//! ヘッダが大きすぎるリクエストを拒否して切断
+	void RejectHeader()
+	{
+		_response = AnnotationServer::Response();
+		_response.status = 431;
+		_response.body = "{\"error\":431}";
+		_keep_alive = false;
+		WriteResponse();
+	}
+
+	void ParseHeader(size_t header_size)
+	{
+		if (header_size > MAX_HEADER_SIZE){
+			RejectHeader();
+			return;
+		}
+
+		std::string header(boost::asio::buffers_begin(_buffer.data()), boost::asio::buffers_begin(_buffer.data()) + header_size);
+		_buffer.consume(header_size);
+
+		_request = AnnotationServer::Request();
+		std::istringstream iss(header);
+		std::string line, target, version;
+		std::getline(iss, line);
+		std::istringstream request_line(line);
+		request_line >> _request.method >> target >> version;
+		while (std::getline(iss, line) && line != "\r"){
+			size_t colon = line.find(':');
+			if (colon == std::string::npos)
+				continue;
+			std::string name = line.substr(0, colon);
+			boost::algorithm::to_lower(name);
+			_request.headers[name] = boost::algorithm::trim_copy(line.substr(colon + 1));
+		}
+
+		// パスとクエリを分離
+		size_t question = target.find('?');
+		_request.path = target.substr(0, question);
+		if (question != std::string::npos){
+			std::vector<std::string> params;
+			boost::algorithm::split(params, target.substr(question + 1), boost::is_any_of("&"));
+			for (size_t i = 0; i < params.size(); i++){
+				size_t equal = params[i].find('=');
+				if (equal != std::string::npos)
+					_request.query[params[i].substr(0, equal)] = params[i].substr(equal + 1);
+			}
+		}
+
+		std::string connection = _request.headers["connection"];
+		boost::algorithm::to_lower(connection);
+		_keep_alive = (version == "HTTP/1.1") ? (connection != "close") : (connection == "keep-alive");
+
+		size_t content_length = strtoul(_request.headers["content-length"].c_str(), NULL, 10);
+		if (content_length > MAX_BODY_SIZE){
+			_response = AnnotationServer::Response();
+			_response.status = 413;
+			_keep_alive = false;
+			WriteResponse();
+			return;
+		}
+
+		// 本文の残りを読む
+		size_t buffered = std::min(_buffer.size(), content_length);
+		std::shared_ptr<HttpConnection> self = shared_from_this();
+		boost::asio::async_read(_socket, _buffer, boost::asio::transfer_exactly(content_length - buffered),
+			[self, content_length](const boost::system::error_code& ec, size_t){
+				if (ec)
+					return;
+				std::string& body = self->_request.body;
+				body.assign(boost::asio::buffers_begin(self->_buffer.data()),
+					boost::asio::buffers_begin(self->_buffer.data()) + content_length);
+				self->_buffer.consume(content_length);
+				self->_response = AnnotationServer::Response();
+				self->_server.HandleRequest(self->_request, self->_response);
+				self->WriteResponse();
+			});
+	}
+
+	void WriteResponse()
+	{
+		const AnnotationServer::Response& res = _response;
+		size_t content_length = res.file ? res.file_size : res.body.size();
+		std::ostringstream oss;
+		oss << "HTTP/1.1 " << res.status << " " << StatusText(res.status) << "\r\n";
+		oss << "Content-Type: " << res.content_type << "\r\n";
+		oss << "Content-Length: " << content_length << "\r\n";
+		for (size_t i = 0; i < res.headers.size(); i++)
+			oss << res.headers[i] << "\r\n";
+		oss << "Connection: " << (_keep_alive ? "keep-alive" : "close") << "\r\n\r\n";
+		_response_header = oss.str();
+
+		// ファイルはマッピングから直接送る
+		std::vector<boost::asio::const_buffer> buffers;
+		buffers.push_back(boost::asio::buffer(_response_header));
+		if (res.file)
+			buffers.push_back(boost::asio::buffer(res.file_data, res.file_size));
+		else
+			buffers.push_back(boost::asio::buffer(res.body));
+
+		std::shared_ptr<HttpConnection> self = shared_from_this();
+		boost::asio::async_write(_socket, buffers,
+			[self](const boost::system::error_code& ec, size_t){
+				self->_response = AnnotationServer::Response();
+				if (!ec && self->_keep_alive){
+					self->ReadHeader();
+				}
+				else{
+					boost::system::error_code ignored;
+					self->_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+				}
+			});
+	}
+};
+
+
+AnnotationServer::AnnotationServer()
+{
+	_port = 0;
+	_num_threads = 4;
+	_has_dataset = false;
+}
+
+
+AnnotationServer::~AnnotationServer()
+{
+	Stop();
+}
+
+
+bool AnnotationServer::Start()
+{
+	Stop();
+	if (_port <= 0)
+		return false;
+
+	// 外部からは接続できないようにlocalhostのみで待ち受ける
+	boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), _port);
+	try{
+		_acceptor.reset(new boost::asio::ip::tcp::acceptor(_io_service, endpoint));
+	}
+	catch (const boost::system::system_error& e){
+		std::cerr << "Fail to listen on port " << _port << ": " << e.what() << std::endl;
+		_acceptor.reset();
+		return false;
+	}
+
+	_io_service.reset();
+	_work.reset(new boost::asio::io_service::work(_io_service));
+	Accept();
+
+	int num_threads = std::max(1, _num_threads);
+	for (int i = 0; i < num_threads; i++)
+		_threads.push_back(std::thread([this]{ _io_service.run(); }));
+	return true;
+}
+
+
+void AnnotationServer::Stop()
+{
+	if (_threads.empty())
+		return;
+
+	_work.reset();
+	_io_service.stop();
+	for (int i = 0; i < _threads.size(); i++)
+		_threads[i].join();
+	_threads.clear();
+	_acceptor.reset();
+}
+
+
+void AnnotationServer::Accept()
+{
+	std::shared_ptr<HttpConnection> connection = std::make_shared<HttpConnection>(_io_service, *this);
+	_acceptor->async_accept(connection->socket(),
+		[this, connection](const boost::system::error_code& ec){
+			if (!ec)
+				connection->Start();
+			if (_acceptor && _acceptor->is_open())
+				Accept();
+		});
+}
+
+
+void AnnotationServer::SetDataset(const ImageList& file_list, const std::vector<std::vector<cv::Rect>>& rectlist)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	// 取り出されていない更新は以前の画像一覧の画像IDのため使えない
+	if (!_update_indices.empty())
+		std::cerr << _update_indices.size() << " updates from the annotation server are discarded." << std::endl;
+	_file_list = file_list;
+	_rectlist = rectlist;
+	_update_indices.clear();
+	_update_rects.clear();
+	_has_dataset = true;
+}
+
+
+void AnnotationServer::SetAnnotation(int image_idx, const std::vector<cv::Rect>& rects)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (image_idx >= 0 && image_idx < _rectlist.size())
+		_rectlist[image_idx] = rects;
+}
+
+
+bool AnnotationServer::PopUpdates(std::vector<int>& indices, std::vector<std::vector<cv::Rect>>& rectlist)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	indices.clear();
+	rectlist.clear();
+	indices.swap(_update_indices);
+	rectlist.swap(_update_rects);
+	return !indices.empty();
+}
+
+
+bool AnnotationServer::IsAllowedOrigin(const Request& req) const
+{
+	// 他のWebページからの要求（DNSリバインディングやクロスオリジンのPOST）を受け付けないよう、
+	// Hostは待ち受けているアドレスとポート、Originは付いている場合のみ同じオリジンに限る
+	std::ostringstream oss;
+	oss << ":" << _port;
+	std::string port = oss.str();
+
+	std::map<std::string, std::string>::const_iterator it = req.headers.find("host");
+	if (it == req.headers.end())
+		return false;
+	std::string host = boost::algorithm::to_lower_copy(it->second);
+	if (host != "127.0.0.1" + port && host != "localhost" + port)
+		return false;
+
+	it = req.headers.find("origin");
+	if (it == req.headers.end())
+		return true;
+	std::string origin = boost::algorithm::to_lower_copy(it->second);
+	return (origin == "http://127.0.0.1" + port || origin == "http://localhost" + port);
+}
+
+
+void AnnotationServer::HandleRequest(const Request& req, Response& res)
+{
+	if (!IsAllowedOrigin(req)){
+		res.status = 403;
+		res.body = "{\"error\":403}";
+		return;
+	}
+
+	std::vector<std::string> segments;
+	boost::algorithm::split(segments, req.path, boost::is_any_of("/"), boost::token_compress_on);
+	if (!segments.empty() && segments[0].empty())
+		segments.erase(segments.begin());
+
+	std::string resource = segments.empty() ? "" : segments[0];
+	bool has_id = (segments.size() == 2 && !segments[1].empty());
+	int image_idx = -1;
+	if (has_id && !ParseIndex(segments[1], image_idx)){
+		res.status = 404;
+		res.body = "{\"error\":404}";
+		return;
+	}
+
+	if (req.method == "GET"){
+		if (resource == "status" && segments.size() == 1)
+			GetStatus(res);
+		else if (resource == "images" && segments.size() == 1)
+			GetImages(req, res);
+		else if (resource == "images" && has_id)
+			GetImage(image_idx, req, res);
+		else if (resource == "annotations" && segments.size() == 1)
+			GetAnnotations(req, res);
+		else if (resource == "annotations" && has_id)
+			GetAnnotation(image_idx, res);
+		else
+			res.status = 404;
+	}
+	else if (req.method == "POST"){
+		if (resource == "annotations" && segments.size() == 1)
+			PostAnnotations(req, res);
+		else
+			res.status = 404;
+	}
+	else{
+		res.status = 405;
+	}
+
+	if (res.status >= 400 && res.body.empty() && !res.file){
+		std::ostringstream oss;
+		oss << "{\"error\":" << res.status << "}";
+		res.body = oss.str();
+		res.content_type = "application/json";
+	}
+}
+
+
+void AnnotationServer::GetStatus(Response& res) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	int num_annotated = 0;
+	for (size_t i = 0; i < _rectlist.size(); i++){
+		if (!_rectlist[i].empty())
+			num_annotated++;
+	}
+	std::ostringstream oss;
+	oss << "{\"images\":" << _file_list.size() << ",\"annotated\":" << num_annotated
+		<< ",\"pending_updates\":" << _update_indices.size() << "}";
+	res.body = oss.str();
+}
+
+
+void AnnotationServer::GetImages(const Request& req, Response& res) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	int num = _file_list.size();
+	int offset = std::max(0, QueryInt(req.query, "offset", 0));
+	int end = std::min(num, offset + std::max(0, QueryInt(req.query, "limit", DEFAULT_LIMIT)));
+
+	std::ostringstream oss;
+	oss << "{\"total\":" << num << ",\"images\":[";
+	std::string path;
+	for (int i = offset; i < end; i++){
+		if (i > offset)
+			oss << ',';
+		_file_list.Get(i, path);
+		oss << "{\"id\":" << i << ",\"path\":";
+		WriteJsonString(oss, path);
+		oss << '}';
+	}
+	oss << "]}";
+	res.body = oss.str();
+}
+
+
+void AnnotationServer::GetImage(int image_idx, const Request& req, Response& res)
+{
+	std::string filename;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (image_idx < 0 || image_idx >= _file_list.size()){
+			res.status = 404;
+			return;
+		}
+		filename = _file_list[image_idx];
+	}
+
+	const char* data = NULL;
+	size_t size = 0;
+	std::string video_file;
+	int frame;
+	if (ImageList::ParseVideoFrame(filename, video_file, frame)){
+		// 動画フレームはJPEGに符号化して返す
+		cv::Mat img;
+		std::vector<uchar> encoded;
+		{
+			std::lock_guard<std::mutex> lock(_video_mutex);
+			if ((_video.path() != video_file && !_video.Open(video_file)) || !_video.Read(frame, img)){
+				res.status = 404;
+				return;
+			}
+		}
+		cv::imencode(".jpg", img, encoded);
+		res.body.assign(encoded.begin(), encoded.end());
+		res.content_type = "image/jpeg";
+		data = res.body.data();
+		size = res.body.size();
+	}
+	else{
+		std::shared_ptr<boost::iostreams::mapped_file_source> mapping;
+		try{
+			mapping = std::make_shared<boost::iostreams::mapped_file_source>(filename);
+		}
+		catch (const std::exception&){
+			res.status = 404;
+			return;
+		}
+		res.content_type = ContentType(filename);
+		res.file = mapping;
+		data = mapping->data();
+		size = mapping->size();
+	}
+
+	res.headers.push_back("Accept-Ranges: bytes");
+	size_t first = 0, length = size;
+	std::map<std::string, std::string>::const_iterator range = req.headers.find("range");
+	if (range != req.headers.end()){
+		if (!ParseRange(range->second, size, first, length)){
+			std::ostringstream oss;
+			oss << "Content-Range: bytes */" << size;
+			res.headers.push_back(oss.str());
+			res.status = 416;
+			res.file.reset();
+			res.body.clear();
+			return;
+		}
+		std::ostringstream oss;
+		oss << "Content-Range: bytes " << first << "-" << first + length - 1 << "/" << size;
+		res.headers.push_back(oss.str());
+		res.status = 206;
+	}
+
+	if (res.file){
+		res.file_data = data + first;
+		res.file_size = length;
+	}
+	else{
+		res.body = res.body.substr(first, length);
+	}
+}
+
+
+void AnnotationServer::GetAnnotations(const Request& req, Response& res) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	int num = _rectlist.size();
+	int offset = std::max(0, QueryInt(req.query, "offset", 0));
+	int end = std::min(num, offset + std::max(0, QueryInt(req.query, "limit", DEFAULT_LIMIT)));
+
+	std::ostringstream oss;
+	oss << "{\"total\":" << num << ",\"annotations\":[";
+	for (int i = offset; i < end; i++){
+		if (i > offset)
+			oss << ',';
+		oss << "{\"id\":" << i << ",\"rects\":";
+		WriteJsonRects(oss, _rectlist[i]);
+		oss << '}';
+	}
+	oss << "]}";
+	res.body = oss.str();
+}
+
+
+void AnnotationServer::GetAnnotation(int image_idx, Response& res) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (image_idx < 0 || image_idx >= _rectlist.size()){
+		res.status = 404;
+		return;
+	}
+
+	std::ostringstream oss;
+	oss << "{\"id\":" << image_idx << ",\"path\":";
+	WriteJsonString(oss, _file_list[image_idx]);
+	oss << ",\"rects\":";
+	WriteJsonRects(oss, _rectlist[image_idx]);
+	oss << '}';
+	res.body = oss.str();
+}
+
+
+void AnnotationServer::PostAnnotations(const Request& req, Response& res)
+{
+	// 全行を解析できた場合のみ反映する
+	std::vector<int> indices;
+	std::vector<std::vector<cv::Rect>> rectlist;
+	std::istringstream iss(req.body);
+	std::string line;
+	int line_num = 0;
+	while (std::getline(iss, line)){
+		line_num++;
+		std::istringstream line_stream(line);
+		int image_idx, num;
+		if (!(line_stream >> image_idx))
+			continue;	// 空行
+		std::vector<cv::Rect> rects;
+		bool valid = (line_stream >> num) && num >= 0;
+		for (int i = 0; valid && i < num; i++){
+			cv::Rect rect;
+			valid = (line_stream >> rect.x >> rect.y >> rect.width >> rect.height) && rect.width >= 0 && rect.height >= 0;
+			rects.push_back(rect);
+		}
+		if (!valid){
+			std::ostringstream oss;
+			oss << "{\"error\":400,\"line\":" << line_num << "}";
+			res.body = oss.str();
+			res.status = 400;
+			return;
+		}
+		indices.push_back(image_idx);
+		rectlist.push_back(rects);
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_has_dataset){
+		// 画像一覧を読み込む前の更新は反映先がない
+		res.body = "{\"error\":503}";
+		res.status = 503;
+		return;
+	}
+	for (size_t i = 0; i < indices.size(); i++){
+		if (indices[i] < 0 || indices[i] >= _rectlist.size()){
+			std::ostringstream oss;
+			oss << "{\"error\":404,\"id\":" << indices[i] << "}";
+			res.body = oss.str();
+			res.status = 404;
+			return;
+		}
+	}
+	for (size_t i = 0; i < indices.size(); i++){
+		_rectlist[indices[i]] = rectlist[i];
+		_update_indices.push_back(indices[i]);
+		_update_rects.push_back(rectlist[i]);
+	}
+
+	std::ostringstream oss;
+	oss << "{\"accepted\":" << indices.size() << "}";
+	res.body = oss.str();
+}
+
+
+//! パラメータ読み込み
+void AnnotationServer::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	fn["port"] >> _port;
+	if (!fn["server_threads"].empty())
+		fn["server_threads"] >> _num_threads;
+}
+
+
+//! パラメータ書き込み
+void AnnotationServer::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "port" << _port;
+	fs << "server_threads" << _num_threads;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void AnnotationServer::PrintStatus() const{
+	if (is_running())
+		std::cout << "アノテーションサーバ： http://127.0.0.1:" << _port << "/" << std::endl;
+}
@@ -0,0 +1,166 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __ANNOTATION_SERVER__
+#define __ANNOTATION_SERVER__
+
+#include <opencv2/core/core.hpp>
+#include "ImageList.h"
+#include "VideoSource.h"
+#include <boost/asio.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! 画像一覧とアノテーションをlocalhostのHTTPで公開するサーバ
+/*!
+スレッドプールで非同期に多数の接続を処理する。受け付けた更新は保持しているアノテーションへ
+すぐに反映し、アノテーションファイルへの書き込みはUIスレッドがPopUpdates()で取り出して行う
+（ファイルの形式はそのまま）
+
+GET  /status                       画像数などの状態
+GET  /images?offset=&limit=        画像一覧
+GET  /images/{id}                  画像ファイル（Rangeヘッダに対応）
+GET  /annotations?offset=&limit=   アノテーション一覧
+GET  /annotations/{id}             指定した画像のアノテーション
+POST /annotations                  アノテーションの更新（1行に"画像ID 個数 x y w h ..."）
+
+Hostが待ち受けているアドレスとポートでない要求、他のオリジンのOriginが付いた要求は403で拒否する
+*/
+class AnnotationServer
+{
+	friend class HttpConnection;
+
+public:
+	AnnotationServer();
+	~AnnotationServer();
+
+	//! サーバの開始
+	/*!
+	\return 開始の成否（ポート番号が指定されていない、または待ち受けできない場合はfalse）
+	*/
+	bool Start();
+
+	//! サーバの停止
+	void Stop();
+
+	//! 実行中かどうか
+	bool is_running() const{
+		return !_threads.empty();
+	}
+
+	//! 公開する画像一覧とアノテーションを設定
+	void SetDataset(const ImageList& file_list, const std::vector<std::vector<cv::Rect>>& rectlist);
+
+	//! 指定した画像のアノテーションを更新（UIスレッドでの編集を反映）
+	void SetAnnotation(int image_idx, const std::vector<cv::Rect>& rects);
+
+	//! クライアントから届いた更新を取り出す
+	/*!
+	\param[out] indices 更新された画像ID
+	\param[out] rectlist 各画像のアノテーション（indicesと同じ順）
+	\return 更新があったかどうか
+	*/
+	bool PopUpdates(std::vector<int>& indices, std::vector<std::vector<cv::Rect>>& rectlist);
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	//! HTTPリクエスト
+	struct Request{
+		std::string method;
+		std::string path;
+		std::map<std::string, std::string> query;
+		std::map<std::string, std::string> headers;	//!< ヘッダ（名前は小文字）
+		std::string body;
+	};
+
+	//! HTTPレスポンス
+	struct Response{
+		int status;
+		std::string content_type;
+		std::vector<std::string> headers;	//!< 追加のヘッダ行
+		std::string body;
+		std::shared_ptr<const void> file;	//!< ファイルを返す場合のマッピング（bodyの代わり）
+		const char* file_data;
+		size_t file_size;
+		Response() : status(200), content_type("application/json"), file_data(NULL), file_size(0){}
+	};
+
+	boost::asio::io_service _io_service;
+	std::unique_ptr<boost::asio::ip::tcp::acceptor> _acceptor;
+	std::unique_ptr<boost::asio::io_service::work> _work;
+	std::vector<std::thread> _threads;	//!< リクエスト処理用スレッド
+
+	mutable std::mutex _mutex;
+	ImageList _file_list;	//!< 公開する画像一覧
+	std::vector<std::vector<cv::Rect>> _rectlist;	//!< 公開するアノテーション
+	std::vector<int> _update_indices;	//!< UIスレッドへ渡す更新の画像ID
+	std::vector<std::vector<cv::Rect>> _update_rects;	//!< UIスレッドへ渡す更新のアノテーション
+	bool _has_dataset;	//!< 画像一覧が設定されたかどうか
+
+	std::mutex _video_mutex;
+	VideoSource _video;	//!< 動画フレームの読み込み
+
+	/////// パラメータ /////////////
+	int _port;	//!< 待ち受けるポート番号（0の場合は無効）
+	int _num_threads;	//!< リクエスト処理用スレッド数
+	///////////////////////////////////
+
+	//! 接続の受け付け
+	void Accept();
+
+	//! リクエストの処理（リクエスト処理用スレッド）
+	void HandleRequest(const Request& req, Response& res);
+
+	//! Host、Originヘッダが自身を指しているかどうか
+	bool IsAllowedOrigin(const Request& req) const;
+
+	void GetStatus(Response& res) const;
+	void GetImages(const Request& req, Response& res) const;
+	void GetImage(int image_idx, const Request& req, Response& res);
+	void GetAnnotations(const Request& req, Response& res) const;
+	void GetAnnotation(int image_idx, Response& res) const;
+	void PostAnnotations(const Request& req, Response& res);
+};
+
+#endif
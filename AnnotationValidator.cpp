@@ -0,0 +1,480 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "AnnotationValidator.h"
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <cctype>
+#include <unordered_map>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "util_cv_functions.h"
+#include "VideoSource.h"
+
+namespace{
+	//! 1行分の解析結果
+	struct LineRecord{
+		int line;	// 行番号（チャンク内では0始まり）
+		bool verbatim;	// コメント行や空行（そのまま残す）
+		bool drop;	// 修正したファイルから取り除く
+		std::string text;	// verbatimの場合の原文、それ以外は画像ファイル名
+		std::vector<cv::Rect> rects;	// 書式が正しく、幅と高さを正規化したマーカー
+		std::vector<int> rect_ids;	// 各マーカーの行内での番号
+	};
+
+	//! チャンク1つ分の解析結果
+	struct Chunk{
+		const char* begin;
+		const char* end;
+		int num_lines;
+		std::vector<LineRecord> records;
+		std::vector<AnnotationIssue> issues;
+	};
+
+	//! 整数への変換（前後の空白や余分な文字は認めない）
+	bool ParseInt(const std::string& token, int& value)
+	{
+		if (token.empty())
+			return false;
+		char* end;
+		errno = 0;
+		long v = strtol(token.c_str(), &end, 10);
+		if (*end != '\0' || errno != 0 || v < INT_MIN || v > INT_MAX || isspace((unsigned char)token[0]))
+			return false;
+		value = (int)v;
+		return true;
+	}
+
+	std::string RectString(const cv::Rect& rect)
+	{
+		std::ostringstream oss;
+		oss << rect.x << " " << rect.y << " " << rect.width << " " << rect.height;
+		return oss.str();
+	}
+
+	//! 1行の書式と、画像サイズによらないマーカーの検査
+	void ParseLine(const std::string& text, int line, LineRecord& record, std::vector<AnnotationIssue>& issues)
+	{
+		record.line = line;
+		record.verbatim = false;
+		record.drop = false;
+
+		// util::LoadAnnotationFileと同じく1文字の空白で区切る（連続する空白は空の項目になる）
+		std::vector<std::string> tokens;
+		std::string::size_type start = 0, pos;
+		while ((pos = text.find(' ', start)) != std::string::npos){
+			tokens.push_back(text.substr(start, pos - start));
+			start = pos + 1;
+		}
+		tokens.push_back(text.substr(start));
+
+		if (tokens[0].empty() || tokens[0].find('#') != std::string::npos){
+			record.verbatim = true;
+			record.text = text;
+			return;
+		}
+		record.text = tokens[0];
+
+		// マーカー数のない行は読み込み時に無視される
+		if (tokens.size() < 2){
+			issues.push_back(AnnotationIssue(line, AnnotationValidator::ISSUE_SYNTAX, -1, "no marker count"));
+			record.drop = true;
+			return;
+		}
+		int count;
+		if (!ParseInt(tokens[1], count) || count < 0){
+			issues.push_back(AnnotationIssue(line, AnnotationValidator::ISSUE_SYNTAX, -1,
+				"marker count '" + tokens[1] + "' is not a non-negative integer"));
+			count = -1;
+		}
+
+		int num_coords = tokens.size() - 2;
+		int num_groups = num_coords / 4;
+		if (count >= 0 && (count != num_groups || num_coords % 4 != 0)){
+			std::ostringstream oss;
+			oss << "marker count " << count << " but " << num_coords << " coordinates";
+			if (count > num_groups)
+				oss << " (" << count - num_groups << " markers are not loaded)";
+			else if (count < num_groups)
+				oss << " (" << num_groups - count << " markers are ignored)";
+			issues.push_back(AnnotationIssue(line, AnnotationValidator::ISSUE_COUNT_MISMATCH, -1, oss.str()));
+		}
+
+		for (int i = 0; i < num_groups; i++){
+			int v[4];
+			bool valid = true;
+			for (int k = 0; k < 4 && valid; k++)
+				valid = ParseInt(tokens[4 * i + 2 + k], v[k]);
+			if (!valid){
+				issues.push_back(AnnotationIssue(line, AnnotationValidator::ISSUE_SYNTAX, i, "non-integer coordinate"));
+				continue;
+			}
+			cv::Rect rect(v[0], v[1], v[2], v[3]);
+			if (rect.width < 0 || rect.height < 0){
+				issues.push_back(AnnotationIssue(line, AnnotationValidator::ISSUE_NEGATIVE_SIZE, i, RectString(rect)));
+				if (rect.width < 0){
+					rect.x += rect.width;
+					rect.width = -rect.width;
+				}
+				if (rect.height < 0){
+					rect.y += rect.height;
+					rect.height = -rect.height;
+				}
+			}
+			// 幅と高さがともに0のものは点のマーカー
+			if ((rect.width == 0) != (rect.height == 0)){
+				issues.push_back(AnnotationIssue(line, AnnotationValidator::ISSUE_DEGENERATE, i, RectString(rect)));
+				continue;
+			}
+			if (std::find(record.rects.begin(), record.rects.end(), rect) != record.rects.end()){
+				issues.push_back(AnnotationIssue(line, AnnotationValidator::ISSUE_DUPLICATE_RECT, i, RectString(rect)));
+				continue;
+			}
+			record.rects.push_back(rect);
+			record.rect_ids.push_back(i);
+		}
+	}
+
+	//! チャンク内の全行を解析
+	void ParseChunk(Chunk& chunk, std::atomic<long long>& bytes_done, const std::atomic<bool>& cancel)
+	{
+		chunk.num_lines = 0;
+		const char* p = chunk.begin;
+		while (p < chunk.end && !cancel.load()){
+			const char* eol = std::find(p, chunk.end, '\n');
+			std::string text(p, eol);
+			if (!text.empty() && text[text.size() - 1] == '\r')
+				text.erase(text.size() - 1);
+			chunk.records.push_back(LineRecord());
+			ParseLine(text, chunk.num_lines, chunk.records.back(), chunk.issues);
+			chunk.num_lines++;
+			bytes_done += (eol - p) + 1;
+			p = eol + 1;
+		}
+	}
+
+	bool IssueLess(const AnnotationIssue& a, const AnnotationIssue& b)
+	{
+		if (a.line != b.line)
+			return a.line < b.line;
+		return a.rect < b.rect;
+	}
+}
+
+
+AnnotationValidator::AnnotationValidator()
+{
+	_num_threads = 0;
+	_report_file = "lint_report.txt";
+}
+
+
+bool AnnotationValidator::Validate(const std::string& anno_file, const ImageProbe& probe, std::vector<AnnotationIssue>& issues,
+	const std::string& repaired_file, const util::ProgressCallback& progress) const
+{
+	issues.clear();
+	boost::system::error_code ec;
+	uintmax_t file_size = boost::filesystem::file_size(anno_file, ec);
+	if (ec)
+		return false;
+
+	boost::iostreams::mapped_file_source mapping;
+	std::vector<Chunk> chunks;
+	if (file_size > 0){
+		try{
+			mapping.open(anno_file);
+		}
+		catch (std::exception&){
+			return false;
+		}
+		if (!mapping.is_open())
+			return false;
+
+		// 行の境界でスレッド数のチャンクに分割
+		int num_threads = (_num_threads > 0) ? _num_threads : std::max(1, (int)std::thread::hardware_concurrency());
+		const char* data = mapping.data();
+		const char* data_end = data + mapping.size();
+		const char* begin = data;
+		for (int t = 1; t <= num_threads && begin < data_end; t++){
+			const char* end = data_end;
+			if (t < num_threads){
+				end = std::max(begin, data + (long long)mapping.size() * t / num_threads);
+				end = std::find(end, data_end, '\n');
+				if (end < data_end)
+					end++;
+			}
+			Chunk chunk;
+			chunk.begin = begin;
+			chunk.end = end;
+			chunks.push_back(chunk);
+			begin = end;
+		}
+	}
+
+	std::atomic<long long> bytes_done(0);
+	std::atomic<bool> cancel(false);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < chunks.size(); i++)
+		threads.push_back(std::thread(ParseChunk, std::ref(chunks[i]), std::ref(bytes_done), std::cref(cancel)));
+	while (bytes_done.load() < (long long)file_size && !cancel.load() && !threads.empty()){
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		if (!util::ReportProgress(progress, (int)(bytes_done.load() >> 10), (int)(file_size >> 10)))
+			cancel = true;
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	if (cancel.load())
+		return false;
+
+	// チャンク内の行番号を通し番号（1始まり）へ
+	std::vector<LineRecord> records;
+	int first_line = 1;
+	for (size_t i = 0; i < chunks.size(); i++){
+		for (size_t k = 0; k < chunks[i].records.size(); k++){
+			records.push_back(LineRecord());
+			std::swap(records.back(), chunks[i].records[k]);
+			records.back().line += first_line;
+		}
+		for (size_t k = 0; k < chunks[i].issues.size(); k++){
+			issues.push_back(chunks[i].issues[k]);
+			issues.back().line += first_line;
+		}
+		first_line += chunks[i].num_lines;
+	}
+	chunks.clear();
+	mapping.close();
+
+	// 記録のある画像のサイズをヘッダから取得
+	std::unordered_map<std::string, int> path_ids;
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < records.size(); i++){
+		if (records[i].verbatim || records[i].drop || path_ids.count(records[i].text))
+			continue;
+		path_ids[records[i].text] = paths.size();
+		paths.push_back(records[i].text);
+	}
+	// 動画フレームは動画ファイルごとにフレーム数と大きさを調べ、それ以外の画像はまとめて取得
+	std::vector<cv::Size> sizes(paths.size());
+	std::vector<int> missing(paths.size(), 0);	// 0: あり、1: ファイルがない、2: フレームがない
+	std::vector<std::string> image_paths;
+	std::vector<int> image_ids;
+	std::map<std::string, std::pair<int, cv::Size>> videos;	// フレーム数（開けなければ-1）と大きさ
+	for (size_t i = 0; i < paths.size(); i++){
+		std::string video_file;
+		int frame;
+		if (!ImageList::ParseVideoFrame(paths[i], video_file, frame) || !VideoSource::IsVideoFile(video_file)){
+			image_paths.push_back(paths[i]);
+			image_ids.push_back(i);
+			continue;
+		}
+		std::map<std::string, std::pair<int, cv::Size>>::iterator it = videos.find(video_file);
+		if (it == videos.end()){
+			VideoSource video;
+			std::pair<int, cv::Size> info(-1, cv::Size());
+			if (video.Open(video_file))
+				info = std::make_pair(video.num_frames(), video.frame_size());
+			else if (!boost::filesystem::exists(video_file, ec))
+				info.first = -2;
+			it = videos.insert(std::make_pair(video_file, info)).first;
+		}
+		if (it->second.first == -2)
+			missing[i] = 1;
+		else if (it->second.first >= 0 && frame >= it->second.first)
+			missing[i] = 2;
+		else
+			sizes[i] = it->second.second;
+	}
+	std::vector<cv::Size> image_sizes;
+	if (!probe.Probe(ImageList(image_paths), image_sizes, progress))
+		return false;
+	for (size_t k = 0; k < image_ids.size(); k++){
+		int id = image_ids[k];
+		sizes[id] = image_sizes[k];
+		if (sizes[id].area() <= 0)
+			missing[id] = !boost::filesystem::exists(paths[id], ec);
+	}
+
+	// 画像ごとの検査と、修正したファイルの出力
+	std::ofstream ofs;
+	std::string tmp_file = repaired_file + ".tmp";
+	if (!repaired_file.empty()){
+		ofs.open(tmp_file);
+		if (!ofs.is_open()){
+			std::cerr << "Fail to write repaired annotation " << repaired_file << "." << std::endl;
+			return false;
+		}
+	}
+	std::vector<std::string> last_line(paths.size());
+	for (size_t i = 0; i < records.size(); i++){
+		LineRecord& record = records[i];
+		if (record.verbatim){
+			if (ofs.is_open())
+				ofs << record.text << "\n";
+			continue;
+		}
+		if (record.drop)
+			continue;
+
+		int id = path_ids[record.text];
+		if (missing[id]){
+			issues.push_back(AnnotationIssue(record.line, missing[id] == 2 ? ISSUE_MISSING_FRAME : ISSUE_MISSING_FILE, -1, record.text));
+			continue;
+		}
+
+		// 画像サイズが分かれば、枠をはみ出したマーカーを切り詰め、重ならないマーカーを取り除く
+		std::ostringstream oss;
+		int num_rects = 0;
+		const cv::Size& img_size = sizes[id];
+		cv::Rect img_rect(0, 0, img_size.width, img_size.height);
+		for (size_t k = 0; k < record.rects.size(); k++){
+			cv::Rect rect = record.rects[k];
+			if (img_size.area() > 0){
+				bool is_point = (rect.width == 0 && rect.height == 0);
+				bool overlap = is_point ? img_rect.contains(rect.tl()) : util::CheckRectOverlapSize(rect, img_size);
+				if (!overlap){
+					issues.push_back(AnnotationIssue(record.line, ISSUE_OUTSIDE, record.rect_ids[k], RectString(rect)));
+					continue;
+				}
+				if (!is_point && (rect & img_rect) != rect){
+					issues.push_back(AnnotationIssue(record.line, ISSUE_PARTLY_OUTSIDE, record.rect_ids[k], RectString(rect)));
+					rect &= img_rect;
+				}
+			}
+			oss << " " << RectString(rect);
+			num_rects++;
+		}
+		std::ostringstream line;
+		line << record.text << " " << num_rects << oss.str();
+
+		// 同じ画像の直前の記録と同じであれば不要
+		if (line.str() == last_line[id]){
+			issues.push_back(AnnotationIssue(record.line, ISSUE_DUPLICATE_LINE, -1, record.text));
+			continue;
+		}
+		last_line[id] = line.str();
+		if (ofs.is_open())
+			ofs << line.str() << "\n";
+	}
+
+	if (ofs.is_open()){
+		ofs.close();
+		if (!ofs){
+			std::cerr << "Fail to write repaired annotation " << repaired_file << "." << std::endl;
+			return false;
+		}
+		boost::filesystem::rename(tmp_file, repaired_file, ec);
+		if (ec){
+			std::cerr << "Fail to write repaired annotation " << repaired_file << "." << std::endl;
+			return false;
+		}
+	}
+
+	std::stable_sort(issues.begin(), issues.end(), IssueLess);
+	return true;
+}
+
+
+void AnnotationValidator::WriteReport(std::ostream& os, const std::string& anno_file, const std::vector<AnnotationIssue>& issues)
+{
+	for (size_t i = 0; i < issues.size(); i++){
+		os << anno_file << ":" << issues[i].line << ": " << IssueName(issues[i].type);
+		if (issues[i].rect >= 0)
+			os << " (marker " << issues[i].rect + 1 << ")";
+		os << ": " << issues[i].detail << "\n";
+	}
+}
+
+
+void AnnotationValidator::PrintSummary(std::ostream& os, const std::vector<AnnotationIssue>& issues)
+{
+	std::vector<int> counts(NUM_ISSUE_TYPES, 0);
+	for (size_t i = 0; i < issues.size(); i++)
+		counts[issues[i].type]++;
+	os << issues.size() << " issues found." << std::endl;
+	for (int t = 0; t < NUM_ISSUE_TYPES; t++){
+		if (counts[t] > 0)
+			os << "  " << IssueName(t) << ": " << counts[t] << std::endl;
+	}
+}
+
+
+const char* AnnotationValidator::IssueName(int type)
+{
+	static const char* names[NUM_ISSUE_TYPES] = {
+		"syntax", "count-mismatch", "negative-size", "degenerate", "partly-outside",
+		"outside", "duplicate-marker", "missing-file", "duplicate-line", "missing-frame"
+	};
+	return (type >= 0 && type < NUM_ISSUE_TYPES) ? names[type] : "unknown";
+}
+
+
+//! パラメータ読み込み
+void AnnotationValidator::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	_num_threads = fn["validate_threads"];
+	if (!fn["lint_report_file"].empty())
+		fn["lint_report_file"] >> _report_file;
+}
+
+
+//! パラメータ書き込み
+void AnnotationValidator::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "validate_threads" << _num_threads;
+	fs << "lint_report_file" << _report_file;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void AnnotationValidator::PrintStatus() const
+{
+	std::cout << "アノテーション検査のスレッド数： " << _num_threads << std::endl;
+	std::cout << "アノテーション検査の出力先： " << _report_file << std::endl;
+}
@@ -0,0 +1,132 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __ANNOTATION_VALIDATOR__
+#define __ANNOTATION_VALIDATOR__
+
+#include <opencv2/core/core.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ImageProbe.h"
+#include "util_functions.h"
+
+//! アノテーションファイルの問題1件
+struct AnnotationIssue
+{
+	int line;	//!< 行番号（1始まり）
+	int type;	//!< 問題の種類（AnnotationValidator::ISSUE_*）
+	int rect;	//!< 問題のあるマーカーの番号（行全体の問題の場合は-1）
+	std::string detail;	//!< 詳細
+
+	AnnotationIssue() : line(0), type(0), rect(-1){}
+	AnnotationIssue(int l, int t, int r, const std::string& d) : line(l), type(t), rect(r), detail(d){}
+};
+
+
+//! アノテーションファイルの検査
+/*!
+アノテーションファイルをメモリマップして行の境界で分割し、複数スレッドで各行の書式とマーカーを検査する。
+画像サイズはImageProbeでヘッダから取得し、画像の存在と枠外のマーカーを調べる。
+動画フレーム（動画ファイル名@フレーム番号）は動画ファイルの存在とフレーム数を調べる。
+問題を修正したファイルを出力することもできる
+*/
+class AnnotationValidator
+{
+public:
+	//////////// 問題の種類 //////////////
+	const static int ISSUE_SYNTAX = 0;	//!< マーカー数や座標が整数でない
+	const static int ISSUE_COUNT_MISMATCH = 1;	//!< マーカー数と座標の個数が一致しない
+	const static int ISSUE_NEGATIVE_SIZE = 2;	//!< 幅か高さが負
+	const static int ISSUE_DEGENERATE = 3;	//!< 幅と高さの一方のみが0
+	const static int ISSUE_PARTLY_OUTSIDE = 4;	//!< 画像の枠をはみ出している
+	const static int ISSUE_OUTSIDE = 5;	//!< 画像と重ならない
+	const static int ISSUE_DUPLICATE_RECT = 6;	//!< 同じ行に同じマーカーがある
+	const static int ISSUE_MISSING_FILE = 7;	//!< 画像ファイルがない
+	const static int ISSUE_DUPLICATE_LINE = 8;	//!< 同じ画像の直前の記録と同じ内容
+	const static int ISSUE_MISSING_FRAME = 9;	//!< 動画のフレーム番号がフレーム数を超える
+	const static int NUM_ISSUE_TYPES = 10;
+	////////////////////////////////////////
+
+	AnnotationValidator();
+
+	//! アノテーションファイルの検査
+	/*!
+	修正したファイルでは、書式の誤りを直し（マーカー数は完全な座標の組の数に合わせる）、負の幅や高さを反転し、
+	枠をはみ出したマーカーを画像内に切り詰め、画像と重ならないマーカー、幅か高さのみが0のマーカー、
+	重複したマーカー、画像ファイルのない行、動画にないフレームの行、直前と同じ内容の行を取り除く。
+	ファイルはあるがサイズの分からない画像や動画の行は、枠の検査をせずに残す。コメント行はそのまま残す
+	\param[in] anno_file アノテーションファイル名
+	\param[in] probe 画像サイズの取得クラス
+	\param[out] issues 見つかった問題（行番号順）
+	\param[in] repaired_file 修正したファイルの出力先（空の場合は出力しない）
+	\param[in] progress 進捗通知関数
+	\return 検査の成否（ファイルが読めない場合や中断された場合はfalse）
+	*/
+	bool Validate(const std::string& anno_file, const ImageProbe& probe, std::vector<AnnotationIssue>& issues,
+		const std::string& repaired_file = std::string(), const util::ProgressCallback& progress = util::ProgressCallback()) const;
+
+	//! 問題の一覧を出力
+	/*!
+	1行に「ファイル名:行番号: 種類: 詳細」
+	*/
+	static void WriteReport(std::ostream& os, const std::string& anno_file, const std::vector<AnnotationIssue>& issues);
+
+	//! 問題の種類ごとの件数を出力
+	static void PrintSummary(std::ostream& os, const std::vector<AnnotationIssue>& issues);
+
+	//! 問題の種類の名前
+	static const char* IssueName(int type);
+
+	//! 問題の一覧の出力ファイル名
+	const std::string& report_file() const{
+		return _report_file;
+	}
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	/////// パラメータ /////////////
+	int _num_threads;	//!< 検査スレッド数（0の場合はCPU数）
+	std::string _report_file;	//!< 問題の一覧の出力ファイル名
+	///////////////////////////////////
+};
+
+#endif
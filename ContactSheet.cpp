@@ -0,0 +1,233 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "ContactSheet.h"
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+namespace{
+	const char* WINDOW_NAME = "Contact Sheet";
+	const int MARGIN = 4;	// 縮小画像の周囲の余白
+	const int LABEL_HEIGHT = 16;	// 画像番号の表示領域の高さ
+	enum{
+		Key_Enter = 13, Key_ESC = 27, Key_Space = 32, Key_BS = 8
+	};
+}
+
+
+ContactSheet::ContactSheet()
+{
+	_backend = &HighGuiBackend::Instance();
+	_cell_size = 0;
+	_first_idx = 0;
+	_num_files = 0;
+	_clicked = -1;
+	_cols = 6;
+	_rows = 4;
+}
+
+
+void ContactSheet::SetBackend(DisplayBackend* backend)
+{
+	_backend = backend ? backend : &HighGuiBackend::Instance();
+}
+
+
+const cv::Mat& ContactSheet::Render(const ImageList& file_list, const std::vector<std::vector<cv::Rect>>& rectlist,
+	int first_idx, ThumbnailCache& thumbnails)
+{
+	int thumb_size = thumbnails.thumb_size();
+	_cell_size = thumb_size + 2 * MARGIN;
+	_canvas.create(_rows * (_cell_size + LABEL_HEIGHT), _cols * _cell_size, CV_8UC3);
+	_canvas.setTo(cv::Scalar::all(48));
+
+	// ページ内の縮小画像を並列に取得（キャッシュになければここでデコード）
+	int num_cells = std::min(page_size(), (int)file_list.size() - first_idx);
+	std::vector<cv::Mat> thumbs(std::max(0, num_cells));
+	std::vector<cv::Size> org_sizes(thumbs.size());
+	std::atomic<int> next(0);
+	auto worker = [&](){
+		std::string path;
+		int k;
+		while ((k = next++) < num_cells){
+			file_list.Get(first_idx + k, path);
+			if (!thumbnails.Get(path, thumbs[k], org_sizes[k]))
+				thumbs[k].release();
+		}
+	};
+	int num_threads = std::min(num_cells, std::max(1, (int)std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (int i = 0; i < num_threads; i++)
+		threads.push_back(std::thread(worker));
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	for (int k = 0; k < num_cells; k++){
+		int idx = first_idx + k;
+		cv::Point origin((k % _cols) * _cell_size, (k / _cols) * (_cell_size + LABEL_HEIGHT));
+		int num_markers = (idx < rectlist.size()) ? rectlist[idx].size() : 0;
+
+		// 設定より大きな縮小画像（古いキャッシュ等）はセルに収まるよう縮小する
+		if (!thumbs[k].empty() && std::max(thumbs[k].cols, thumbs[k].rows) > thumb_size){
+			double scale = (double)thumb_size / std::max(thumbs[k].cols, thumbs[k].rows);
+			cv::resize(thumbs[k], thumbs[k], cv::Size(std::max(1, (int)(thumbs[k].cols * scale)),
+				std::max(1, (int)(thumbs[k].rows * scale))), 0, 0, cv::INTER_AREA);
+		}
+
+		if (!thumbs[k].empty()){
+			// 縮小画像をセルの中央に配置し、マーカーを同じ縮尺で重ねる
+			cv::Rect roi(origin.x + (_cell_size - thumbs[k].cols) / 2, origin.y + (_cell_size - thumbs[k].rows) / 2,
+				thumbs[k].cols, thumbs[k].rows);
+			cv::Mat cell = _canvas(roi);
+			thumbs[k].copyTo(cell);
+			double sx = (double)thumbs[k].cols / org_sizes[k].width;
+			double sy = (double)thumbs[k].rows / org_sizes[k].height;
+			for (int i = 0; i < num_markers; i++){
+				const cv::Rect& r = rectlist[idx][i];
+				cv::Point tl((int)(r.x * sx), (int)(r.y * sy));
+				cv::Point br((int)((r.x + r.width) * sx), (int)((r.y + r.height) * sy));
+				cv::rectangle(cell, tl, br, CV_RGB(255, 0, 0), 1);
+			}
+		}
+
+		// 画像番号とマーカー数（マーカーのない画像は灰色）
+		std::ostringstream oss;
+		oss << idx + 1 << " (" << num_markers << ")";
+		cv::Scalar color = num_markers > 0 ? CV_RGB(255, 255, 255) : CV_RGB(128, 128, 128);
+		cv::putText(_canvas, oss.str(), cv::Point(origin.x + MARGIN, origin.y + _cell_size + LABEL_HEIGHT - 4),
+			cv::FONT_HERSHEY_SIMPLEX, 0.4, color, 1);
+	}
+
+	_first_idx = first_idx;
+	_num_files = file_list.size();
+	return _canvas;
+}
+
+
+int ContactSheet::Review(const ImageList& file_list, const std::vector<std::vector<cv::Rect>>& rectlist, int start_idx,
+	ThumbnailCache& thumbnails, const std::function<bool()>& idle)
+{
+	int num_files = file_list.size();
+	if (num_files == 0)
+		return -1;
+	int page = page_size();
+	int first_idx = (std::max(0, std::min(start_idx, num_files - 1)) / page) * page;
+
+	_clicked = -1;
+	_backend->OpenWindow(WINDOW_NAME, ContactSheet::on_mouse, this);
+	bool redraw = true;
+	bool busy = idle && idle();
+	while (true){
+		if (redraw){
+			std::cout << "Images " << first_idx + 1 << "-" << std::min(first_idx + page, num_files)
+				<< " / " << num_files << std::endl;
+			_backend->ShowImage(WINDOW_NAME, Render(file_list, rectlist, first_idx, thumbnails));
+			redraw = false;
+		}
+
+		// バックグラウンド処理の実行中のみポーリング
+		int key = _backend->WaitInput(busy ? 30 : 0);
+		if (_clicked >= 0 || key == Key_ESC)
+			break;
+		if (idle)
+			busy = idle();
+		if (key == Key_Space || key == Key_Enter){
+			if (first_idx + page < num_files){
+				first_idx += page;
+				redraw = true;
+			}
+		}
+		else if (key == Key_BS){
+			if (first_idx > 0){
+				first_idx -= page;
+				redraw = true;
+			}
+		}
+	}
+	_backend->CloseWindow(WINDOW_NAME);
+	thumbnails.Flush();
+	return _clicked;
+}
+
+
+void ContactSheet::on_mouse(int event, int x, int y, int /*flag*/, void* param)
+{
+	ContactSheet* sheet = (ContactSheet*)param;
+	if (event != CV_EVENT_LBUTTONUP || sheet->_cell_size <= 0 || x < 0 || y < 0)
+		return;
+
+	int col = x / sheet->_cell_size;
+	int row = y / (sheet->_cell_size + LABEL_HEIGHT);
+	if (col >= sheet->_cols || row >= sheet->_rows)
+		return;
+	int idx = sheet->_first_idx + row * sheet->_cols + col;
+	if (idx < sheet->_num_files)
+		sheet->_clicked = idx;
+}
+
+
+//! パラメータ読み込み
+void ContactSheet::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	if (!fn["sheet_cols"].empty())
+		_cols = std::max(1, (int)fn["sheet_cols"]);
+	if (!fn["sheet_rows"].empty())
+		_rows = std::max(1, (int)fn["sheet_rows"]);
+}
+
+
+//! パラメータ書き込み
+void ContactSheet::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "sheet_cols" << _cols;
+	fs << "sheet_rows" << _rows;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void ContactSheet::PrintStatus() const
+{
+	std::cout << "一覧表示： " << _cols << "x" << _rows << std::endl;
+}
@@ -0,0 +1,117 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __CONTACT_SHEET__
+#define __CONTACT_SHEET__
+
+#include <opencv2/core/core.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+#include "DisplayBackend.h"
+#include "ImageList.h"
+#include "ThumbnailCache.h"
+
+//! 縮小画像の一覧表示
+/*!
+列数×行数の縮小画像にマーカーを重ねて1ページとして表示し、アノテーションをまとめて確認する。
+クリックした画像を選択して通常の表示に戻る
+*/
+class ContactSheet
+{
+public:
+	ContactSheet();
+
+	//! 表示先の設定
+	/*!
+	backendは呼び出し側で保持すること
+	\param[in] backend 表示先。NULLの場合はHighGUIのウィンドウ
+	*/
+	void SetBackend(DisplayBackend* backend);
+
+	//! 一覧を表示して画像を選択
+	/*!
+	<Space>/<Enter>で次のページ、<BackSpace>で前のページ、<ESC>で選択せずに終了する
+	\param[in] file_list 画像一覧
+	\param[in] rectlist 各画像のマーカー
+	\param[in] start_idx 最初に表示するページに含まれる画像ID
+	\param[in] thumbnails 縮小画像のキャッシュ
+	\param[in] idle キー入力待ちの間に呼ぶ関数。バックグラウンド処理が残っていればtrueを返す
+	\return クリックされた画像ID。選択せずに終了した場合は-1
+	*/
+	int Review(const ImageList& file_list, const std::vector<std::vector<cv::Rect>>& rectlist, int start_idx,
+		ThumbnailCache& thumbnails, const std::function<bool()>& idle = std::function<bool()>());
+
+	//! 1ページ分の描画
+	/*!
+	\param[in] file_list 画像一覧
+	\param[in] rectlist 各画像のマーカー
+	\param[in] first_idx ページの先頭の画像ID
+	\param[in] thumbnails 縮小画像のキャッシュ
+	\return 描画した画像
+	*/
+	const cv::Mat& Render(const ImageList& file_list, const std::vector<std::vector<cv::Rect>>& rectlist, int first_idx,
+		ThumbnailCache& thumbnails);
+
+	//! 1ページの画像数
+	int page_size() const{
+		return _cols * _rows;
+	}
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	DisplayBackend* _backend;	//!< 表示先
+	cv::Mat _canvas;	//!< 描画用画像
+	int _cell_size;	//!< 1枚分の描画領域の一辺
+	int _first_idx;	//!< 表示中のページの先頭の画像ID
+	int _num_files;	//!< 表示中の画像一覧の画像数
+	int _clicked;	//!< クリックされた画像ID
+
+	/////// パラメータ /////////////
+	int _cols;	//!< 1ページの列数
+	int _rows;	//!< 1ページの行数
+	///////////////////////////////////
+
+	//! マウス操作のコールバック関数
+	static void on_mouse(int event, int x, int y, int flag, void* param);
+};
+
+#endif
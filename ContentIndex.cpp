@@ -0,0 +1,226 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "ContentIndex.h"
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include "FileStampCache.hpp"
+#include <iostream>
+#include <cstring>
+
+namespace{
+	const char* CACHE_SIGNATURE = "#OMHASH 1";
+
+	///////// xxHash64 /////////
+	const uint64 PRIME64_1 = 11400714785074694791ULL;
+	const uint64 PRIME64_2 = 14029467366897019727ULL;
+	const uint64 PRIME64_3 = 1609587929392839161ULL;
+	const uint64 PRIME64_4 = 9650029242287828579ULL;
+	const uint64 PRIME64_5 = 2870177450012600261ULL;
+
+	inline uint64 Rotl64(uint64 x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+
+	// リトルエンディアンを前提とする
+	inline uint64 Read64(const unsigned char* p)
+	{
+		uint64 v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint64 Read32(const unsigned char* p)
+	{
+		unsigned int v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint64 Round64(uint64 acc, uint64 input)
+	{
+		acc += input * PRIME64_2;
+		acc = Rotl64(acc, 31);
+		return acc * PRIME64_1;
+	}
+
+	inline uint64 MergeRound64(uint64 acc, uint64 val)
+	{
+		acc ^= Round64(0, val);
+		return acc * PRIME64_1 + PRIME64_4;
+	}
+
+	uint64 XXHash64(const void* data, size_t len, uint64 seed = 0)
+	{
+		const unsigned char* p = (const unsigned char*)data;
+		const unsigned char* end = p + len;
+		uint64 h;
+
+		if (len >= 32){
+			uint64 v1 = seed + PRIME64_1 + PRIME64_2;
+			uint64 v2 = seed + PRIME64_2;
+			uint64 v3 = seed;
+			uint64 v4 = seed - PRIME64_1;
+			const unsigned char* limit = end - 32;
+			do{
+				v1 = Round64(v1, Read64(p));
+				v2 = Round64(v2, Read64(p + 8));
+				v3 = Round64(v3, Read64(p + 16));
+				v4 = Round64(v4, Read64(p + 24));
+				p += 32;
+			} while (p <= limit);
+			h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+			h = MergeRound64(h, v1);
+			h = MergeRound64(h, v2);
+			h = MergeRound64(h, v3);
+			h = MergeRound64(h, v4);
+		}
+		else{
+			h = seed + PRIME64_5;
+		}
+		h += (uint64)len;
+
+		while (p + 8 <= end){
+			h ^= Round64(0, Read64(p));
+			h = Rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+			p += 8;
+		}
+		if (p + 4 <= end){
+			h ^= Read32(p) * PRIME64_1;
+			h = Rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+			p += 4;
+		}
+		while (p < end){
+			h ^= (*p) * PRIME64_5;
+			h = Rotl64(h, 11) * PRIME64_1;
+			p++;
+		}
+
+		h ^= h >> 33;
+		h *= PRIME64_2;
+		h ^= h >> 29;
+		h *= PRIME64_3;
+		h ^= h >> 32;
+		return h;
+	}
+	////////////////////////////
+}
+
+
+ContentIndex::ContentIndex()
+{
+	_num_threads = 0;
+}
+
+
+bool ContentIndex::HashFile(const std::string& filename, uint64& hash)
+{
+	boost::system::error_code ec;
+	uintmax_t size = boost::filesystem::file_size(filename, ec);
+	if (ec)
+		return false;
+	if (size == 0){
+		hash = XXHash64(0, 0);
+		return true;
+	}
+
+	// ファイル全体をメモリマップしてハッシュを計算
+	boost::iostreams::mapped_file_source mapping;
+	try{
+		mapping.open(filename);
+	}
+	catch (std::exception&){
+		return false;
+	}
+	if (!mapping.is_open())
+		return false;
+	hash = XXHash64(mapping.data(), mapping.size());
+	return true;
+}
+
+
+std::string ContentIndex::NormalizePath(const std::string& path)
+{
+	return boost::filesystem::path(path).generic_string();
+}
+
+
+bool ContentIndex::Update(const ImageList& file_list, HashTable& hashes, const util::ProgressCallback& progress) const
+{
+	hashes.clear();
+	util::FileStampCache<uint64> cache(_cache_file, CACHE_SIGNATURE, util::ReadHexHash, util::WriteHexHash);
+	std::vector<uint64> values;
+	std::vector<char> valid;
+	if (!cache.Update(file_list, HashFile, _num_threads, values, valid, progress))
+		return false;
+
+	// 移動前のパスも含めて返す
+	const util::FileStampCache<uint64>::EntryMap& entries = cache.entries();
+	hashes.reserve(entries.size());
+	util::FileStampCache<uint64>::EntryMap::const_iterator it;
+	for (it = entries.begin(); it != entries.end(); it++)
+		hashes[it->first] = it->second.value;
+	return true;
+}
+
+
+//! パラメータ読み込み
+void ContentIndex::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	fn["hash_cache_file"] >> _cache_file;
+	_num_threads = fn["hash_threads"];
+}
+
+
+//! パラメータ書き込み
+void ContentIndex::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "hash_cache_file" << _cache_file;
+	fs << "hash_threads" << _num_threads;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void ContentIndex::PrintStatus() const
+{
+	std::cout << "内容による画像の対応付け： " << (is_enabled() ? "YES" : "NO") << std::endl;
+}
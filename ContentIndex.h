@@ -0,0 +1,95 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __CONTENT_INDEX__
+#define __CONTENT_INDEX__
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <unordered_map>
+#include "ImageList.h"
+#include "util_functions.h"
+
+//! 画像ファイルの内容による同一性の索引
+/*!
+各画像ファイルの内容の64bitハッシュ（xxHash64）を複数スレッドで計算し、パス、サイズ、更新時刻とともにキャッシュファイルに記録する。
+サイズと更新時刻が変わらないファイルは再計算しない。キャッシュには移動前のパスも残るため、
+フォルダの整理でパスが変わった画像にもアノテーションを対応付けられる
+*/
+class ContentIndex
+{
+public:
+	//! パスからハッシュへの対応
+	typedef std::unordered_map<std::string, uint64> HashTable;
+
+	ContentIndex();
+
+	//! 有効かどうか（キャッシュファイルが設定されている場合のみ有効）
+	bool is_enabled() const{
+		return !_cache_file.empty();
+	}
+
+	//! 画像一覧の各ファイルのハッシュを計算
+	/*!
+	キャッシュを読み込み、新しいファイルや変更されたファイルのみを計算してキャッシュを保存する
+	\param[in] file_list 画像一覧
+	\param[out] hashes キャッシュにある全てのパス（画像一覧にないものも含む）のハッシュ
+	\param[in] progress 進捗通知関数
+	\return 計算の成否（中断された場合はfalse）
+	*/
+	bool Update(const ImageList& file_list, HashTable& hashes,
+		const util::ProgressCallback& progress = util::ProgressCallback()) const;
+
+	//! ファイルの内容のハッシュを計算
+	static bool HashFile(const std::string& filename, uint64& hash);
+
+	//! 比較用にパスを正規化
+	static std::string NormalizePath(const std::string& path);
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	/////// パラメータ /////////////
+	std::string _cache_file;	//!< キャッシュファイル名（空の場合は無効）
+	int _num_threads;	//!< 計算スレッド数（0の場合はCPU数）
+	///////////////////////////////////
+};
+
+#endif
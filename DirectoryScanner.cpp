@@ -0,0 +1,323 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "DirectoryScanner.h"
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/algorithm/string.hpp>
+#include <iostream>
+#include <fstream>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+
+namespace{
+	const char* CACHE_SIGNATURE = "#OMSCAN 1";
+}
+
+
+DirectoryScanner::DirectoryScanner()
+{
+	_RECURSIVE = false;
+	_extensions.insert(".jpg");
+	_extensions.insert(".jpeg");
+	_extensions.insert(".bmp");
+	_extensions.insert(".png");
+	_num_threads = 0;
+}
+
+
+bool DirectoryScanner::MatchExtension(const std::string& ext) const
+{
+	return _extensions.find(boost::algorithm::to_lower_copy(ext)) != _extensions.end();
+}
+
+
+std::string DirectoryScanner::ExtensionString() const
+{
+	std::vector<std::string> exts(_extensions.begin(), _extensions.end());
+	return boost::algorithm::join(exts, ",");
+}
+
+
+bool DirectoryScanner::ScanDirectory(const std::string& dir, const DirCache& cache, std::time_t cache_time, DirEntry& entry) const
+{
+	using namespace boost::filesystem;
+
+	boost::system::error_code ec;
+	path dir_path(dir);
+	entry.mtime = last_write_time(dir_path, ec);
+	if (ec)
+		return false;
+
+	// キャッシュ作成時刻と同じ秒以降に更新されたフォルダは、変更を見逃す可能性があるので読み直す
+	DirCache::const_iterator it = cache.find(dir);
+	if (it != cache.end() && it->second.mtime == entry.mtime && entry.mtime < cache_time){
+		entry = it->second;
+		return true;
+	}
+
+	entry.subdirs.clear();
+	entry.files.clear();
+	directory_iterator end;
+	for (directory_iterator p(dir_path, ec); !ec && p != end; p.increment(ec)){
+		path file_p = p->path();
+		file_status st = p->symlink_status(ec);
+		if (ec)
+			continue;
+		if (is_directory(st)){
+			// シンボリックリンクのフォルダは循環を避けるため辿らない
+			entry.subdirs.push_back(file_p.filename().string());
+		}
+		else if (MatchExtension(file_p.extension().string())){
+			entry.files.push_back(file_p.filename().string());
+		}
+	}
+	return true;
+}
+
+
+bool DirectoryScanner::Scan(const std::string& root, std::vector<std::string>& files, const util::ProgressCallback& progress) const
+{
+	using namespace boost::filesystem;
+
+	files.clear();
+	path root_path(root);
+	if (!is_directory(root_path)){
+		return false;
+	}
+
+	DirCache cache;
+	std::time_t cache_time = 0;
+	if (!_cache_file.empty())
+		LoadCache(root, cache, cache_time);
+	std::time_t scan_time = std::time(NULL);
+
+	// フォルダ単位の作業キューを複数スレッドで処理
+	DirCache result;
+	std::deque<std::string> queue;
+	queue.push_back(root_path.string());
+	int active = 0;
+	std::atomic<bool> cancel(false);
+	std::atomic<int> num_files(0);
+	std::mutex mtx;
+	std::condition_variable cond;
+
+	auto worker = [&](){
+		std::unique_lock<std::mutex> lock(mtx);
+		while (true){
+			cond.wait(lock, [&]{ return cancel.load() || !queue.empty() || active == 0; });
+			if (cancel.load() || queue.empty())
+				break;
+
+			std::string dir = queue.front();
+			queue.pop_front();
+			active++;
+			lock.unlock();
+
+			DirEntry entry;
+			bool ret = ScanDirectory(dir, cache, cache_time, entry);
+			num_files += (int)entry.files.size();
+
+			lock.lock();
+			if (ret){
+				if (_RECURSIVE){
+					for (size_t i = 0; i < entry.subdirs.size(); i++)
+						queue.push_back((path(dir) / entry.subdirs[i]).string());
+				}
+				result[dir] = entry;
+			}
+			active--;
+			cond.notify_all();
+		}
+	};
+
+	int num_threads = (_num_threads > 0) ? _num_threads : std::max(1, (int)std::thread::hardware_concurrency());
+	std::vector<std::thread> threads;
+	for (int i = 0; i < num_threads; i++)
+		threads.push_back(std::thread(worker));
+
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		while (!(queue.empty() && active == 0) && !cancel.load()){
+			cond.wait_for(lock, std::chrono::milliseconds(200));
+			lock.unlock();
+			if (!util::ReportProgress(progress, num_files.load(), 0))
+				cancel = true;
+			lock.lock();
+		}
+		// 待機中のスレッドを終了させる
+		cond.notify_all();
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	if (cancel.load())
+		return false;
+
+	files.reserve(num_files.load());
+	DirCache::const_iterator it;
+	for (it = result.begin(); it != result.end(); it++){
+		for (size_t i = 0; i < it->second.files.size(); i++)
+			files.push_back((path(it->first) / it->second.files[i]).string());
+	}
+	std::sort(files.begin(), files.end(), util::NaturalLess);
+
+	if (!_cache_file.empty() && !SaveCache(root, result, scan_time))
+		std::cerr << "Fail to write scan cache " << _cache_file << "." << std::endl;
+
+	return true;
+}
+
+
+bool DirectoryScanner::LoadCache(const std::string& root, DirCache& cache, std::time_t& cache_time) const
+{
+	std::ifstream ifs(_cache_file);
+	if (!ifs.is_open())
+		return false;
+
+	std::string buf;
+	if (!std::getline(ifs, buf) || buf != CACHE_SIGNATURE)
+		return false;
+
+	// 走査条件が異なるキャッシュは使わない
+	long long scan_time;
+	std::string cached_root, exts;
+	int recursive;
+	ifs >> scan_time;
+	ifs.ignore(1);
+	std::getline(ifs, cached_root);
+	ifs >> exts >> recursive;
+	if (!ifs || cached_root != root || exts != ExtensionString() || recursive != (_RECURSIVE ? 1 : 0))
+		return false;
+	ifs.ignore(1);
+
+	DirEntry* entry = NULL;
+	while (std::getline(ifs, buf)){
+		if (buf.size() < 2)
+			continue;
+		char type = buf[0];
+		if (type == 'D'){
+			std::string::size_type pos = buf.find(' ', 2);
+			if (pos == std::string::npos)
+				continue;
+			entry = &cache[buf.substr(pos + 1)];
+			entry->mtime = (std::time_t)atoll(buf.substr(2, pos - 2).c_str());
+		}
+		else if (entry && type == 'S'){
+			entry->subdirs.push_back(buf.substr(2));
+		}
+		else if (entry && type == 'F'){
+			entry->files.push_back(buf.substr(2));
+		}
+	}
+	cache_time = (std::time_t)scan_time;
+	return true;
+}
+
+
+bool DirectoryScanner::SaveCache(const std::string& root, const DirCache& cache, std::time_t scan_time) const
+{
+	std::ofstream ofs(_cache_file);
+	if (!ofs.is_open())
+		return false;
+
+	ofs << CACHE_SIGNATURE << "\n";
+	ofs << (long long)scan_time << " " << root << "\n";
+	ofs << ExtensionString() << " " << (_RECURSIVE ? 1 : 0) << "\n";
+
+	DirCache::const_iterator it;
+	for (it = cache.begin(); it != cache.end(); it++){
+		ofs << "D " << (long long)it->second.mtime << " " << it->first << "\n";
+		for (size_t i = 0; i < it->second.subdirs.size(); i++)
+			ofs << "S " << it->second.subdirs[i] << "\n";
+		for (size_t i = 0; i < it->second.files.size(); i++)
+			ofs << "F " << it->second.files[i] << "\n";
+	}
+	return true;
+}
+
+
+//! パラメータ読み込み
+void DirectoryScanner::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	int recursive = fn["recursive"];
+	_RECURSIVE = (recursive == 1) ? true : false;
+
+	if (!fn["extensions"].empty()){
+		std::string exts;
+		fn["extensions"] >> exts;
+		std::vector<std::string> ext_list;
+		boost::algorithm::split(ext_list, exts, boost::algorithm::is_any_of(", "), boost::algorithm::token_compress_on);
+		_extensions.clear();
+		for (size_t i = 0; i < ext_list.size(); i++){
+			std::string ext = boost::algorithm::to_lower_copy(ext_list[i]);
+			if (ext.empty())
+				continue;
+			if (ext[0] != '.')
+				ext = "." + ext;
+			_extensions.insert(ext);
+		}
+	}
+
+	_num_threads = fn["num_threads"];
+	fn["cache_file"] >> _cache_file;
+}
+
+
+//! パラメータ書き込み
+void DirectoryScanner::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "recursive" << (int)(_RECURSIVE ? 1 : 0);
+	fs << "extensions" << ExtensionString();
+	fs << "num_threads" << _num_threads;
+	fs << "cache_file" << _cache_file;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void DirectoryScanner::PrintStatus() const
+{
+	std::cout << "サブフォルダの走査： " << (_RECURSIVE ? "YES" : "NO") << std::endl;
+	std::cout << "対象の拡張子： " << ExtensionString() << std::endl;
+}
@@ -0,0 +1,109 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __DIRECTORY_SCANNER__
+#define __DIRECTORY_SCANNER__
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <ctime>
+#include "util_functions.h"
+
+//! 画像フォルダの走査
+/*!
+サブフォルダを複数スレッドで並列に走査し、拡張子で絞り込んだ画像ファイルを自然順に並べる。
+各フォルダの更新時刻をキャッシュファイルに記録し、次回は変更のあったフォルダのみを読み直す
+*/
+class DirectoryScanner
+{
+public:
+	DirectoryScanner();
+
+	//! フォルダから画像ファイル一覧を取得
+	/*!
+	\param[in] root 画像フォルダ
+	\param[out] files 画像ファイルへのパス（自然順）
+	\param[in] progress 進捗通知関数
+	\return 走査の成否（フォルダが存在しない場合や中断された場合はfalse）
+	*/
+	bool Scan(const std::string& root, std::vector<std::string>& files,
+		const util::ProgressCallback& progress = util::ProgressCallback()) const;
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	//! フォルダ1つ分の走査結果
+	struct DirEntry{
+		std::time_t mtime;	//!< フォルダの更新時刻
+		std::vector<std::string> subdirs;	//!< サブフォルダ名
+		std::vector<std::string> files;	//!< 画像ファイル名
+	};
+	typedef std::map<std::string, DirEntry> DirCache;
+
+	/////// パラメータ /////////////
+	bool _RECURSIVE;	//!< サブフォルダも走査するかどうか
+	std::set<std::string> _extensions;	//!< 対象とする拡張子（小文字、ドット付き）
+	int _num_threads;	//!< 走査スレッド数（0の場合はCPU数）
+	std::string _cache_file;	//!< キャッシュファイル名（空の場合はキャッシュしない）
+	///////////////////////////////////
+
+	//! フォルダ1つを走査
+	/*!
+	キャッシュ作成後に更新されていないフォルダはキャッシュの内容を使う
+	*/
+	bool ScanDirectory(const std::string& dir, const DirCache& cache, std::time_t cache_time, DirEntry& entry) const;
+
+	//! 対象の拡張子かどうか
+	bool MatchExtension(const std::string& ext) const;
+
+	//! 拡張子リストを文字列に変換（例: ".jpg,.png"）
+	std::string ExtensionString() const;
+
+	//! キャッシュファイルの読み込み
+	bool LoadCache(const std::string& root, DirCache& cache, std::time_t& cache_time) const;
+
+	//! キャッシュファイルの保存
+	bool SaveCache(const std::string& root, const DirCache& cache, std::time_t scan_time) const;
+};
+
+#endif
@@ -0,0 +1,184 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "DisplayBackend.h"
+#include <opencv2/highgui/highgui.hpp>
+
+
+HighGuiBackend& HighGuiBackend::Instance()
+{
+	static HighGuiBackend backend;
+	return backend;
+}
+
+
+void HighGuiBackend::OpenWindow(const std::string& window_name, MouseCallback callback, void* param)
+{
+	cv::namedWindow(window_name);
+	cv::setMouseCallback(window_name, callback, param);
+}
+
+
+void HighGuiBackend::CloseWindow(const std::string& window_name)
+{
+	cv::destroyWindow(window_name);
+}
+
+
+void HighGuiBackend::ShowImage(const std::string& window_name, const cv::Mat& image)
+{
+	cv::imshow(window_name, image);
+}
+
+
+int HighGuiBackend::WaitKey(int delay)
+{
+	return cv::waitKey(delay);
+}
+
+
+int HighGuiBackend::WaitInput(int delay)
+{
+	// cv::waitKey(0)はマウス操作では戻らないため、短い間隔で待つ
+	const int POLL_MSEC = 30;
+	return cv::waitKey(delay > 0 ? delay : POLL_MSEC);
+}
+
+
+OffscreenBackend::OffscreenBackend()
+{
+	_callback = 0;
+	_callback_param = 0;
+	_frame_count = 0;
+}
+
+
+void OffscreenBackend::OpenWindow(const std::string& window_name, MouseCallback callback, void* param)
+{
+	_window_name = window_name;
+	_callback = callback;
+	_callback_param = param;
+}
+
+
+void OffscreenBackend::CloseWindow(const std::string& window_name)
+{
+	if (window_name != _window_name)
+		return;
+	_window_name = std::string();
+	_callback = 0;
+	_callback_param = 0;
+}
+
+
+void OffscreenBackend::ShowImage(const std::string& /*window_name*/, const cv::Mat& image)
+{
+	// 描画用バッファは次の描画で上書きされるため複製して保持
+	image.copyTo(_frame);
+	_frame_count++;
+}
+
+
+int OffscreenBackend::WaitKey(int /*delay*/)
+{
+	while (!_events.empty()){
+		InputEvent input = _events.front();
+		_events.pop_front();
+		if (input.type == KEY_EVENT)
+			return input.code;
+		DispatchMouse(input);
+	}
+	return -1;
+}
+
+
+int OffscreenBackend::WaitInput(int /*delay*/)
+{
+	if (_events.empty())
+		return -1;
+	InputEvent input = _events.front();
+	_events.pop_front();
+	if (input.type == KEY_EVENT)
+		return input.code;
+	DispatchMouse(input);
+	return -1;
+}
+
+
+void OffscreenBackend::PostKey(int key)
+{
+	InputEvent input;
+	input.type = KEY_EVENT;
+	input.code = key;
+	input.x = input.y = input.flag = 0;
+	_events.push_back(input);
+}
+
+
+void OffscreenBackend::PostMouse(int event, int x, int y, int flag)
+{
+	InputEvent input;
+	input.type = MOUSE_EVENT;
+	input.code = event;
+	input.x = x;
+	input.y = y;
+	input.flag = flag;
+	_events.push_back(input);
+}
+
+
+void OffscreenBackend::PostDrag(const cv::Point& from, const cv::Point& to, int steps)
+{
+	// 移動時のフラグはMarkerViewer::on_mouseの判定に合わせる
+#ifdef WIN32
+	const int drag_flag = CV_EVENT_FLAG_LBUTTON;
+#else
+	const int drag_flag = 33;
+#endif
+	if (steps < 1)
+		steps = 1;
+	PostMouse(CV_EVENT_LBUTTONDOWN, from.x, from.y, CV_EVENT_FLAG_LBUTTON);
+	for (int i = 1; i <= steps; i++){
+		int x = from.x + (to.x - from.x) * i / steps;
+		int y = from.y + (to.y - from.y) * i / steps;
+		PostMouse(CV_EVENT_MOUSEMOVE, x, y, drag_flag);
+	}
+	PostMouse(CV_EVENT_LBUTTONUP, to.x, to.y, 0);
+}
+
+
+void OffscreenBackend::DispatchMouse(const InputEvent& input)
+{
+	if (_callback)
+		_callback(input.code, input.x, input.y, input.flag, _callback_param);
+}
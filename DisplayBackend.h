@@ -0,0 +1,174 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __DISPLAY_BACKEND__
+#define __DISPLAY_BACKEND__
+
+#include <opencv2/core/core.hpp>
+#include <deque>
+#include <string>
+
+//! 画面表示と入力の抽象クラス
+/*!
+MarkerViewerはHighGUIを直接呼ばずにこのクラスを介して表示し、キーとマウスの入力を受け取る
+*/
+class DisplayBackend
+{
+public:
+	//! マウス操作のコールバック関数（cv::MouseCallbackと同じ形式）
+	typedef void(*MouseCallback)(int event, int x, int y, int flag, void* param);
+
+	virtual ~DisplayBackend(){}
+
+	//! ウィンドウを開いてマウス操作のコールバック関数を登録
+	virtual void OpenWindow(const std::string& window_name, MouseCallback callback, void* param) = 0;
+
+	//! ウィンドウを閉じる
+	virtual void CloseWindow(const std::string& window_name) = 0;
+
+	//! 画像を表示
+	virtual void ShowImage(const std::string& window_name, const cv::Mat& image) = 0;
+
+	//! キー入力を取得
+	/*!
+	\param[in] delay 待ち時間(ms)。0の場合はキーが押されるまで待つ
+	\return 入力されたキー。タイムアウトした場合は-1
+	*/
+	virtual int WaitKey(int delay) = 0;
+
+	//! キー入力かマウス操作を待つ
+	/*!
+	クリックで選択する画面のように、マウス操作のたびに呼び出し側で処理が必要な場合に使う
+	\param[in] delay 待ち時間(ms)。0の場合はキーが押されるかマウス操作があるまで待つ
+	\return 入力されたキー。マウス操作があった場合やタイムアウトした場合は-1
+	*/
+	virtual int WaitInput(int delay) = 0;
+};
+
+
+//! HighGUIのウィンドウへの表示
+class HighGuiBackend : public DisplayBackend
+{
+public:
+	//! 共有インスタンスの取得
+	static HighGuiBackend& Instance();
+
+	void OpenWindow(const std::string& window_name, MouseCallback callback, void* param);
+	void CloseWindow(const std::string& window_name);
+	void ShowImage(const std::string& window_name, const cv::Mat& image);
+	int WaitKey(int delay);
+	int WaitInput(int delay);
+
+private:
+	HighGuiBackend(){}
+};
+
+
+//! メモリ上への表示
+/*!
+ウィンドウを開かずに最後に表示された画像を保持する。入力はPostKey、PostMouseで与えた順に処理し、
+入力がなければ待たずに-1を返す。ディスプレイのない環境での再生や計測に使用
+*/
+class OffscreenBackend : public DisplayBackend
+{
+public:
+	OffscreenBackend();
+
+	void OpenWindow(const std::string& window_name, MouseCallback callback, void* param);
+	void CloseWindow(const std::string& window_name);
+	void ShowImage(const std::string& window_name, const cv::Mat& image);
+	int WaitKey(int delay);
+	int WaitInput(int delay);
+
+	//! キー入力を追加
+	void PostKey(int key);
+
+	//! マウス操作を追加
+	/*!
+	WaitKeyの呼び出し時に、開いているウィンドウのコールバック関数へ渡す
+	*/
+	void PostMouse(int event, int x, int y, int flag);
+
+	//! 左ボタンでのドラッグを追加
+	/*!
+	ボタンを押し、steps回に分けて移動し、ボタンを離す操作を追加する
+	\param[in] from ドラッグの始点
+	\param[in] to ドラッグの終点
+	\param[in] steps 移動の回数
+	*/
+	void PostDrag(const cv::Point& from, const cv::Point& to, int steps);
+
+	//! 開いているウィンドウ名
+	const std::string& window_name() const{
+		return _window_name;
+	}
+
+	//! 最後に表示された画像
+	const cv::Mat& GetFrame() const{
+		return _frame;
+	}
+
+	//! 表示された回数
+	int frame_count() const{
+		return _frame_count;
+	}
+
+	//! 表示された回数のリセット
+	void ResetFrameCount(){
+		_frame_count = 0;
+	}
+
+protected:
+	//! 入力
+	struct InputEvent{
+		int type;	//!< KEY_EVENT またはMOUSE_EVENT
+		int code;	//!< キー、またはマウスのイベント
+		int x, y, flag;	//!< マウスの位置とフラグ
+	};
+	static const int KEY_EVENT = 0;
+	static const int MOUSE_EVENT = 1;
+
+	std::deque<InputEvent> _events;	//!< 未処理の入力
+
+	//! マウス操作をコールバック関数へ渡す
+	void DispatchMouse(const InputEvent& input);
+
+private:
+	std::string _window_name;	//!< 開いているウィンドウ
+	MouseCallback _callback;	//!< マウス操作のコールバック関数
+	void* _callback_param;	//!< コールバック関数の引数
+	cv::Mat _frame;	//!< 最後に表示された画像
+	int _frame_count;	//!< 表示された回数
+};
+
+#endif
@@ -0,0 +1,280 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "DuplicateFinder.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include "FileStampCache.hpp"
+#include <iostream>
+#include <algorithm>
+
+// 縮小デコード(IMREAD_REDUCED_*)はOpenCV 3.1以降で利用可能
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 1)
+#define HAVE_REDUCED_DECODE
+#endif
+
+namespace{
+	const char* CACHE_SIGNATURE = "#OMDHASH 1";
+
+	//! ハミング距離で探索するBK-tree
+	class BKTree
+	{
+	public:
+		//! ハッシュを追加し、そのノードのIDを返す（同じハッシュは同じノード）
+		int Insert(uint64 hash)
+		{
+			if (_nodes.empty()){
+				_nodes.push_back(Node(hash));
+				return 0;
+			}
+			int cur = 0;
+			while (true){
+				int dist = DuplicateFinder::HammingDistance(_nodes[cur].hash, hash);
+				if (dist == 0)
+					return cur;
+				int child = _nodes[cur].Child(dist);
+				if (child < 0){
+					_nodes.push_back(Node(hash));
+					_nodes[cur].children.push_back(std::make_pair(dist, (int)_nodes.size() - 1));
+					return _nodes.size() - 1;
+				}
+				cur = child;
+			}
+		}
+
+		//! hashから距離max_dist以内のノードを探索
+		void Search(uint64 hash, int max_dist, std::vector<int>& found) const
+		{
+			found.clear();
+			if (_nodes.empty())
+				return;
+			std::vector<int> stack(1, 0);
+			while (!stack.empty()){
+				const Node& node = _nodes[stack.back()];
+				int id = stack.back();
+				stack.pop_back();
+				int dist = DuplicateFinder::HammingDistance(node.hash, hash);
+				if (dist <= max_dist)
+					found.push_back(id);
+				// 三角不等式により、辺の距離が[dist - max_dist, dist + max_dist]の子のみを辿る
+				for (size_t i = 0; i < node.children.size(); i++){
+					int d = node.children[i].first;
+					if (d >= dist - max_dist && d <= dist + max_dist)
+						stack.push_back(node.children[i].second);
+				}
+			}
+		}
+
+		int size() const{
+			return _nodes.size();
+		}
+
+		uint64 hash(int id) const{
+			return _nodes[id].hash;
+		}
+
+	private:
+		struct Node{
+			uint64 hash;
+			std::vector<std::pair<int, int>> children;	// (距離, ノードID)
+			Node(uint64 h) : hash(h){}
+			int Child(int dist) const{
+				for (size_t i = 0; i < children.size(); i++){
+					if (children[i].first == dist)
+						return children[i].second;
+				}
+				return -1;
+			}
+		};
+		std::vector<Node> _nodes;
+	};
+}
+
+
+DuplicateFinder::DuplicateFinder()
+{
+	_mode = DEDUP_NONE;
+	_max_distance = 4;
+	_num_threads = 0;
+	_thumbnails = NULL;
+}
+
+
+int DuplicateFinder::HammingDistance(uint64 a, uint64 b)
+{
+	uint64 x = a ^ b;
+	x = x - ((x >> 1) & 0x5555555555555555ULL);
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+
+bool DuplicateFinder::ComputeHash(const std::string& filename, uint64& hash)
+{
+	// 8x8の差分を取るだけなので、縮小デコードで十分
+#ifdef HAVE_REDUCED_DECODE
+	cv::Mat img = cv::imread(filename, cv::IMREAD_REDUCED_GRAYSCALE_8);
+#else
+	cv::Mat img = cv::imread(filename, CV_LOAD_IMAGE_GRAYSCALE);
+#endif
+	return ComputeHash(img, hash);
+}
+
+
+bool DuplicateFinder::ComputeHash(const cv::Mat& gray, uint64& hash)
+{
+	if (gray.empty())
+		return false;
+
+	// 9x8に縮小し、横に隣り合う画素の大小を64bitに並べる
+	cv::Mat small;
+	cv::resize(gray, small, cv::Size(9, 8), 0, 0, cv::INTER_AREA);
+	hash = 0;
+	for (int y = 0; y < 8; y++){
+		const uchar* row = small.ptr<uchar>(y);
+		for (int x = 0; x < 8; x++){
+			hash <<= 1;
+			if (row[x] < row[x + 1])
+				hash |= 1;
+		}
+	}
+	return true;
+}
+
+
+bool DuplicateFinder::HashImage(const std::string& filename, uint64& hash) const
+{
+	if (!_thumbnails)
+		return ComputeHash(filename, hash);
+
+	cv::Mat thumb, gray;
+	cv::Size org_size;
+	if (!_thumbnails->Get(filename, thumb, org_size))
+		return false;
+	cv::cvtColor(thumb, gray, CV_BGR2GRAY);
+	return ComputeHash(gray, hash);
+}
+
+
+bool DuplicateFinder::Find(const ImageList& file_list, std::vector<std::vector<int>>& groups, const util::ProgressCallback& progress) const
+{
+	groups.clear();
+
+	// 画像ごとのハッシュ（サイズと更新時刻がキャッシュと一致すれば再利用）
+	util::FileStampCache<uint64> cache(_cache_file, CACHE_SIGNATURE, util::ReadHexHash, util::WriteHexHash);
+	std::vector<uint64> hashes;
+	std::vector<char> valid;
+	auto compute = [this](const std::string& path, uint64& hash){
+		return HashImage(path, hash);
+	};
+	if (!cache.Update(file_list, compute, _num_threads, hashes, valid, progress))
+		return false;
+	int num_files = file_list.size();
+
+	// 画像IDの順に、閾値以内で最も近い代表画像のグループに加え、なければ新しい代表画像とする。
+	// 隣り合う画像どうしで推移的にまとめると、ゆっくり変化する連続フレームが1つのグループに連なってしまうため、
+	// 各グループの画像は全て代表画像から閾値以内とする
+	BKTree leaders;	// 代表画像のハッシュ（ノードIDがグループ番号）
+	std::vector<std::vector<int>> all_groups;
+	std::vector<int> found;
+	for (int i = 0; i < num_files; i++){
+		if (!valid[i])
+			continue;
+		leaders.Search(hashes[i], _max_distance, found);
+		int best = -1;
+		int best_dist = _max_distance + 1;
+		for (size_t k = 0; k < found.size(); k++){
+			int dist = HammingDistance(leaders.hash(found[k]), hashes[i]);
+			if (dist < best_dist || (dist == best_dist && found[k] < best)){
+				best = found[k];
+				best_dist = dist;
+			}
+		}
+		if (best < 0){
+			best = leaders.Insert(hashes[i]);
+			all_groups.push_back(std::vector<int>());
+		}
+		all_groups[best].push_back(i);
+	}
+
+	// 2枚以上のグループのみを返す
+	for (size_t g = 0; g < all_groups.size(); g++){
+		if (all_groups[g].size() > 1)
+			groups.push_back(all_groups[g]);
+	}
+	return true;
+}
+
+
+//! パラメータ読み込み
+void DuplicateFinder::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	_mode = fn["dedup_mode"];
+	if (_mode < DEDUP_NONE || _mode > DEDUP_COPY)
+		_mode = DEDUP_NONE;
+	if (!fn["dedup_distance"].empty())
+		fn["dedup_distance"] >> _max_distance;
+	if (_max_distance < 0)
+		_max_distance = 4;
+	fn["dedup_cache_file"] >> _cache_file;
+	_num_threads = fn["dedup_threads"];
+}
+
+
+//! パラメータ書き込み
+void DuplicateFinder::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	cvWriteComment(fs.fs, "0:NONE, 1:SKIP, 2:COPY", 0);
+	fs << "dedup_mode" << _mode;
+	fs << "dedup_distance" << _max_distance;
+	fs << "dedup_cache_file" << _cache_file;
+	fs << "dedup_threads" << _num_threads;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void DuplicateFinder::PrintStatus() const
+{
+	const char* modes[] = { "検出しない", "飛ばす", "マーカーを複製" };
+	std::cout << "重複画像の扱い： " << modes[_mode] << std::endl;
+	if (_mode != DEDUP_NONE)
+		std::cout << "重複とみなす距離： " << _max_distance << std::endl;
+}
@@ -0,0 +1,118 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __DUPLICATE_FINDER__
+#define __DUPLICATE_FINDER__
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+#include "ImageList.h"
+#include "util_functions.h"
+#include "ThumbnailCache.h"
+
+//! ほぼ同じ画像の検出
+/*!
+各画像を縮小デコードして64bitの差分ハッシュ(dHash)を複数スレッドで計算し、キャッシュファイルに記録する。
+各グループの代表画像をBK-treeで探索し、ハッシュのハミング距離が閾値以下で最も近い代表画像のグループにまとめる
+*/
+class DuplicateFinder
+{
+public:
+	//////////// 重複画像の扱い //////////////
+	const static int DEDUP_NONE = 0;	//!< 検出しない
+	const static int DEDUP_SKIP = 1;	//!< 次の画像へ進む際に重複画像を飛ばす
+	const static int DEDUP_COPY = 2;	//!< 代表画像のマーカーを重複画像へ複製する
+	////////////////////////////////////////
+
+	DuplicateFinder();
+
+	//! 重複画像の扱い
+	int mode() const{
+		return _mode;
+	}
+
+	//! 画像一覧から重複画像のグループを検出
+	/*!
+	\param[in] file_list 画像一覧
+	\param[out] groups 2枚以上の画像からなるグループ（各グループの画像IDは昇順で、先頭が代表画像。
+	どの画像も代表画像からの距離は閾値以下）
+	\param[in] progress 進捗通知関数
+	\return 検出の成否（中断された場合はfalse）
+	*/
+	bool Find(const ImageList& file_list, std::vector<std::vector<int>>& groups,
+		const util::ProgressCallback& progress = util::ProgressCallback()) const;
+
+	//! ハッシュの計算に使う縮小画像のキャッシュの設定
+	/*!
+	設定した場合は原画像の代わりに縮小画像から計算し、キャッシュにない縮小画像はその場で作成される。
+	thumbnailsは呼び出し側で保持すること
+	\param[in] thumbnails 縮小画像のキャッシュ。NULLの場合は原画像を縮小デコードする
+	*/
+	void SetThumbnailCache(ThumbnailCache* thumbnails){
+		_thumbnails = thumbnails;
+	}
+
+	//! 画像ファイルの差分ハッシュを計算
+	static bool ComputeHash(const std::string& filename, uint64& hash);
+
+	//! グレースケール画像の差分ハッシュを計算
+	static bool ComputeHash(const cv::Mat& gray, uint64& hash);
+
+	//! ハッシュのハミング距離
+	static int HammingDistance(uint64 a, uint64 b);
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	ThumbnailCache* _thumbnails;	//!< ハッシュの計算に使う縮小画像のキャッシュ
+
+	/////// パラメータ /////////////
+	int _mode;	//!< 重複画像の扱い
+	int _max_distance;	//!< 重複とみなすハミング距離
+	std::string _cache_file;	//!< キャッシュファイル名（空の場合はキャッシュしない）
+	int _num_threads;	//!< 計算スレッド数（0の場合はCPU数）
+	///////////////////////////////////
+
+	//! 縮小画像のキャッシュがあればそれを使って差分ハッシュを計算
+	bool HashImage(const std::string& filename, uint64& hash) const;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "FileNameIndex.h"
+#include <boost/filesystem/path.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace{
+	//! 小文字に変換
+	std::string ToLower(const std::string& str)
+	{
+		std::string dst = str;
+		for (size_t i = 0; i < dst.size(); i++)
+			dst[i] = tolower((unsigned char)dst[i]);
+		return dst;
+	}
+}
+
+
+FileNameIndex::FileNameIndex()
+{
+}
+
+
+bool FileNameIndex::Build(const ImageList& file_list, const util::ProgressCallback& progress)
+{
+	_text.clear();
+	_name_offsets.clear();
+	_suffixes.clear();
+
+	int num_files = file_list.size();
+	_name_offsets.reserve(num_files);
+	std::string path;
+	for (int i = 0; i < num_files; i++){
+		file_list.Get(i, path);
+		std::string name = ToLower(boost::filesystem::path(path).filename().string());
+		_name_offsets.push_back(_text.size());
+		_text += name;
+		_text += '\0';
+		if (i % 100000 == 0 && !util::ReportProgress(progress, i, num_files * 2))
+			return false;
+	}
+
+	// 区切りの'\0'以外の各位置から始まる接尾辞を辞書順に並べる。
+	// 比較は'\0'で止まるため、ファイル名をまたがない
+	_suffixes.reserve(_text.size() - num_files);
+	for (unsigned int pos = 0; pos < _text.size(); pos++){
+		if (_text[pos] != '\0')
+			_suffixes.push_back(pos);
+	}
+	const char* text = _text.c_str();
+	std::sort(_suffixes.begin(), _suffixes.end(), [text](unsigned int a, unsigned int b){
+		int cmp = strcmp(text + a, text + b);
+		return (cmp != 0) ? (cmp < 0) : (a < b);
+	});
+	return util::ReportProgress(progress, num_files * 2, num_files * 2);
+}
+
+
+int FileNameIndex::ImageIndex(unsigned int pos) const
+{
+	return (int)(std::upper_bound(_name_offsets.begin(), _name_offsets.end(), pos) - _name_offsets.begin()) - 1;
+}
+
+
+void FileNameIndex::Search(const std::string& pattern, bool prefix, std::vector<int>& indices) const
+{
+	indices.clear();
+	std::string key = ToLower(pattern);
+	if (key.empty() || key.find('\0') != std::string::npos)
+		return;
+
+	// keyで始まる接尾辞の範囲を二分探索
+	const char* text = _text.c_str();
+	size_t len = key.size();
+	std::vector<unsigned int>::const_iterator begin = std::lower_bound(_suffixes.begin(), _suffixes.end(), key,
+		[text, len](unsigned int pos, const std::string& k){
+			return strncmp(text + pos, k.c_str(), len) < 0;
+		});
+	std::vector<unsigned int>::const_iterator end = std::upper_bound(begin, _suffixes.end(), key,
+		[text, len](const std::string& k, unsigned int pos){
+			return strncmp(k.c_str(), text + pos, len) < 0;
+		});
+
+	for (std::vector<unsigned int>::const_iterator it = begin; it != end; it++){
+		int idx = ImageIndex(*it);
+		// 前方一致の場合はファイル名の先頭から一致したもののみ
+		if (prefix && _name_offsets[idx] != *it)
+			continue;
+		indices.push_back(idx);
+	}
+	std::sort(indices.begin(), indices.end());
+	indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
@@ -0,0 +1,82 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __FILE_NAME_INDEX__
+#define __FILE_NAME_INDEX__
+
+#include <string>
+#include <vector>
+#include "ImageList.h"
+#include "util_functions.h"
+
+//! ファイル名の検索索引
+/*!
+全画像のファイル名（フォルダ名を除く）を小文字にして連結し、その接尾辞配列を作る。
+部分一致と前方一致の検索を二分探索で行う。大文字と小文字は区別しない
+*/
+class FileNameIndex
+{
+public:
+	FileNameIndex();
+
+	//! 画像一覧から作成
+	/*!
+	\param[in] file_list 画像一覧
+	\param[in] progress 進捗通知関数
+	\return 作成の成否（中断された場合はfalse）
+	*/
+	bool Build(const ImageList& file_list, const util::ProgressCallback& progress = util::ProgressCallback());
+
+	//! ファイル名の検索
+	/*!
+	\param[in] pattern 検索する文字列
+	\param[in] prefix trueの場合は前方一致、falseの場合は部分一致
+	\param[out] indices 一致した画像ID（昇順）
+	*/
+	void Search(const std::string& pattern, bool prefix, std::vector<int>& indices) const;
+
+	//! 画像数
+	int size() const{
+		return _name_offsets.size();
+	}
+
+private:
+	std::string _text;	//!< 小文字にしたファイル名を'\0'区切りで連結した文字列
+	std::vector<unsigned int> _name_offsets;	//!< 各画像のファイル名の_text上の開始位置
+	std::vector<unsigned int> _suffixes;	//!< 接尾辞配列（_text上の位置を接尾辞の辞書順に並べたもの）
+
+	//! _text上の位置を含むファイル名の画像ID
+	int ImageIndex(unsigned int pos) const;
+};
+
+#endif
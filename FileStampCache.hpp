@@ -0,0 +1,260 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __FILE_STAMP_CACHE__
+#define __FILE_STAMP_CACHE__
+
+#include <opencv2/core/core.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <ctime>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "ImageList.h"
+#include "util_functions.h"
+
+namespace util{
+
+	//! 64bitハッシュを16進でキャッシュファイルから読み込む
+	inline bool ReadHexHash(std::istream& is, uint64& hash){
+		is >> std::hex >> hash >> std::dec;
+		return !is.fail();
+	}
+
+	//! 64bitハッシュを16進でキャッシュファイルへ書き込む
+	inline void WriteHexHash(std::ostream& os, const uint64& hash){
+		os << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec;
+	}
+
+	//! パス、サイズ、更新時刻をキーとするファイルごとの計算結果のキャッシュ
+	/*!
+	画像一覧の各ファイルを複数スレッドで調べ、サイズと更新時刻がキャッシュと一致すれば記録された値を再利用し、
+	それ以外は計算し直す。キャッシュファイルは1行目が識別子、以降は1行に「値 サイズ 更新時刻 パス」。
+	キャッシュには画像一覧にないパスの記録も残る
+	*/
+	template <typename T>
+	class FileStampCache
+	{
+	public:
+		//! 値の読み込み関数
+		typedef std::function<bool(std::istream& is, T& value)> ReadFunc;
+
+		//! 値の書き込み関数
+		typedef std::function<void(std::ostream& os, const T& value)> WriteFunc;
+
+		//! ファイル1つ分の値の計算関数（複数スレッドから呼ばれる）
+		typedef std::function<bool(const std::string& path, T& value)> ComputeFunc;
+
+		//! ファイル1つ分の記録
+		struct Entry{
+			T value;	//!< 計算結果
+			uintmax_t size;	//!< ファイルサイズ
+			std::time_t mtime;	//!< 更新時刻
+		};
+		typedef std::unordered_map<std::string, Entry> EntryMap;
+
+		//! コンストラクタ
+		/*!
+		\param[in] cache_file キャッシュファイル名（空の場合は読み書きしない）
+		\param[in] signature キャッシュファイルの1行目
+		\param[in] read 値の読み込み関数
+		\param[in] write 値の書き込み関数
+		*/
+		FileStampCache(const std::string& cache_file, const std::string& signature, const ReadFunc& read, const WriteFunc& write)
+			: _cache_file(cache_file), _signature(signature), _read(read), _write(write){}
+
+		//! 画像一覧の各ファイルの値を取得
+		/*!
+		キャッシュを読み込み、新しいファイルや変更されたファイルのみを計算して、計算した場合はキャッシュを保存する
+		\param[in] file_list 画像一覧
+		\param[in] compute 値の計算関数
+		\param[in] num_threads スレッド数（0の場合はCPU数）
+		\param[out] values 各ファイルの値
+		\param[out] valid 各ファイルの値が得られたかどうか
+		\param[in] progress 進捗通知関数
+		\return 取得の成否（中断された場合はfalse）
+		*/
+		bool Update(const ImageList& file_list, const ComputeFunc& compute, int num_threads,
+			std::vector<T>& values, std::vector<char>& valid, const ProgressCallback& progress = ProgressCallback())
+		{
+			Load();
+
+			// ファイルごとの結果（サイズと更新時刻がキャッシュと一致すれば再利用）
+			int num_files = file_list.size();
+			std::vector<std::string> paths(num_files);
+			std::vector<Entry> entries(num_files);
+			values.assign(num_files, T());
+			valid.assign(num_files, 0);
+			std::atomic<int> next_idx(0);
+			std::atomic<int> num_done(0);
+			std::atomic<int> num_computed(0);
+			std::atomic<bool> cancel(false);
+
+			auto worker = [&](){
+				std::string path;
+				while (!cancel.load()){
+					int idx = next_idx++;
+					if (idx >= num_files)
+						break;
+					file_list.Get(idx, path);
+					paths[idx] = boost::filesystem::path(path).generic_string();
+
+					boost::system::error_code ec;
+					Entry& entry = entries[idx];
+					entry.size = boost::filesystem::file_size(path, ec);
+					if (!ec)
+						entry.mtime = boost::filesystem::last_write_time(path, ec);
+					if (!ec){
+						typename EntryMap::const_iterator it = _entries.find(paths[idx]);
+						if (it != _entries.end() && it->second.size == entry.size && it->second.mtime == entry.mtime){
+							entry.value = it->second.value;
+							valid[idx] = 1;
+						}
+						else if (compute(path, entry.value)){
+							valid[idx] = 1;
+							num_computed++;
+						}
+					}
+					if (valid[idx])
+						values[idx] = entry.value;
+					num_done++;
+				}
+			};
+
+			if (num_threads <= 0)
+				num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+			std::vector<std::thread> threads;
+			for (int i = 0; i < num_threads; i++)
+				threads.push_back(std::thread(worker));
+
+			while (num_done.load() < num_files && !cancel.load()){
+				std::this_thread::sleep_for(std::chrono::milliseconds(200));
+				if (!ReportProgress(progress, num_done.load(), num_files))
+					cancel = true;
+			}
+			for (size_t i = 0; i < threads.size(); i++)
+				threads[i].join();
+
+			if (cancel.load())
+				return false;
+
+			// 画像一覧にないパスも残したまま、キャッシュを更新
+			for (int i = 0; i < num_files; i++){
+				if (valid[i])
+					_entries[paths[i]] = entries[i];
+			}
+			if (num_computed.load() > 0 && !_cache_file.empty() && !Save())
+				std::cerr << "Fail to write cache file " << _cache_file << "." << std::endl;
+			return true;
+		}
+
+		//! キャッシュにある全てのパス（generic形式）の記録
+		const EntryMap& entries() const{
+			return _entries;
+		}
+
+	private:
+		std::string _cache_file;	//!< キャッシュファイル名
+		std::string _signature;	//!< キャッシュファイルの1行目
+		ReadFunc _read;	//!< 値の読み込み関数
+		WriteFunc _write;	//!< 値の書き込み関数
+		EntryMap _entries;	//!< パスごとの記録
+
+		//! キャッシュファイルの読み込み
+		bool Load()
+		{
+			_entries.clear();
+			if (_cache_file.empty())
+				return false;
+			std::ifstream ifs(_cache_file);
+			if (!ifs.is_open())
+				return false;
+
+			std::string buf;
+			if (!std::getline(ifs, buf) || buf != _signature)
+				return false;
+
+			while (std::getline(ifs, buf)){
+				std::istringstream iss(buf);
+				Entry entry;
+				long long mtime;
+				if (!_read(iss, entry.value))
+					continue;
+				iss >> entry.size >> mtime;
+				iss.ignore(1);
+				std::string path;
+				if (!iss || !std::getline(iss, path) || path.empty())
+					continue;
+				entry.mtime = (std::time_t)mtime;
+				_entries[path] = entry;
+			}
+			return true;
+		}
+
+		//! キャッシュファイルの保存
+		bool Save() const
+		{
+			// 書き込み途中で中断されてもキャッシュが壊れないよう、一時ファイルに書いてから置き換える
+			std::string tmp_file = _cache_file + ".tmp";
+			{
+				std::ofstream ofs(tmp_file);
+				if (!ofs.is_open())
+					return false;
+
+				ofs << _signature << "\n";
+				typename EntryMap::const_iterator it;
+				for (it = _entries.begin(); it != _entries.end(); it++){
+					_write(ofs, it->second.value);
+					ofs << " " << it->second.size << " " << (long long)it->second.mtime << " " << it->first << "\n";
+				}
+				if (!ofs)
+					return false;
+			}
+			boost::system::error_code ec;
+			boost::filesystem::rename(tmp_file, _cache_file, ec);
+			return !ec;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "ImageList.h"
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <iostream>
+
+
+struct ImageList::Data
+{
+	std::vector<std::string> files;	//!< フォルダの走査結果
+
+	boost::iostreams::mapped_file_source manifest;	//!< メモリマップした画像リストファイル
+	std::vector<size_t> offsets;	//!< 画像リストファイル中の各行の先頭位置
+
+	std::string video;	//!< 動画ファイル名
+	size_t num_frames;	//!< 動画のフレーム数
+
+	Data() : num_frames(0){}
+};
+
+
+ImageList::ImageList()
+{
+}
+
+
+ImageList::ImageList(const std::vector<std::string>& files)
+{
+	std::shared_ptr<Data> data = std::make_shared<Data>();
+	data->files = files;
+	_data = data;
+}
+
+
+void ImageList::Assign(std::vector<std::string>& files)
+{
+	std::shared_ptr<Data> data = std::make_shared<Data>();
+	data->files.swap(files);
+	_data = data;
+}
+
+
+void ImageList::AssignVideo(const std::string& video_file, size_t num_frames)
+{
+	std::shared_ptr<Data> data = std::make_shared<Data>();
+	data->video = video_file;
+	data->num_frames = num_frames;
+	_data = data;
+}
+
+
+bool ImageList::LoadManifest(const std::string& list_file)
+{
+	std::shared_ptr<Data> data = std::make_shared<Data>();
+	try{
+		data->manifest.open(list_file);
+	}
+	catch (std::exception& e){
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+	if (!data->manifest.is_open())
+		return false;
+
+	// 行頭の位置だけを記録（パスの文字列は参照時に作る）
+	const char* begin = data->manifest.data();
+	const char* end = begin + data->manifest.size();
+	const char* p = begin;
+	while (p < end){
+		const char* eol = (const char*)memchr(p, '\n', end - p);
+		if (!eol)
+			eol = end;
+		if (eol > p && *p != '#' && *p != '\r')
+			data->offsets.push_back(p - begin);
+		p = eol + 1;
+	}
+
+	_data = data;
+	return true;
+}
+
+
+size_t ImageList::size() const
+{
+	if (!_data)
+		return 0;
+	if (!_data->video.empty())
+		return _data->num_frames;
+	return _data->manifest.is_open() ? _data->offsets.size() : _data->files.size();
+}
+
+
+void ImageList::clear()
+{
+	_data.reset();
+}
+
+
+bool ImageList::is_manifest() const
+{
+	return _data && _data->manifest.is_open();
+}
+
+
+bool ImageList::is_video() const
+{
+	return _data && !_data->video.empty();
+}
+
+
+bool ImageList::ParseVideoFrame(const std::string& entry, std::string& video_file, int& frame)
+{
+	std::string::size_type pos = entry.rfind(VIDEO_FRAME_SEPARATOR);
+	if (pos == std::string::npos || pos + 1 >= entry.size())
+		return false;
+	for (std::string::size_type i = pos + 1; i < entry.size(); i++){
+		if (!isdigit((unsigned char)entry[i]))
+			return false;
+	}
+	video_file = entry.substr(0, pos);
+	frame = atoi(entry.c_str() + pos + 1);
+	return true;
+}
+
+
+void ImageList::Get(size_t idx, std::string& dst) const
+{
+	if (!_data->video.empty()){
+		std::ostringstream oss;
+		oss << _data->video << VIDEO_FRAME_SEPARATOR << idx;
+		dst = oss.str();
+		return;
+	}
+	if (!_data->manifest.is_open()){
+		dst = _data->files[idx];
+		return;
+	}
+
+	const char* begin = _data->manifest.data();
+	const char* end = begin + _data->manifest.size();
+	const char* p = begin + _data->offsets[idx];
+	const char* eol = (const char*)memchr(p, '\n', end - p);
+	if (!eol)
+		eol = end;
+	if (eol > p && *(eol - 1) == '\r')
+		eol--;
+	dst.assign(p, eol);
+}
+
+
+std::string ImageList::operator[](size_t idx) const
+{
+	std::string dst;
+	Get(idx, dst);
+	return dst;
+}
@@ -0,0 +1,120 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __IMAGE_LIST__
+#define __IMAGE_LIST__
+
+#include <string>
+#include <vector>
+#include <memory>
+
+//! 画像ファイルへのパスのリスト
+/*!
+フォルダの走査結果、または画像リストファイル（1行に1つのパス）を保持する。
+画像リストファイルはメモリマップして各行の先頭位置のみを索引化し、パスの文字列は参照時に作る。
+内容は変更されないため、コピーは内部データを共有し、複数スレッドから参照できる
+*/
+class ImageList
+{
+public:
+	const static char VIDEO_FRAME_SEPARATOR = '@';	//!< 動画ファイル名とフレーム番号の区切り
+
+public:
+	ImageList();
+
+	//! パスのリストから作成
+	ImageList(const std::vector<std::string>& files);
+
+	//! パスのリストを設定（filesの中身は移される）
+	void Assign(std::vector<std::string>& files);
+
+	//! 画像リストファイルの読み込み
+	/*!
+	空行と'#'で始まる行は無視する
+	\param[in] list_file 画像リストファイル名
+	\return 読み込みの成否
+	*/
+	bool LoadManifest(const std::string& list_file);
+
+	//! 動画ファイルの各フレームを画像として設定
+	/*!
+	各画像のパスは"動画ファイル名@フレーム番号"となる（フレーム番号は0始まり）
+	\param[in] video_file 動画ファイル名
+	\param[in] num_frames フレーム数
+	*/
+	void AssignVideo(const std::string& video_file, size_t num_frames);
+
+	//! 画像の数
+	size_t size() const;
+
+	bool empty() const{
+		return size() == 0;
+	}
+
+	void clear();
+
+	//! idx番目の画像へのパス
+	std::string operator[](size_t idx) const;
+
+	//! idx番目の画像へのパスを取得
+	/*!
+	dstのバッファを再利用するため、全件を走査する場合に使う
+	*/
+	void Get(size_t idx, std::string& dst) const;
+
+	//! 画像リストファイルから読み込んだかどうか
+	bool is_manifest() const;
+
+	//! 動画ファイルのフレームかどうか
+	bool is_video() const;
+
+	//! 同じ一覧（コピー元またはコピー先）かどうか
+	bool shares(const ImageList& other) const{
+		return _data == other._data;
+	}
+
+	//! 動画フレームのパスを動画ファイル名とフレーム番号に分解
+	/*!
+	\param[in] entry 画像へのパス
+	\param[out] video_file 動画ファイル名
+	\param[out] frame フレーム番号
+	\return 動画フレームのパスかどうか
+	*/
+	static bool ParseVideoFrame(const std::string& entry, std::string& video_file, int& frame);
+
+private:
+	struct Data;
+	std::shared_ptr<const Data> _data;
+};
+
+#endif
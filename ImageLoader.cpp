@@ -0,0 +1,323 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "ImageLoader.h"
+#include "MatPool.h"
+#include "ImageList.h"
+#include "LatencyProfiler.h"
+#include "ImageProbe.h"
+#include <opencv2/highgui/highgui.hpp>
+#include <iostream>
+#include <fstream>
+
+// 縮小デコード(IMREAD_REDUCED_*)はOpenCV 3.1以降で利用可能
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 1)
+#define HAVE_REDUCED_DECODE
+#endif
+
+
+ImageLoader::ImageLoader()
+{
+	_request_id = 0;
+	_result_id = 0;
+	_pending = false;
+	_quit = false;
+
+	_PROGRESSIVE = true;
+	_preview_reduce = 8;
+	_thumbnails = NULL;
+
+	_worker = std::thread(&ImageLoader::WorkerLoop, this);
+}
+
+
+ImageLoader::~ImageLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_cond.notify_all();
+	_worker.join();
+}
+
+
+void ImageLoader::SetThumbnailCache(ThumbnailCache* thumbnails)
+{
+	_thumbnails = thumbnails;
+}
+
+
+int ImageLoader::ReduceFlag(int reduce)
+{
+#ifdef HAVE_REDUCED_DECODE
+	if (reduce >= 8)
+		return cv::IMREAD_REDUCED_COLOR_8;
+	else if (reduce >= 4)
+		return cv::IMREAD_REDUCED_COLOR_4;
+	else if (reduce >= 2)
+		return cv::IMREAD_REDUCED_COLOR_2;
+#else
+	(void)reduce;
+#endif
+	return cv::IMREAD_COLOR;
+}
+
+
+cv::Mat ImageLoader::Decode(const std::string& filename, int flag, std::vector<uchar>& buffer, cv::Size& last_size)
+{
+	std::ifstream ifs(filename, std::ios::binary);
+	if (!ifs.is_open())
+		return cv::Mat();
+
+	ifs.seekg(0, std::ios::end);
+	size_t file_size = (size_t)ifs.tellg();
+	ifs.seekg(0, std::ios::beg);
+	if (file_size == 0)
+		return cv::Mat();
+	buffer.resize(file_size);
+	ifs.read((char*)&buffer[0], file_size);
+
+	MatPool& pool = MatPool::Instance();
+	cv::Mat dst;
+	if (last_size.area() > 0)
+		dst = pool.Acquire(last_size, CV_8UC3);
+	cv::Mat acquired = dst;
+
+	cv::imdecode(buffer, flag, &dst);
+	if (dst.data != acquired.data){
+		// サイズが異なり、imdecode内で確保し直された
+		pool.Release(acquired);
+		if (!dst.empty())
+			pool.CountAllocation(dst);
+	}
+	if (dst.empty())
+		return cv::Mat();
+
+	last_size = dst.size();
+	return dst;
+}
+
+
+cv::Mat ImageLoader::LoadVideoFrame(int frame)
+{
+	MatPool& pool = MatPool::Instance();
+	cv::Mat dst;
+	if (_last_size.area() > 0)
+		dst = pool.Acquire(_last_size, CV_8UC3);
+	cv::Mat acquired = dst;
+
+	if (!_video.Read(frame, dst))
+		dst.release();
+	if (dst.data != acquired.data){
+		pool.Release(acquired);
+		if (!dst.empty())
+			pool.CountAllocation(dst);
+	}
+	if (dst.empty())
+		return cv::Mat();
+
+	_last_size = dst.size();
+	return dst;
+}
+
+
+bool ImageLoader::Load(const std::string& filename, double display_scale, cv::Mat& image, cv::Size& org_size)
+{
+	{
+		// 以前のリクエストを無効化
+		std::lock_guard<std::mutex> lock(_mutex);
+		_request_id++;
+		_pending = false;
+		_result.release();
+	}
+
+	// 動画フレーム
+	std::string video_file;
+	int frame;
+	if (ImageList::ParseVideoFrame(filename, video_file, frame)){
+		if (_video.path() != video_file && !_video.Open(video_file))
+			return false;
+		LATENCY_SCOPE(STAGE_DECODE_PREVIEW);
+		image = LoadVideoFrame(frame);
+		if (image.empty())
+			return false;
+		org_size = image.size();
+		return true;
+	}
+
+	// 縮小画像がキャッシュにあれば、デコードせずにプレビューとする（原画像サイズも正確）
+	if (_PROGRESSIVE && _thumbnails){
+		bool found;
+		{
+			LATENCY_SCOPE(STAGE_DECODE_PREVIEW);
+			found = _thumbnails->Find(filename, image, org_size);
+		}
+		if (found){
+			std::lock_guard<std::mutex> lock(_mutex);
+			_request_file = filename;
+			_pending = true;
+			_cond.notify_one();
+			return true;
+		}
+	}
+
+	int reduce = 1;
+	bool refine = false;
+#ifdef HAVE_REDUCED_DECODE
+	if (_PROGRESSIVE){
+		// 表示スケールに対して解像度が不足しない最大の縮小率
+		int display_reduce = 1;
+		while (display_reduce < 8 && display_reduce * 2 * display_scale <= 1.0)
+			display_reduce *= 2;
+		reduce = std::max(display_reduce, _preview_reduce);
+		refine = (reduce > display_reduce);
+	}
+#else
+	(void)display_scale;
+#endif
+
+	{
+		LATENCY_SCOPE(STAGE_DECODE_PREVIEW);
+		image = Decode(filename, ReduceFlag(reduce), _file_buffer, _last_size);
+	}
+	if (image.empty())
+		return false;
+
+	// 原画像サイズはヘッダから取得する。読めない場合は縮小画像から推定し（JPEGの縮小デコードは端数を
+	// 切り上げるため最大(reduce - 1)画素ずれる）、原寸画像を読み込んで正しいサイズに置き換える
+	if (reduce == 1)
+		org_size = image.size();
+	else if (!ImageProbe::ReadSize(filename, org_size)){
+		org_size = cv::Size(image.cols * reduce, image.rows * reduce);
+		refine = true;
+	}
+
+	if (refine){
+		std::lock_guard<std::mutex> lock(_mutex);
+		_request_file = filename;
+		_pending = true;
+		_cond.notify_one();
+	}
+	return true;
+}
+
+
+bool ImageLoader::is_pending() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _pending;
+}
+
+
+bool ImageLoader::Fetch(cv::Mat& image)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_pending || _result_id != _request_id)
+		return false;
+
+	image = _result;
+	_result.release();
+	_pending = false;
+	return !image.empty();
+}
+
+
+void ImageLoader::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true){
+		_cond.wait(lock, [this]{ return _quit || (_pending && _result_id != _request_id); });
+		if (_quit)
+			break;
+
+		int id = _request_id;
+		std::string filename = _request_file;
+		lock.unlock();
+
+		cv::Mat img;
+		{
+			LATENCY_SCOPE(STAGE_DECODE_FULL);
+			img = Decode(filename, cv::IMREAD_COLOR, _worker_buffer, _last_full_size);
+		}
+
+		lock.lock();
+		// デコード中に次の画像へ移動していれば結果は破棄
+		if (id == _request_id){
+			_result = img;
+			_result_id = id;
+			if (img.empty()){
+				std::cerr << "Fail to read file " << filename << "." << std::endl;
+				_pending = false;
+			}
+		}
+	}
+}
+
+
+//! パラメータ読み込み
+void ImageLoader::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	int progressive = fn["progressive"].empty() ? 1 : fn["progressive"];
+	_PROGRESSIVE = (progressive == 1) ? true : false;
+
+	if (!fn["preview_reduce"].empty())
+		fn["preview_reduce"] >> _preview_reduce;
+	if (_preview_reduce != 2 && _preview_reduce != 4 && _preview_reduce != 8)
+		_preview_reduce = 8;
+}
+
+
+//! パラメータ書き込み
+void ImageLoader::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "progressive" << (int)(_PROGRESSIVE ? 1 : 0);
+	fs << "preview_reduce" << _preview_reduce;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void ImageLoader::PrintStatus() const{
+#ifdef HAVE_REDUCED_DECODE
+	std::cout << "プレビュー表示： " << (_PROGRESSIVE ? "YES" : "NO") << " (1/" << _preview_reduce << ")" << std::endl;
+#else
+	std::cout << "プレビュー表示： NO (OpenCV 3.1以降が必要)" << std::endl;
+#endif
+}
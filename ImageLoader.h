@@ -0,0 +1,137 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __IMAGE_LOADER__
+#define __IMAGE_LOADER__
+
+#include <opencv2/core/core.hpp>
+#include "VideoSource.h"
+#include "ThumbnailCache.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//! 画像の段階的読み込み
+/*!
+縮小デコードしたプレビュー画像（縮小画像のキャッシュにあればその画像）をすぐに返し、原寸画像はバックグラウンドでデコードする。
+動画フレーム（"動画ファイル名@フレーム番号"）は開いた動画からその場でデコードする
+*/
+class ImageLoader
+{
+public:
+	ImageLoader();
+	~ImageLoader();
+
+	//! 画像の読み込み
+	/*!
+	プレビューが有効な場合は縮小デコードした画像を返し、原寸画像のデコードをバックグラウンドで開始する
+	\param[in] filename 画像ファイル名
+	\param[in] display_scale 画像の表示スケール
+	\param[out] image 読み込んだ画像（プレビューの場合は縮小画像）
+	\param[out] org_size 原画像のサイズ
+	\return 読み込みの成否
+	*/
+	bool Load(const std::string& filename, double display_scale, cv::Mat& image, cv::Size& org_size);
+
+	//! プレビューに使う縮小画像のキャッシュの設定
+	/*!
+	thumbnailsは呼び出し側で保持すること
+	\param[in] thumbnails 縮小画像のキャッシュ。NULLの場合は使わない
+	*/
+	void SetThumbnailCache(ThumbnailCache* thumbnails);
+
+	//! 原寸画像のデコード待ちかどうか
+	bool is_pending() const;
+
+	//! バックグラウンドでデコードされた原寸画像を取得
+	/*!
+	\param[out] image 原寸画像
+	\return 最新のリクエストに対する原寸画像が得られたかどうか
+	*/
+	bool Fetch(cv::Mat& image);
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	std::thread _worker;	//!< 原寸画像デコード用スレッド
+	mutable std::mutex _mutex;
+	std::condition_variable _cond;
+
+	std::string _request_file;	//!< デコード対象の画像ファイル
+	int _request_id;	//!< 最新のリクエストID
+	int _result_id;	//!< デコード済み画像のリクエストID
+	cv::Mat _result;	//!< デコード済みの原寸画像
+	bool _pending;	//!< 原寸画像の受け取り待ち
+	bool _quit;	//!< スレッド終了フラグ
+
+	ThumbnailCache* _thumbnails;	//!< プレビューに使う縮小画像のキャッシュ
+	VideoSource _video;	//!< 動画フレームの読み込み（UIスレッド）
+	std::vector<uchar> _file_buffer;	//!< ファイル読み込み用バッファ（UIスレッド）
+	std::vector<uchar> _worker_buffer;	//!< ファイル読み込み用バッファ（デコード用スレッド）
+	cv::Size _last_size;	//!< 直前にUIスレッドでデコードした画像のサイズ
+	cv::Size _last_full_size;	//!< 直前にデコード用スレッドでデコードした原寸画像のサイズ
+
+	/////// パラメータ /////////////
+	bool _PROGRESSIVE;	//!< プレビュー表示を行うかどうか
+	int _preview_reduce;	//!< プレビューの縮小率（1/2, 1/4, 1/8）
+	///////////////////////////////////
+
+	//! 原寸画像デコード用スレッドのループ
+	void WorkerLoop();
+
+	//! 縮小率に対応するimreadのフラグ
+	static int ReduceFlag(int reduce);
+
+	//! 開いている動画のフレームをプールのバッファへデコード
+	cv::Mat LoadVideoFrame(int frame);
+
+	//! 画像ファイルをプールのバッファへデコード
+	/*!
+	直前と同じサイズの画像であればバッファを再利用する
+	\param[in] filename 画像ファイル名
+	\param[in] flag imdecodeのフラグ
+	\param[in,out] buffer ファイル読み込み用バッファ
+	\param[in,out] last_size 直前にデコードした画像のサイズ
+	\return デコードした画像
+	*/
+	static cv::Mat Decode(const std::string& filename, int flag, std::vector<uchar>& buffer, cv::Size& last_size);
+};
+
+#endif
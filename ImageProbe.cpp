@@ -0,0 +1,253 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "ImageProbe.h"
+#include "FileStampCache.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+
+// imreadがEXIFの向きを適用するのはOpenCV 3.1以降
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 1)
+#define HAVE_EXIF_ORIENTATION
+#endif
+
+namespace{
+	const char* CACHE_SIGNATURE = "#OMSIZE 1";
+
+	//! キャッシュファイルの「幅 高さ」の読み込み
+	bool ReadCachedSize(std::istream& is, cv::Size& size)
+	{
+		is >> size.width >> size.height;
+		return !is.fail();
+	}
+
+	//! キャッシュファイルへの「幅 高さ」の書き込み
+	void WriteCachedSize(std::ostream& os, const cv::Size& size)
+	{
+		os << size.width << " " << size.height;
+	}
+
+	inline int ReadBE16(const unsigned char* p)
+	{
+		return (p[0] << 8) | p[1];
+	}
+
+	inline unsigned int ReadBE32(const unsigned char* p)
+	{
+		return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	}
+
+	inline int ReadLE16(const unsigned char* p)
+	{
+		return p[0] | (p[1] << 8);
+	}
+
+	inline int ReadLE32(const unsigned char* p)
+	{
+		return (int)(p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24));
+	}
+
+	//! PNG: シグネチャの直後のIHDRチャンクに幅と高さ（ビッグエンディアン）
+	bool ReadPngSize(std::istream& is, cv::Size& size)
+	{
+		unsigned char buf[24];
+		if (!is.read((char*)buf, sizeof(buf)) || memcmp(buf, "\x89PNG\r\n\x1a\n", 8) != 0 || memcmp(buf + 12, "IHDR", 4) != 0)
+			return false;
+		size = cv::Size(ReadBE32(buf + 16), ReadBE32(buf + 20));
+		return true;
+	}
+
+	//! BMP: 情報ヘッダに幅と高さ（リトルエンディアン、高さが負ならトップダウン）
+	bool ReadBmpSize(std::istream& is, cv::Size& size)
+	{
+		unsigned char buf[26];
+		if (!is.read((char*)buf, sizeof(buf)) || buf[0] != 'B' || buf[1] != 'M')
+			return false;
+		int header_size = ReadLE32(buf + 14);
+		if (header_size == 12)	// OS/2形式は16bit
+			size = cv::Size(ReadLE16(buf + 18), ReadLE16(buf + 20));
+		else
+			size = cv::Size(ReadLE32(buf + 18), std::abs(ReadLE32(buf + 22)));
+		return true;
+	}
+
+	//! JPEGのAPP1(Exif)セグメントから向き(1～8)を取得
+	int ReadExifOrientation(const std::vector<unsigned char>& data)
+	{
+		if (data.size() < 14 || memcmp(&data[0], "Exif\0\0", 6) != 0)
+			return 1;
+		const unsigned char* tiff = &data[6];
+		size_t tiff_size = data.size() - 6;
+		bool little = (tiff[0] == 'I' && tiff[1] == 'I');
+		if (!little && !(tiff[0] == 'M' && tiff[1] == 'M'))
+			return 1;
+		auto read16 = [&](size_t pos){ return little ? ReadLE16(tiff + pos) : ReadBE16(tiff + pos); };
+		auto read32 = [&](size_t pos){ return little ? (unsigned int)ReadLE32(tiff + pos) : ReadBE32(tiff + pos); };
+
+		// IFD0のエントリ（12バイトずつ）からOrientation(0x0112)を探す
+		size_t ifd = read32(4);
+		if (ifd + 2 > tiff_size)
+			return 1;
+		int num_entries = read16(ifd);
+		for (int i = 0; i < num_entries; i++){
+			size_t entry = ifd + 2 + 12 * i;
+			if (entry + 12 > tiff_size)
+				break;
+			if (read16(entry) == 0x0112)
+				return read16(entry + 8);
+		}
+		return 1;
+	}
+
+	//! JPEG: SOFセグメントに高さと幅（ビッグエンディアン）。それ以前のセグメントは読み飛ばす
+	bool ReadJpegSize(std::istream& is, cv::Size& size)
+	{
+		unsigned char buf[4];
+		if (!is.read((char*)buf, 2) || buf[0] != 0xFF || buf[1] != 0xD8)
+			return false;
+
+		int orientation = 1;
+		while (is.read((char*)buf, 2)){
+			if (buf[0] != 0xFF)
+				return false;
+			int marker = buf[1];
+			// 詰め物の0xFF
+			while (marker == 0xFF){
+				if (!is.read((char*)buf + 1, 1))
+					return false;
+				marker = buf[1];
+			}
+			// 長さを持たないマーカー
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+				continue;
+			if (marker == 0xD9 || marker == 0xDA)	// EOI, SOS（SOFより後）
+				return false;
+			if (!is.read((char*)buf, 2))
+				return false;
+			int length = ReadBE16(buf) - 2;
+			if (length < 0)
+				return false;
+
+			// SOF0～SOF15（DHT, JPG, DACを除く）
+			if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC){
+				unsigned char sof[5];
+				if (length < 5 || !is.read((char*)sof, sizeof(sof)))
+					return false;
+				size = cv::Size(ReadBE16(sof + 3), ReadBE16(sof + 1));
+				// 向きが5～8の場合は90度回転して読み込まれる
+				if (orientation >= 5 && orientation <= 8)
+					std::swap(size.width, size.height);
+				return true;
+			}
+#ifdef HAVE_EXIF_ORIENTATION
+			if (marker == 0xE1 && orientation == 1){
+				std::vector<unsigned char> data(length);
+				if (length > 0 && !is.read((char*)&data[0], length))
+					return false;
+				orientation = ReadExifOrientation(data);
+				continue;
+			}
+#endif
+			if (!is.seekg(length, std::ios::cur))
+				return false;
+		}
+		return false;
+	}
+}
+
+
+ImageProbe::ImageProbe()
+{
+	_num_threads = 0;
+}
+
+
+bool ImageProbe::ReadSize(const std::string& filename, cv::Size& size)
+{
+	std::ifstream ifs(filename, std::ios::binary);
+	if (!ifs.is_open())
+		return false;
+
+	// 先頭のバイトで形式を判定
+	int first = ifs.peek();
+	bool ok = false;
+	if (first == 0xFF)
+		ok = ReadJpegSize(ifs, size);
+	else if (first == 0x89)
+		ok = ReadPngSize(ifs, size);
+	else if (first == 'B')
+		ok = ReadBmpSize(ifs, size);
+	return ok && size.width > 0 && size.height > 0;
+}
+
+
+bool ImageProbe::Probe(const ImageList& file_list, std::vector<cv::Size>& sizes, const util::ProgressCallback& progress) const
+{
+	// ファイルごとの結果（サイズと更新時刻がキャッシュと一致すれば再利用）
+	util::FileStampCache<cv::Size> cache(_cache_file, CACHE_SIGNATURE, ReadCachedSize, WriteCachedSize);
+	std::vector<char> valid;
+	return cache.Update(file_list, ReadSize, _num_threads, sizes, valid, progress);
+}
+
+
+//! パラメータ読み込み
+void ImageProbe::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	fn["size_cache_file"] >> _cache_file;
+	_num_threads = fn["probe_threads"];
+}
+
+
+//! パラメータ書き込み
+void ImageProbe::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "size_cache_file" << _cache_file;
+	fs << "probe_threads" << _num_threads;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void ImageProbe::PrintStatus() const
+{
+	std::cout << "画像サイズのキャッシュ： " << (_cache_file.empty() ? "NO" : _cache_file) << std::endl;
+}
@@ -0,0 +1,89 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __IMAGE_PROBE__
+#define __IMAGE_PROBE__
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+#include "ImageList.h"
+#include "util_functions.h"
+
+//! 画像をデコードせずにサイズを調べるクラス
+/*!
+JPEG、PNG、BMPのヘッダのみを読んで幅と高さを取得する。OpenCVがEXIFの向きを適用するバージョンでは、
+JPEGの向きに応じて幅と高さを入れ替え、imreadで得られるサイズと一致させる。
+画像一覧の全画像を調べる場合は複数スレッドで読み、パス、サイズ、更新時刻とともにキャッシュファイルに記録する
+*/
+class ImageProbe
+{
+public:
+	ImageProbe();
+
+	//! 画像ファイルのヘッダから画像サイズを取得
+	/*!
+	\param[in] filename 画像ファイル名
+	\param[out] size 画像サイズ
+	\return 取得の成否（対応していない形式や壊れたヘッダの場合はfalse）
+	*/
+	static bool ReadSize(const std::string& filename, cv::Size& size);
+
+	//! 画像一覧の全画像のサイズを取得
+	/*!
+	キャッシュを読み込み、新しいファイルや変更されたファイルのみヘッダを読んでキャッシュを保存する
+	\param[in] file_list 画像一覧
+	\param[out] sizes 各画像のサイズ（取得できなかった画像は幅、高さとも0）
+	\param[in] progress 進捗通知関数
+	\return 取得の成否（中断された場合はfalse）
+	*/
+	bool Probe(const ImageList& file_list, std::vector<cv::Size>& sizes,
+		const util::ProgressCallback& progress = util::ProgressCallback()) const;
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	/////// パラメータ /////////////
+	std::string _cache_file;	//!< キャッシュファイル名（空の場合はキャッシュしない）
+	int _num_threads;	//!< 読み込みスレッド数（0の場合はCPU数）
+	///////////////////////////////////
+};
+
+#endif
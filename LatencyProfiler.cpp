@@ -0,0 +1,189 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "LatencyProfiler.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace{
+	const char* STAGE_NAMES[LatencyProfiler::NUM_STAGES] = {
+		"jump", "save_markers", "decode_preview", "decode_full", "open_resize", "redraw", "export", "crop"
+	};
+}
+
+
+LatencyProfiler& LatencyProfiler::Instance()
+{
+	static LatencyProfiler profiler;
+	return profiler;
+}
+
+
+LatencyProfiler::LatencyProfiler()
+{
+	_dump_file = "latency_profile.txt";
+	Reset();
+}
+
+
+int LatencyProfiler::BucketIndex(long long usec)
+{
+	if (usec < SUB_BUCKETS)
+		return (usec < 0) ? 0 : (int)usec;
+
+	// 最上位ビットの位置ごとに、続く4ビットで16分割
+	int exponent = 4;
+	while ((usec >> (exponent + 1)) > 0)
+		exponent++;
+	int index = SUB_BUCKETS + (exponent - 4) * SUB_BUCKETS + (int)((usec >> (exponent - 4)) & (SUB_BUCKETS - 1));
+	return std::min(index, NUM_BUCKETS - 1);
+}
+
+
+double LatencyProfiler::BucketValue(int index)
+{
+	if (index < SUB_BUCKETS)
+		return index;
+	int exponent = (index - SUB_BUCKETS) / SUB_BUCKETS + 4;
+	int sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+	double width = (double)(1LL << (exponent - 4));
+	return (SUB_BUCKETS + sub) * width + width / 2;
+}
+
+
+void LatencyProfiler::Record(Stage stage, long long usec)
+{
+	Histogram& hist = _histograms[stage];
+	hist.counts[BucketIndex(usec)].fetch_add(1, std::memory_order_relaxed);
+	hist.total.fetch_add(1, std::memory_order_relaxed);
+	hist.sum.fetch_add(usec, std::memory_order_relaxed);
+	long long max = hist.max.load(std::memory_order_relaxed);
+	while (usec > max && !hist.max.compare_exchange_weak(max, usec, std::memory_order_relaxed));
+}
+
+
+void LatencyProfiler::Reset()
+{
+	for (int s = 0; s < NUM_STAGES; s++){
+		Histogram& hist = _histograms[s];
+		for (int i = 0; i < NUM_BUCKETS; i++)
+			hist.counts[i] = 0;
+		hist.total = 0;
+		hist.sum = 0;
+		hist.max = 0;
+	}
+}
+
+
+double LatencyProfiler::Percentile(const Histogram& hist, unsigned long long total, double percent) const
+{
+	unsigned long long target = (unsigned long long)(total * percent / 100.0 + 0.5);
+	if (target < 1)
+		target = 1;
+	unsigned long long count = 0;
+	for (int i = 0; i < NUM_BUCKETS; i++){
+		count += hist.counts[i].load(std::memory_order_relaxed);
+		if (count >= target)
+			return std::min(BucketValue(i), (double)hist.max.load(std::memory_order_relaxed));
+	}
+	return (double)hist.max.load(std::memory_order_relaxed);
+}
+
+
+void LatencyProfiler::Print(std::ostream& os) const
+{
+#ifdef USE_LATENCY_PROFILE
+	os << "stage\tcount\tmean_ms\tp50_ms\tp90_ms\tp99_ms\tp99.9_ms\tmax_ms" << std::endl;
+	// std::coutにも出力するため、書式は元に戻す
+	std::ios::fmtflags flags = os.flags();
+	std::streamsize precision = os.precision();
+	os << std::fixed << std::setprecision(3);
+	for (int s = 0; s < NUM_STAGES; s++){
+		const Histogram& hist = _histograms[s];
+		unsigned long long total = hist.total.load(std::memory_order_relaxed);
+		os << STAGE_NAMES[s] << "\t" << total;
+		if (total > 0){
+			os << "\t" << hist.sum.load(std::memory_order_relaxed) / 1000.0 / total
+				<< "\t" << Percentile(hist, total, 50) / 1000.0
+				<< "\t" << Percentile(hist, total, 90) / 1000.0
+				<< "\t" << Percentile(hist, total, 99) / 1000.0
+				<< "\t" << Percentile(hist, total, 99.9) / 1000.0
+				<< "\t" << hist.max.load(std::memory_order_relaxed) / 1000.0;
+		}
+		os << std::endl;
+	}
+	os.flags(flags);
+	os.precision(precision);
+#else
+	os << "Latency profile is disabled at compile time (NO_LATENCY_PROFILE)." << std::endl;
+#endif
+}
+
+
+bool LatencyProfiler::Dump() const
+{
+#ifdef USE_LATENCY_PROFILE
+	if (_dump_file.empty())
+		return true;
+	std::ofstream ofs(_dump_file);
+	if (!ofs.is_open()){
+		std::cerr << "Fail to write latency profile " << _dump_file << "." << std::endl;
+		return false;
+	}
+	Print(ofs);
+	return ofs.good();
+#else
+	return true;
+#endif
+}
+
+
+//! パラメータ読み込み
+void LatencyProfiler::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+	fn["dump_file"] >> _dump_file;
+}
+
+
+//! パラメータ書き込み
+void LatencyProfiler::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "dump_file" << _dump_file;
+	fs << "}";
+}
@@ -0,0 +1,153 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __LATENCY_PROFILER__
+#define __LATENCY_PROFILER__
+
+#include <opencv2/core/core.hpp>
+#include <atomic>
+#include <ostream>
+#include <string>
+
+// NO_LATENCY_PROFILEを定義してビルドすると計測コードは全て取り除かれる
+#ifndef NO_LATENCY_PROFILE
+#define USE_LATENCY_PROFILE
+#endif
+
+//! 処理段階ごとの所要時間の計測
+/*!
+各段階の所要時間をHDR形式（2のべき乗ごとに16分割した対数線形の区間）のヒストグラムに記録する。
+記録はロックを取らず、全スレッドから呼び出せる
+*/
+class LatencyProfiler
+{
+public:
+	//! 計測する処理段階
+	enum Stage{
+		STAGE_JUMP,	//!< 画像の切り替え全体
+		STAGE_SAVE_MARKERS,	//!< マーカーのファイル書き込み
+		STAGE_DECODE_PREVIEW,	//!< 表示画像のデコード
+		STAGE_DECODE_FULL,	//!< 原寸画像のデコード（バックグラウンド）
+		STAGE_OPEN_RESIZE,	//!< 表示スケールへの縮小
+		STAGE_REDRAW,	//!< マーカーの再描画
+		STAGE_EXPORT,	//!< アノテーションファイルの出力
+		STAGE_CROP,	//!< 1画像分のマーカー領域の切り出し
+		NUM_STAGES
+	};
+
+	//! 共有インスタンスの取得
+	static LatencyProfiler& Instance();
+
+	//! 所要時間の記録
+	/*!
+	\param[in] stage 処理段階
+	\param[in] usec 所要時間(us)
+	*/
+	void Record(Stage stage, long long usec);
+
+	//! 記録のリセット
+	void Reset();
+
+	//! 段階ごとの回数とパーセンタイル(ms)を出力
+	void Print(std::ostream& os) const;
+
+	//! 終了時の出力ファイルへ書き出し
+	bool Dump() const;
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+private:
+	LatencyProfiler();
+
+	const static int SUB_BUCKETS = 16;	//!< 2のべき乗ごとの分割数
+	const static int NUM_BUCKETS = SUB_BUCKETS * 33;	//!< 1us～約19時間
+
+	//! 1段階分のヒストグラム
+	struct Histogram{
+		std::atomic<unsigned long long> counts[NUM_BUCKETS];
+		std::atomic<unsigned long long> total;
+		std::atomic<long long> sum;
+		std::atomic<long long> max;
+	};
+
+	Histogram _histograms[NUM_STAGES];
+
+	/////// パラメータ /////////////
+	std::string _dump_file;	//!< 終了時の出力ファイル名（空の場合は出力しない）
+	///////////////////////////////////
+
+	//! 所要時間に対応する区間
+	static int BucketIndex(long long usec);
+
+	//! 区間の代表値(us)
+	static double BucketValue(int index);
+
+	//! パーセンタイル(us)
+	double Percentile(const Histogram& hist, unsigned long long total, double percent) const;
+
+	LatencyProfiler(const LatencyProfiler&);
+	LatencyProfiler& operator=(const LatencyProfiler&);
+};
+
+
+//! スコープの所要時間を計測
+class LatencyTimer
+{
+public:
+	explicit LatencyTimer(LatencyProfiler::Stage stage) : _stage(stage), _start(cv::getTickCount()){}
+
+	~LatencyTimer(){
+		long long usec = (long long)((cv::getTickCount() - _start) * 1000000.0 / cv::getTickFrequency());
+		LatencyProfiler::Instance().Record(_stage, usec);
+	}
+
+private:
+	LatencyProfiler::Stage _stage;
+	int64 _start;
+};
+
+
+#ifdef USE_LATENCY_PROFILE
+#define LATENCY_CONCAT_(a, b) a##b
+#define LATENCY_CONCAT(a, b) LATENCY_CONCAT_(a, b)
+//! 現在のスコープの所要時間を計測
+#define LATENCY_SCOPE(stage) LatencyTimer LATENCY_CONCAT(latency_timer_, __LINE__)(LatencyProfiler::stage)
+#else
+#define LATENCY_SCOPE(stage)
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __LOCK_FREE_QUEUE__
+#define __LOCK_FREE_QUEUE__
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+namespace util{
+
+	//! ロックフリーの固定長キュー
+	/*!
+	複数スレッドからのPush/Popに対応したリングバッファ（Dmitry Vyukov方式）
+	*/
+	template <typename T>
+	class LockFreeQueue
+	{
+	public:
+		//! コンストラクタ
+		/*!
+		\param[in] capacity キューの容量（2のべき乗に切り上げる）
+		*/
+		explicit LockFreeQueue(size_t capacity){
+			size_t size = 2;
+			while (size < capacity)
+				size *= 2;
+			_mask = size - 1;
+			_buffer.reset(new Cell[size]);
+			for (size_t i = 0; i < size; i++)
+				_buffer[i].sequence.store(i, std::memory_order_relaxed);
+			_enqueue_pos.store(0, std::memory_order_relaxed);
+			_dequeue_pos.store(0, std::memory_order_relaxed);
+		}
+
+		//! 要素の追加
+		/*!
+		\return キューが満杯の場合はfalse
+		*/
+		bool Push(const T& value){
+			Cell* cell;
+			size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+			while (true){
+				cell = &_buffer[pos & _mask];
+				size_t seq = cell->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+				if (dif == 0){
+					if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (dif < 0){
+					return false;
+				}
+				else{
+					pos = _enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+			cell->data = value;
+			cell->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		//! 要素の取り出し
+		/*!
+		\return キューが空の場合はfalse
+		*/
+		bool Pop(T& value){
+			Cell* cell;
+			size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+			while (true){
+				cell = &_buffer[pos & _mask];
+				size_t seq = cell->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+				if (dif == 0){
+					if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (dif < 0){
+					return false;
+				}
+				else{
+					pos = _dequeue_pos.load(std::memory_order_relaxed);
+				}
+			}
+			value = cell->data;
+			cell->data = T();
+			cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		struct Cell{
+			std::atomic<size_t> sequence;
+			T data;
+		};
+
+		std::unique_ptr<Cell[]> _buffer;
+		size_t _mask;
+		char _pad0[64];
+		std::atomic<size_t> _enqueue_pos;
+		char _pad1[64];
+		std::atomic<size_t> _dequeue_pos;
+		char _pad2[64];
+
+		LockFreeQueue(const LockFreeQueue&);
+		LockFreeQueue& operator=(const LockFreeQueue&);
+	};
+
+}
+
+#endif
@@ -0,0 +1,221 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "MarkerHistory.h"
+#include "util_cv_functions.h"
+
+
+MarkerHistory::MarkerHistory()
+{
+	_image_idx = -1;
+	_chain = false;
+}
+
+
+void MarkerHistory::Select(int image_idx)
+{
+	_image_idx = image_idx;
+}
+
+
+void MarkerHistory::Record(unsigned char type, int index, const cv::Rect& before, const cv::Rect& after)
+{
+	Log& log = _logs[_image_idx];
+
+	// やり直し用の編集は破棄
+	log.edits.resize(log.cursor);
+
+	Edit edit;
+	edit.type = type;
+	edit.chained = _chain;
+	edit.index = index;
+	edit.before = before;
+	edit.after = after;
+	log.edits.push_back(edit);
+	log.cursor++;
+}
+
+
+void MarkerHistory::Insert(int index, const cv::Rect& rect)
+{
+	Record(EDIT_INSERT, index, cv::Rect(), rect);
+}
+
+
+void MarkerHistory::Erase(int index, const cv::Rect& rect)
+{
+	Record(EDIT_ERASE, index, rect, cv::Rect());
+}
+
+
+void MarkerHistory::Modify(int index, const cv::Rect& before, const cv::Rect& after)
+{
+	if (before != after)
+		Record(EDIT_MODIFY, index, before, after);
+}
+
+
+void MarkerHistory::MoveToBack(int index)
+{
+	Record(EDIT_MOVE_TO_BACK, index, cv::Rect(), cv::Rect());
+}
+
+
+void MarkerHistory::Replace(const std::vector<cv::Rect>& before, const std::vector<cv::Rect>& after)
+{
+	// 変化した矩形だけを記録し、まとめて1回の操作とする
+	size_t num_before = before.size();
+	size_t num_after = after.size();
+	size_t num = std::min(num_before, num_after);
+	Log& log = _logs[_image_idx];
+	size_t start = log.cursor;
+	for (size_t i = 0; i < num; i++){
+		_chain = (log.cursor > start);
+		Modify(i, before[i], after[i]);
+	}
+	for (size_t i = num_before; i > num; i--){
+		_chain = (log.cursor > start);
+		Erase(i - 1, before[i - 1]);
+	}
+	for (size_t i = num; i < num_after; i++){
+		_chain = (log.cursor > start);
+		Insert(i, after[i]);
+	}
+	_chain = false;
+}
+
+
+bool MarkerHistory::Apply(const Edit& edit, bool forward, std::vector<cv::Rect>& objects, double display_scale)
+{
+	int num = objects.size();
+	cv::Rect rect;
+	switch (edit.type){
+	case EDIT_INSERT:
+	case EDIT_ERASE:
+		// 追加を戻す操作と削除をやり直す操作はどちらも削除
+		if ((edit.type == EDIT_INSERT) != forward){
+			if (edit.index >= num)
+				return false;
+			objects.erase(objects.begin() + edit.index);
+		}
+		else{
+			if (edit.index > num)
+				return false;
+			util::RescaleRect((edit.type == EDIT_INSERT) ? edit.after : edit.before, rect, display_scale);
+			objects.insert(objects.begin() + edit.index, rect);
+		}
+		return true;
+
+	case EDIT_MODIFY:
+		if (edit.index >= num)
+			return false;
+		util::RescaleRect(forward ? edit.after : edit.before, objects[edit.index], display_scale);
+		return true;
+
+	case EDIT_MOVE_TO_BACK:
+		if (edit.index >= num)
+			return false;
+		if (forward){
+			rect = objects[edit.index];
+			objects.erase(objects.begin() + edit.index);
+			objects.push_back(rect);
+		}
+		else{
+			rect = objects.back();
+			objects.pop_back();
+			objects.insert(objects.begin() + edit.index, rect);
+		}
+		return true;
+	}
+	return false;
+}
+
+
+bool MarkerHistory::Undo(std::vector<cv::Rect>& objects, double display_scale)
+{
+	std::unordered_map<int, Log>::iterator it = _logs.find(_image_idx);
+	if (it == _logs.end() || it->second.cursor == 0)
+		return false;
+
+	Log& log = it->second;
+	bool chained;
+	do{
+		const Edit& edit = log.edits[--log.cursor];
+		chained = edit.chained;
+		if (!Apply(edit, false, objects, display_scale)){
+			// マーカーが履歴の外で変更されていたため、この画像の履歴は使えない
+			_logs.erase(it);
+			return false;
+		}
+	} while (chained && log.cursor > 0);
+	return true;
+}
+
+
+bool MarkerHistory::Redo(std::vector<cv::Rect>& objects, double display_scale)
+{
+	std::unordered_map<int, Log>::iterator it = _logs.find(_image_idx);
+	if (it == _logs.end() || it->second.cursor >= it->second.edits.size())
+		return false;
+
+	Log& log = it->second;
+	do{
+		if (!Apply(log.edits[log.cursor++], true, objects, display_scale)){
+			_logs.erase(it);
+			return false;
+		}
+	} while (log.cursor < log.edits.size() && log.edits[log.cursor].chained);
+	return true;
+}
+
+
+void MarkerHistory::Clear()
+{
+	_logs.clear();
+}
+
+
+void MarkerHistory::Clear(int image_idx)
+{
+	_logs.erase(image_idx);
+}
+
+
+size_t MarkerHistory::size() const
+{
+	size_t num = 0;
+	std::unordered_map<int, Log>::const_iterator it = _logs.begin();
+	for (; it != _logs.end(); it++)
+		num += it->second.edits.size();
+	return num;
+}
@@ -0,0 +1,125 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __MARKER_HISTORY__
+#define __MARKER_HISTORY__
+
+#include <opencv2/core/core.hpp>
+#include <unordered_map>
+#include <vector>
+
+//! マーカー編集の履歴（元に戻す/やり直す）
+/*!
+画像ごとに編集の差分（追加、削除、変更、並べ替え）を記録する。
+マーカー全体の置き換えは変化した分だけの差分に分解して、1回の操作としてまとめて記録する。
+矩形は原画像の座標で記録し、適用時に表示スケールへ変換する
+*/
+class MarkerHistory
+{
+public:
+	MarkerHistory();
+
+	//! 記録先の画像を選択
+	void Select(int image_idx);
+
+	//! マーカーの追加を記録
+	void Insert(int index, const cv::Rect& rect);
+
+	//! マーカーの削除を記録
+	void Erase(int index, const cv::Rect& rect);
+
+	//! マーカーの変更を記録
+	void Modify(int index, const cv::Rect& before, const cv::Rect& after);
+
+	//! マーカーを末尾へ移動したことを記録
+	void MoveToBack(int index);
+
+	//! マーカー全体の置き換えを記録
+	void Replace(const std::vector<cv::Rect>& before, const std::vector<cv::Rect>& after);
+
+	//! 選択中の画像の編集を１つ元に戻す
+	/*!
+	\param[in,out] objects 表示中のマーカー（表示画像の座標）
+	\param[in] display_scale 原画像に対する表示画像の縮尺
+	\return 元に戻せたかどうか
+	*/
+	bool Undo(std::vector<cv::Rect>& objects, double display_scale);
+
+	//! 選択中の画像で元に戻した編集を１つやり直す
+	bool Redo(std::vector<cv::Rect>& objects, double display_scale);
+
+	//! 全画像の履歴を消去
+	void Clear();
+
+	//! 指定した画像の履歴を消去
+	void Clear(int image_idx);
+
+	//! 記録している編集の数
+	size_t size() const;
+
+private:
+	//! 編集の種類
+	enum EditType { EDIT_INSERT, EDIT_ERASE, EDIT_MODIFY, EDIT_MOVE_TO_BACK };
+
+	//! 1回分の編集の差分
+	struct Edit{
+		unsigned char type;	//!< 編集の種類
+		bool chained;	//!< 直前の編集とまとめて戻すかどうか
+		int index;	//!< 対象のマーカー番号
+		cv::Rect before;	//!< 編集前の矩形（削除、変更）
+		cv::Rect after;	//!< 編集後の矩形（追加、変更）
+	};
+
+	//! 画像ごとの履歴
+	struct Log{
+		std::vector<Edit> edits;
+		size_t cursor;	//!< 次に記録する位置（これ以降はやり直し用）
+		Log() : cursor(0){}
+	};
+
+	std::unordered_map<int, Log> _logs;	//!< 画像IDごとの履歴
+	int _image_idx;	//!< 記録先の画像ID
+	bool _chain;	//!< 次の編集を直前の編集とまとめるかどうか
+
+	//! 編集を記録
+	void Record(unsigned char type, int index, const cv::Rect& before, const cv::Rect& after);
+
+	//! 編集をマーカーに適用
+	/*!
+	\param[in] forward trueの場合はやり直し、falseの場合は元に戻す
+	\return 成否（履歴とマーカーが一致しない場合はfalse）
+	*/
+	static bool Apply(const Edit& edit, bool forward, std::vector<cv::Rect>& objects, double display_scale);
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "MarkerTracker.h"
+#include "util_cv_functions.h"
+#include "MatPool.h"
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace{
+
+	const int MIN_TEMPLATE_SIZE = 8;	// テンプレートの最小サイズ
+	const int REFINE_RADIUS = 2;	// 細かい階層での探索範囲
+
+	//! テンプレートの探索
+	/*!
+	\param[in] ref 追跡元画像
+	\param[in] cur 追跡先画像
+	\param[in] rect 追跡元の矩形
+	\param[in] center 探索中心（追跡先での左上座標の予測）
+	\param[in] radius 探索範囲
+	\param[out] pos 追跡先での左上座標
+	\return 成否
+	*/
+	bool MatchTemplate(const cv::Mat& ref, const cv::Mat& cur, const cv::Rect& rect,
+		const cv::Point& center, int radius, cv::Point& pos)
+	{
+		cv::Rect tmpl_rect = rect & cv::Rect(0, 0, ref.cols, ref.rows);
+		if (tmpl_rect != rect || rect.width < 2 || rect.height < 2)
+			return false;
+
+		cv::Rect search(center.x - radius, center.y - radius, rect.width + 2 * radius, rect.height + 2 * radius);
+		search &= cv::Rect(0, 0, cur.cols, cur.rows);
+		if (search.width < rect.width || search.height < rect.height)
+			return false;
+
+		cv::Mat result;
+		cv::matchTemplate(cur(search), ref(rect), result, CV_TM_CCOEFF_NORMED);
+		cv::Point max_loc;
+		cv::minMaxLoc(result, NULL, NULL, NULL, &max_loc);
+		pos = cv::Point(search.x + max_loc.x, search.y + max_loc.y);
+		return true;
+	}
+
+
+	//! マーカー毎の追跡処理
+	class TrackBody : public cv::ParallelLoopBody
+	{
+	public:
+		TrackBody(const std::vector<cv::Mat>& ref_pyr, const std::vector<cv::Mat>& cur_pyr,
+			const std::vector<cv::Rect>& rects, int radius, std::vector<cv::Rect>& dst)
+			: _ref_pyr(ref_pyr), _cur_pyr(cur_pyr), _rects(rects), _radius(radius), _dst(dst){}
+
+		void operator()(const cv::Range& range) const{
+			for (int i = range.start; i < range.end; i++){
+				_dst[i] = TrackRect(_rects[i]);
+			}
+		}
+
+	private:
+		const std::vector<cv::Mat>& _ref_pyr;
+		const std::vector<cv::Mat>& _cur_pyr;
+		const std::vector<cv::Rect>& _rects;
+		int _radius;
+		std::vector<cv::Rect>& _dst;
+
+		cv::Rect TrackRect(const cv::Rect& rect) const{
+			// テンプレートが小さくなりすぎない階層から開始
+			int level = (int)_ref_pyr.size() - 1;
+			while (level > 0 && (std::min(rect.width, rect.height) >> level) < MIN_TEMPLATE_SIZE)
+				level--;
+
+			cv::Point pos(rect.x >> level, rect.y >> level);
+			int radius = std::max(REFINE_RADIUS, _radius >> level);
+			for (int l = level; l >= 0; l--){
+				cv::Rect r(rect.x >> l, rect.y >> l, rect.width >> l, rect.height >> l);
+				cv::Point match;
+				if (!MatchTemplate(_ref_pyr[l], _cur_pyr[l], r, pos, radius, match))
+					return rect;
+				if (l > 0)
+					pos = cv::Point(match.x * 2, match.y * 2);
+				else
+					pos = match;
+				radius = REFINE_RADIUS;
+			}
+			return cv::Rect(pos.x, pos.y, rect.width, rect.height);
+		}
+	};
+}
+
+
+MarkerTracker::MarkerTracker()
+{
+	_ref_idx = -1;
+	_search_radius = 32;
+	_max_level = 3;
+}
+
+
+void MarkerTracker::BuildPyramid(const cv::Mat& image, std::vector<cv::Mat>& pyramid) const
+{
+	pyramid.resize(_max_level + 1);
+	if (image.channels() == 3)
+		cv::cvtColor(image, pyramid[0], CV_BGR2GRAY);
+	else
+		image.copyTo(pyramid[0]);
+
+	for (int l = 1; l <= _max_level; l++){
+		if (pyramid[l - 1].cols < 2 * MIN_TEMPLATE_SIZE || pyramid[l - 1].rows < 2 * MIN_TEMPLATE_SIZE){
+			pyramid.resize(l);
+			break;
+		}
+		cv::pyrDown(pyramid[l - 1], pyramid[l]);
+	}
+}
+
+
+void MarkerTracker::SetReference(const cv::Mat& image, int image_idx)
+{
+	// 追跡しないまま次の画像へ進むことが多いため、ここではピラミッドを作らない。
+	// 表示画像のバッファは次の画像で使い回されるため、プールのバッファへ複製して保持する
+	_ref_pyramid.clear();
+	if (image.empty()){
+		MatPool::Instance().Release(_ref_image);
+		_ref_idx = -1;
+		return;
+	}
+	MatPool::Instance().Recreate(_ref_image, image.size(), image.type());
+	image.copyTo(_ref_image);
+	_ref_idx = image_idx;
+}
+
+
+bool MarkerTracker::Track(const cv::Mat& image, const std::vector<cv::Rect>& rects, double display_scale,
+	std::vector<cv::Rect>& dst_rects)
+{
+	if (_ref_image.empty() || image.empty() || _ref_image.size() != image.size())
+		return false;
+
+	if (_ref_pyramid.empty())
+		BuildPyramid(_ref_image, _ref_pyramid);
+
+	std::vector<cv::Mat> cur_pyramid;
+	BuildPyramid(image, cur_pyramid);
+	std::vector<cv::Mat> ref_pyramid(_ref_pyramid.begin(), _ref_pyramid.begin() + std::min(_ref_pyramid.size(), cur_pyramid.size()));
+
+	// 表示画像の座標で追跡
+	std::vector<cv::Rect> display_rects, tracked(rects.size());
+	util::RescaleRect(rects, display_rects, display_scale);
+	cv::parallel_for_(cv::Range(0, (int)display_rects.size()),
+		TrackBody(ref_pyramid, cur_pyramid, display_rects, _search_radius, tracked));
+
+	// 追跡できなかったマーカーは元の座標のまま
+	dst_rects.resize(rects.size());
+	for (size_t i = 0; i < rects.size(); i++){
+		if (tracked[i] == display_rects[i])
+			dst_rects[i] = rects[i];
+		else
+			util::RescaleRect(tracked[i], dst_rects[i], 1.0 / display_scale);
+	}
+	return true;
+}
+
+
+//! パラメータ読み込み
+void MarkerTracker::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	if (!fn["search_radius"].empty())
+		fn["search_radius"] >> _search_radius;
+	if (!fn["pyramid_level"].empty())
+		fn["pyramid_level"] >> _max_level;
+	_search_radius = std::max(1, _search_radius);
+	_max_level = std::max(0, std::min(6, _max_level));
+}
+
+
+//! パラメータ書き込み
+void MarkerTracker::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "search_radius" << _search_radius;
+	fs << "pyramid_level" << _max_level;
+	fs << "}";
+}
@@ -0,0 +1,94 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __MARKER_TRACKER__
+#define __MARKER_TRACKER__
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+//! 前フレームのマーカーを現フレームへ追跡
+/*!
+画像ピラミッドの粗い階層から順にテンプレートマッチングを行い、探索範囲内でマーカーの移動先を求める。
+各マーカーの追跡は並列に実行する
+*/
+class MarkerTracker
+{
+public:
+	MarkerTracker();
+
+	//! 追跡元の画像を設定
+	/*!
+	画像は複製を保持するだけで、ピラミッドは追跡時に作成する（画像を切り替える度に作成しない）
+	\param[in] image 表示画像
+	\param[in] image_idx 画像ID
+	*/
+	void SetReference(const cv::Mat& image, int image_idx);
+
+	//! 追跡元の画像ID（未設定の場合は-1）
+	int reference_idx() const{
+		return _ref_idx;
+	}
+
+	//! マーカーの追跡
+	/*!
+	\param[in] image 追跡先の表示画像
+	\param[in] rects 追跡元のマーカー（原画像の座標）
+	\param[in] display_scale 原画像に対する表示画像の縮尺
+	\param[out] dst_rects 追跡先のマーカー（原画像の座標）
+	\return 成否（追跡元の画像がない場合はfalse）
+	*/
+	bool Track(const cv::Mat& image, const std::vector<cv::Rect>& rects, double display_scale,
+		std::vector<cv::Rect>& dst_rects);
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+private:
+	cv::Mat _ref_image;	//!< 追跡元画像（表示画像の複製、プールから取得）
+	std::vector<cv::Mat> _ref_pyramid;	//!< 追跡元画像のピラミッド（グレースケール、未作成の場合は空）
+	int _ref_idx;	//!< 追跡元の画像ID
+
+	/////// パラメータ /////////////
+	int _search_radius;	//!< 探索範囲（表示画像上の画素数）
+	int _max_level;	//!< ピラミッドの最大階層
+	///////////////////////////////////
+
+	//! グレースケール画像のピラミッドを作成
+	void BuildPyramid(const cv::Mat& image, std::vector<cv::Mat>& pyramid) const;
+};
+
+#endif
@@ -37,6 +37,8 @@
 #include <iostream>
 #include "util_cv_functions.h"
 #include "util_functions.h"
+#include "MatPool.h"
+#include "LatencyProfiler.h"
 
 
 MarkerViewer::MarkerViewer()
@@ -55,47 +57,78 @@ void MarkerViewer::Init()
 {
 	_roi_b = cv::Point2d(-1, -1);
 	_roi_e = cv::Point2d(-1, -1);
-	_display_scale = 1.0;	// fBXvC\̌摜̏k
-	_FIX_MARKER_AR = false;	// }[J[̏cŒ肷邩ǂ
-	_aspect_ratio = 1.0; // }[J[̃AXyNgi/j
-	_ACCEPT_POINT = false;	// }[J[̓_`F߂邩ۂ
-	_GUIDE_SHAPE = GUIDE_NONE;	// KCȟ`
-	_guide_rect = cv::Rect(0, 0, 0, 0);	// KCh̋`
-	_guide_rect_org = cv::Rect(0, 0, 0, 0);	// KCh̋`(kڑO)
-	_SHOW_GUIDE = false;	// KCh̕\L
+	_display_scale = 1.0;	// ディスプレイ表示の原画像からの縮尺
+	_snap_band = 8;	// 輪郭に合わせる際の探索範囲
+	_FIX_MARKER_AR = false;	// マーカーの縦横比を固定するかどうか
+	_aspect_ratio = 1.0; // マーカーのアスペクト比（幅/高さ）
+	_ACCEPT_POINT = false;	// マーカーの点形状を認めるか否か
+	_GUIDE_SHAPE = GUIDE_NONE;	// ガイドの形状
+	_guide_rect = cv::Rect(0, 0, 0, 0);	// ガイドの矩形
+	_guide_rect_org = cv::Rect(0, 0, 0, 0);	// ガイドの矩形(縮尺前)
+	_SHOW_GUIDE = false;	// ガイドの表示有無
 
 	_change_flag = false;
+	_backend = &HighGuiBackend::Instance();
 }
 
 
 void MarkerViewer::Open(const cv::Mat& image, const std::string& window_name)
+{
+	Open(image, window_name, image.size());
+}
+
+
+void MarkerViewer::Open(const cv::Mat& image, const std::string& window_name, const cv::Size& org_size)
 {
 	Close();
 
 	_window_name = window_name;
-	cv::resize(image, _image, cv::Size(_display_scale * image.cols, _display_scale * image.rows));
-	cv::namedWindow(_window_name);
-	cv::setMouseCallback(_window_name, MarkerViewer::on_mouse, this);
+	cv::Size display_size(_display_scale * org_size.width, _display_scale * org_size.height);
+	MatPool::Instance().Recreate(_image, display_size, image.type());
+	{
+		LATENCY_SCOPE(STAGE_OPEN_RESIZE);
+		cv::resize(image, _image, display_size);
+	}
+	_backend->OpenWindow(_window_name, MarkerViewer::on_mouse, this);
 	RedrawImage();
 //	_change_flag = false;
 }
 
 
+void MarkerViewer::UpdateImage(const cv::Mat& image)
+{
+	cv::Size display_size(_display_scale * image.cols, _display_scale * image.rows);
+	MatPool::Instance().Recreate(_image, display_size, image.type());
+	{
+		LATENCY_SCOPE(STAGE_OPEN_RESIZE);
+		cv::resize(image, _image, display_size);
+	}
+	RedrawImage();
+}
+
+
+void MarkerViewer::SetBackend(DisplayBackend* backend)
+{
+	Close();
+	_backend = backend ? backend : &HighGuiBackend::Instance();
+}
+
+
 void MarkerViewer::Close()
 {
 	if (!_window_name.empty()){
-		cv::destroyWindow(_window_name);
+		_backend->CloseWindow(_window_name);
 		_window_name = std::string();
 	}
 }
 
 
-int MarkerViewer::GetWindowKey(){
-	return cv::waitKey(0);
+int MarkerViewer::GetWindowKey(int delay){
+	return _backend->WaitKey(delay);
 };
 
 
-//! }[J[̎擾
+//! マーカーの取得
 const std::vector<cv::Rect> MarkerViewer::GetMarkers() const{
 	std::vector<cv::Rect> objects = removeOutRangeRect(_objects, _image.size());
 	std::vector<cv::Rect> objects2;
@@ -104,18 +137,86 @@ const std::vector<cv::Rect> MarkerViewer::GetMarkers() const{
 };
 
 
-//! }[J[̐ݒ
+//! マーカーの設定
 void MarkerViewer::SetMarkers(const std::vector<cv::Rect>& objects){
+	std::vector<cv::Rect> before;
+	util::RescaleRect(_objects, before, 1.0 / _display_scale);
+	_history.Replace(before, objects);
+
 	util::RescaleRect(objects, _objects, _display_scale);
 	_change_flag = true;
 	RedrawImage();
 };
 
 
-//! }[J[
+//! 画像を開いた時のマーカーの読み込み
+void MarkerViewer::LoadMarkers(const std::vector<cv::Rect>& objects, int image_idx){
+	_history.Select(image_idx);
+	util::RescaleRect(objects, _objects, _display_scale);
+	_suggestions.clear();
+	_change_flag = false;
+	RedrawImage();
+}
+
+
+//! マーカー候補の設定
+void MarkerViewer::SetSuggestions(const std::vector<cv::Rect>& objects){
+	util::RescaleRect(objects, _suggestions, _display_scale);
+	RedrawImage();
+}
+
+
+//! マーカー候補を採用
+bool MarkerViewer::AcceptSuggestions()
+{
+	if (_suggestions.empty())
+		return false;
+
+	std::vector<cv::Rect> objects = GetMarkers();
+	std::vector<cv::Rect> suggestions;
+	util::RescaleRect(_suggestions, suggestions, 1.0 / _display_scale);
+	objects.insert(objects.end(), suggestions.begin(), suggestions.end());
+	_suggestions.clear();
+	SetMarkers(objects);
+	return true;
+}
+
+
+//! 直前の編集を元に戻す
+bool MarkerViewer::Undo()
+{
+	if (!_history.Undo(_objects, _display_scale))
+		return false;
+	_change_flag = true;
+	RedrawImage();
+	return true;
+}
+
+
+//! 元に戻した編集をやり直す
+bool MarkerViewer::Redo()
+{
+	if (!_history.Redo(_objects, _display_scale))
+		return false;
+	_change_flag = true;
+	RedrawImage();
+	return true;
+}
+
+
+cv::Rect MarkerViewer::ToOriginal(const cv::Rect& rect) const
+{
+	cv::Rect dst_rect;
+	util::RescaleRect(rect, dst_rect, 1.0 / _display_scale);
+	return dst_rect;
+}
+
+
+//! マーカーを消す
 void MarkerViewer::DeleteMarker()
 {
 	if (!_objects.empty()){
+		_history.Erase(_objects.size() - 1, ToOriginal(_objects.back()));
 		_objects.pop_back();
 		_change_flag = true;
 		RedrawImage();
@@ -123,11 +224,12 @@ void MarkerViewer::DeleteMarker()
 }
 
 
-//! }[J[̈ʒu炵A傫̕ύXs
+//! マーカーの位置をずらしたり、大きさの変更を行う
 void MarkerViewer::ReshapeMarker(const cv::Rect& mv)
 {
 	if (!_objects.empty()){
 		cv::Rect* rect = &(_objects.back());
+		cv::Rect before = *rect;
 		rect->x += mv.x;
 		rect->y += mv.y;
 		rect->width += mv.width;
@@ -136,13 +238,14 @@ void MarkerViewer::ReshapeMarker(const cv::Rect& mv)
 			rect->width = 1;
 		if (rect->height <= 0)
 			rect->height = 1;
+		_history.Modify(_objects.size() - 1, ToOriginal(before), ToOriginal(*rect));
 		_change_flag = true;
 		RedrawImage();
 	}
 }
 
 
-//! }[J[̑傫ύX
+//! マーカーの大きさを変更する
 void MarkerViewer::ResizeMarker(float scale)
 {
 	if (scale <= 0)
@@ -159,15 +262,37 @@ void MarkerViewer::ResizeMarker(float scale)
 
 		//rect->x += (rect->width - w) / 2;
 		//rect->y += (rect->height - h) / 2;
+		cv::Rect before = *rect;
 		rect->width = w;
 		rect->height = h;
+		_history.Modify(_objects.size() - 1, ToOriginal(before), ToOriginal(*rect));
 		_change_flag = true;
 		RedrawImage();
 	}
 }
 
 
-//! AXyNgŒ̐ݒ/
+//! マーカーを近くの物体の輪郭に合わせる
+bool MarkerViewer::SnapMarker()
+{
+	if (_objects.empty())
+		return false;
+
+	cv::Rect rect;
+	if (!util::SnapRectToEdges(_image, _objects.back(), _snap_band, rect))
+		return false;
+	if (_FIX_MARKER_AR)
+		rect.height = std::max(1, util::round((double)rect.width / _aspect_ratio));
+
+	_history.Modify(_objects.size() - 1, ToOriginal(_objects.back()), ToOriginal(rect));
+	_objects.back() = rect;
+	_change_flag = true;
+	RedrawImage();
+	return true;
+}
+
+
+//! アスペクト比固定の設定/解除
 bool MarkerViewer::SwitchFixAR()
 {
 	_FIX_MARKER_AR = !_FIX_MARKER_AR;
@@ -178,7 +303,7 @@ bool MarkerViewer::SwitchFixAR()
 }
 
 
-//! KChp`ݒ
+//! ガイド用矩形を設定
 void MarkerViewer::SetGuideRectangle(const cv::Rect& rect)
 {
 	_guide_rect_org = rect;
@@ -187,7 +312,7 @@ void MarkerViewer::SetGuideRectangle(const cv::Rect& rect)
 
 }
 
-//! KChp`ݒ
+//! ガイド用矩形を設定
 void MarkerViewer::SetGuideShape(int shape){
 	if (shape < 0 || shape > 4)
 		return;
@@ -197,7 +322,7 @@ void MarkerViewer::SetGuideShape(int shape){
 
 
 
-//! 摜gŐ`폜
+//! 画像枠外の矩形を削除
 std::vector<cv::Rect> MarkerViewer::removeOutRangeRect(const std::vector<cv::Rect>& objects, const cv::Size& img_size)
 {
 	std::vector<cv::Rect> dst_objects;
@@ -211,18 +336,18 @@ std::vector<cv::Rect> MarkerViewer::removeOutRangeRect(const std::vector<cv::Rec
 }
 
 
-//! Xe[^X̕\
+//! ステータスの表示
 void MarkerViewer::PrintStatus() const{
-	std::cout << "}[J[̏c" << (_FIX_MARKER_AR ? "Œ" : "R") << std::endl;
+	std::cout << "マーカーの縦横比は" << (_FIX_MARKER_AR ? "固定" : "自由") << std::endl;
 	if (_FIX_MARKER_AR) {
-		std::cout << "AXyNg (width / height): " << _aspect_ratio << std::endl;
+		std::cout << "アスペクト比 (width / height): " << _aspect_ratio << std::endl;
 	}
-	std::cout << "_}[J[F " << (_ACCEPT_POINT ? "YES" : "NO") << std::endl;
-	std::cout << "\kځF " << _display_scale << std::endl;
+	std::cout << "点マーカーを許可： " << (_ACCEPT_POINT ? "YES" : "NO") << std::endl;
+	std::cout << "表示縮尺： " << _display_scale << std::endl;
 }
 
 
-//! p[^ǂݍ
+//! パラメータ読み込み
 void MarkerViewer::Read(const cv::FileNode& fn)
 {
 	fn["display_scale"] >> _display_scale;
@@ -234,6 +359,10 @@ void MarkerViewer::Read(const cv::FileNode& fn)
 	fn["aspect_ratio"] >> _aspect_ratio;
 	int point = fn["accept_point_shape"];
 	_ACCEPT_POINT = (point == 1) ? true : false;
+	if (!fn["snap_band"].empty())
+		fn["snap_band"] >> _snap_band;
+	if (_snap_band < 1)
+		_snap_band = 8;
 
 	cv::FileNode fng = fn["guide"];
 	_GUIDE_SHAPE = GUIDE_NONE;
@@ -256,7 +385,7 @@ void MarkerViewer::Read(const cv::FileNode& fn)
 }
 
 
-//! p[^
+//! パラメータ書き込み
 void MarkerViewer::Write(cv::FileStorage& fs, const std::string& node_name) const
 {
 	if (!node_name.empty())
@@ -266,16 +395,16 @@ void MarkerViewer::Write(cv::FileStorage& fs, const std::string& node_name) cons
 	fs << "fix_marker_ratio" << (int)(_FIX_MARKER_AR ? 1 : 0);
 	fs << "aspect_ratio" << _aspect_ratio;
 	fs << "accept_point_shape" << (int)(_ACCEPT_POINT ? 1 : 0);
-
-	if (_GUIDE_SHAPE == GUIDE_NONE)
-		return;
-
-	fs << "guide" << "{";
-	cvWriteComment(fs.fs, "1:SQUARE, 2:RECTANGLE, 3:CIRCLE, 4:ELLIPSE", 0);
-	fs << "shape" << _GUIDE_SHAPE;
-	fs << "position" << _guide_rect;
-	fs << "display" << (int)(_SHOW_GUIDE ? 1 : 0);
-	fs << "}";
+	fs << "snap_band" << _snap_band;
+
+	if (_GUIDE_SHAPE != GUIDE_NONE){
+		fs << "guide" << "{";
+		cvWriteComment(fs.fs, "1:SQUARE, 2:RECTANGLE, 3:CIRCLE, 4:ELLIPSE", 0);
+		fs << "shape" << _GUIDE_SHAPE;
+		fs << "position" << _guide_rect;
+		fs << "display" << (int)(_SHOW_GUIDE ? 1 : 0);
+		fs << "}";
+	}
 
 	fs << "}";
 }
@@ -310,6 +439,7 @@ void MarkerViewer::MouseButtonUp()
 	if ((width == 0 || height == 0) && !_ACCEPT_POINT) return;
 
 	cv::Rect rectangle = cv::Rect(topleft_x, topleft_y, width, height);
+	_history.Insert(_objects.size(), ToOriginal(rectangle));
 	_objects.push_back(rectangle);
 	_roi_b.x = -1;  // indicates that there's no temporary rectangle
 	RedrawImage();
@@ -323,6 +453,7 @@ void MarkerViewer::MouseRButtonUp(int x, int y)
 	if (idx < 0)
 		return;
 
+	_history.MoveToBack(idx);
 	std::vector<cv::Rect>::iterator it = _objects.begin();
 	it += idx;
 	cv::Rect selected_rect = *it;
@@ -331,7 +462,7 @@ void MarkerViewer::MouseRButtonUp(int x, int y)
 }
 
 
-//! `̂PI
+//! 矩形の１つを選択
 int MarkerViewer::SelectObject(int x, int y)
 {
 	int threshold = 3;
@@ -394,8 +525,18 @@ void MarkerViewer::RedrawImage()
 {
 	if (!is_open())
 		return;
+	LATENCY_SCOPE(STAGE_REDRAW);
+
+	_backend->ShowImage(_window_name, Render());
+}
+
 
-	cv::Mat image2 = _image.clone();
+const cv::Mat& MarkerViewer::Render()
+{
+	// 再描画毎の確保を避けるため、描画用バッファを使い回す
+	MatPool::Instance().Recreate(_canvas, _image.size(), _image.type());
+	_image.copyTo(_canvas);
+	cv::Mat image2 = _canvas;
 
 	if (_SHOW_GUIDE &&
 		_guide_rect.width >0 && _guide_rect.height >0){
@@ -415,6 +556,10 @@ void MarkerViewer::RedrawImage()
 			cv::Size(_guide_rect.width / 2, _guide_rect.height / 2), 0, 0, 360, CV_RGB(255, 255, 0), 1);
 	}
 
+	// 未採用の候補は水色で表示
+	for (int i = 0; i < _suggestions.size(); i++)
+		cv::rectangle(image2, _suggestions[i], CV_RGB(0, 255, 255), 1);
+
 	// Display all rectangles
 	int numOfRect = (int)(_objects.size());
 	for (int i = 0; i < numOfRect; i++) {
@@ -433,6 +578,6 @@ void MarkerViewer::RedrawImage()
 		cv::rectangle(image2, cvPoint((int)_roi_b.x, (int)_roi_b.y), cvPoint((int)_roi_e.x, (int)_roi_e.y), CV_RGB(255, 0, 0), 1);
 	}
 
-	cv::imshow(_window_name, image2);
+	return _canvas;
 }
 
@@ -35,11 +35,13 @@
 #define __MARKER_VIEWER__
 
 #include <opencv2/core/core.hpp>
+#include "MarkerHistory.h"
+#include "DisplayBackend.h"
 
 class MarkerViewer
 {
 public:
-	//////////// KCȟ` //////////////
+	//////////// ガイドの形状 //////////////
 	const static int GUIDE_NONE = 0;
 	const static int GUIDE_SQUARE = 1;
 	const static int GUIDE_RECTANGLE = 2;
@@ -48,17 +50,40 @@ public:
 	////////////////////////////////////////
 
 public:
-	//!< 摜ƃEBhẼZbg
+	//!< 画像とウィンドウ名のセット
 	MarkerViewer();
 	~MarkerViewer();
 
-	//! 摜ƃEBhEŋN
+	//! 画像とウィンドウ名で起動
 	void Open(const cv::Mat& image, const std::string& window_name);
 
-	//! 
+	//! 原画像サイズを指定して起動
+	/*!
+	縮小デコードしたプレビュー画像を表示する場合に使用。マーカー座標はorg_sizeを基準とする
+	\param[in] image 表示画像
+	\param[in] window_name ウィンドウ名
+	\param[in] org_size 原画像のサイズ
+	*/
+	void Open(const cv::Mat& image, const std::string& window_name, const cv::Size& org_size);
+
+	//! 表示中の画像を差し替え
+	/*!
+	マーカーやドラッグ中の矩形はそのまま保持する
+	\param[in] image 原寸画像
+	*/
+	void UpdateImage(const cv::Mat& image);
+
+	//! 窓を閉じる
 	void Close();
 
-	//! JĂ邩ǂ
+	//! 表示先の設定
+	/*!
+	開いている窓は閉じる。backendは呼び出し側で保持すること
+	\param[in] backend 表示先。NULLの場合はHighGUIのウィンドウ
+	*/
+	void SetBackend(DisplayBackend* backend);
+
+	//! 開いているかどうか
 	bool is_open(){
 		return !_window_name.empty(); 
 	}
@@ -71,123 +96,206 @@ public:
 		_change_flag = false;
 	}
 
-	//! p[^ǂݍ
+	//! パラメータ読み込み
 	void Read(const cv::FileNode& fn);
 
-	//! p[^
+	//! パラメータ書き込み
 	void Write(cv::FileStorage& fs, const std::string& node_name) const;
 
-	//! EBhEɓ͂ꂽL[擾
-	int GetWindowKey();
+	//! ウィンドウに入力されたキーを取得
+	/*!
+	\param[in] delay 待ち時間(ms)。0の場合はキーが押されるまで待つ
+	\return 入力されたキー。タイムアウトした場合は-1
+	*/
+	int GetWindowKey(int delay = 0);
 
-	//! }[J[̎擾
+	//! マーカーの取得
 	const std::vector<cv::Rect> GetMarkers() const;
 
-	//! }[J[̐ݒ
+	//! マーカーの設定
+	/*!
+	編集として履歴に記録する
+	*/
 	void SetMarkers(const std::vector<cv::Rect>& objects);
 
-	//! }[J[
+	//! 画像を開いた時のマーカーの読み込み
+	/*!
+	履歴には記録せず、以降の編集は指定した画像の履歴に記録する
+	\param[in] objects マーカー（原画像の座標）
+	\param[in] image_idx 画像ID
+	*/
+	void LoadMarkers(const std::vector<cv::Rect>& objects, int image_idx);
+
+	//! マーカー候補の設定
+	/*!
+	候補はマーカーとは別の色で表示するだけで、AcceptSuggestions()で採用するまで記録されない。
+	次にLoadMarkers()を呼ぶと消える
+	\param[in] objects マーカー候補（原画像の座標）
+	*/
+	void SetSuggestions(const std::vector<cv::Rect>& objects);
+
+	//! マーカー候補を採用
+	/*!
+	候補を現在のマーカーに追加し、編集として履歴に記録する
+	\return 候補があったかどうか
+	*/
+	bool AcceptSuggestions();
+
+	//! マーカー候補があるかどうか
+	bool has_suggestions() const{
+		return !_suggestions.empty();
+	}
+
+	//! 直前の編集を元に戻す
+	bool Undo();
+
+	//! 元に戻した編集をやり直す
+	bool Redo();
+
+	//! 全画像の編集履歴を消去
+	void ClearHistory(){
+		_history.Clear();
+	}
+
+	//! 指定した画像の編集履歴を消去
+	void ClearHistory(int image_idx){
+		_history.Clear(image_idx);
+	}
+
+	//! マーカーを消す
 	void DeleteMarker();
 	
-	//! }[J[̈ʒu炵A傫̕ύXs
+	//! マーカーの位置をずらしたり、大きさの変更を行う
 	void ReshapeMarker(const cv::Rect& mv);
 
-	//! }[J[̑傫ύX
+	//! マーカーの大きさを変更する
 	void ResizeMarker(float scale);
 
-	//! \XP[Zbg
+	//! マーカーを近くの物体の輪郭に合わせる
+	/*!
+	表示画像上でマーカーの各辺の周囲を解析し、強いエッジの位置へ辺を移動する
+	\return 成否
+	*/
+	bool SnapMarker();
+
+	//! 表示スケールをセットする
 	void SetDisplayScale(double scale){
 		_display_scale = scale;
 	};
 
-	//! AXyNgŒ̐ݒ/
+	//! 表示画像（表示スケールで縮小済み、マーカーなし）を取得する
+	const cv::Mat& GetImage() const{
+		return _image;
+	};
+
+	//! マーカーを描画した表示画像を作成
+	/*!
+	ウィンドウを開いていなくても描画できる
+	\return 描画した画像（次の描画まで有効）
+	*/
+	const cv::Mat& Render();
+
+	//! 表示スケールを取得する
+	double GetDisplayScale() const{
+		return _display_scale;
+	};
+
+	//! アスペクト比固定の設定/解除
 	bool SwitchFixAR();
 
-	//! AXyNg̐ݒ
+	//! アスペクト比の設定
 	void SetAspectRatio(double ratio){
 		if (ratio > 0)
 			_aspect_ratio = ratio;
 	}
 
-	// _`̋/s
+	// 点形状の許可/不許可
 	bool SwitchAcceptPointShape(){
 		_ACCEPT_POINT = !_ACCEPT_POINT;
 		return _ACCEPT_POINT;
 	}
 
-	// KCh̕\/\؂ւ
+	// ガイドの表示/非表示切り替え
 	bool SwitchShowGuide(){
 		_SHOW_GUIDE = !_SHOW_GUIDE;
 		RedrawImage();
 		return _SHOW_GUIDE;
 	}
 
-	// KCh̕\
+	// ガイドの表示
 	void ShowGuide(){
 		_SHOW_GUIDE = true;
 		RedrawImage();
 	}
 
-	//! KChp`ݒ
+	//! ガイド用矩形を設定
 	void SetGuideRectangle(const cv::Rect& rect);
 
-	//! KChp`ݒ
+	//! ガイド用矩形を設定
 	void SetGuideShape(int shape);
 
-	//! }EX̃{^ꂽ̃ANV
+	//! マウスのボタンが押された時のアクション
 	void MouseButtonDown(int x, int y);
 
-	//! }EX̃{^ꂽ܂ܓ̃ANV
+	//! マウスのボタンが押されたまま動かした時のアクション
 	void MouseMove(int x, int y);
 
-	//! }EX̃{^グ̃ANV
+	//! マウスのボタンを上げた時のアクション
 	void MouseButtonUp();
 
-	//! }EX̉E{^グ̃ANV
+	//! マウスの右ボタンを上げた時のアクション
 	void MouseRButtonUp(int x, int y);
 
-	//! Xe[^X̕\
+	//! ステータスの表示
 	void PrintStatus() const;
 
 private:
-	bool _change_flag;	//! `擙̕ύXǂ
+	bool _change_flag;	//! 描画等の変更があったかどうか
 
-	std::string _window_name;	//!< `摋
+	std::string _window_name;	//!< 描画窓
+	DisplayBackend* _backend;	//!< 表示先
 
-	cv::Point2d _roi_b, _roi_e;	//!< }EXhbO̎n_ƏI_
+	cv::Point2d _roi_b, _roi_e;	//!< マウスドラッグの始点と終点
 
-	cv::Mat _image;	//!< \摜
+	cv::Mat _image;	//!< 表示画像
+	cv::Mat _canvas;	//!< マーカー描画用バッファ
 
-	std::vector<cv::Rect> _objects;	//!< \摜ɑ΂t^ꂽS}[J[
+	std::vector<cv::Rect> _objects;	//!< 表示画像に対し付与された全マーカー
+	std::vector<cv::Rect> _suggestions;	//!< 未採用のマーカー候補（表示画像の座標）
+	MarkerHistory _history;	//!< マーカーの編集履歴
 
-	/////// p[^ /////////////
-	bool _FIX_MARKER_AR;	//!< }[J[̏cŒ肷邩ǂ
-	double _aspect_ratio; //!< }[J[̃AXyNgi/j
-	bool _ACCEPT_POINT;	//!< }[J[̓_`F߂邩ۂ
-	double _display_scale;	// fBXvC\̌摜̏k
+	/////// パラメータ /////////////
+	bool _FIX_MARKER_AR;	//!< マーカーの縦横比を固定するかどうか
+	double _aspect_ratio; //!< マーカーのアスペクト比（幅/高さ）
+	bool _ACCEPT_POINT;	//!< マーカーの点形状を認めるか否か
+	double _display_scale;	// ディスプレイ表示の原画像からの縮尺
+	int _snap_band;	//!< 輪郭に合わせる際の探索範囲（表示画像上の画素数）
 
-	bool _SHOW_GUIDE;	//!< KCh̕\
-	int _GUIDE_SHAPE;	//!< KCȟ`
-	cv::Rect _guide_rect;	//!< KCḧʒuƃTCY
-	cv::Rect _guide_rect_org;	//!< KCḧʒuƃTCY(kڑO)
+	bool _SHOW_GUIDE;	//!< ガイドの表示
+	int _GUIDE_SHAPE;	//!< ガイドの形状
+	cv::Rect _guide_rect;	//!< ガイドの位置とサイズ
+	cv::Rect _guide_rect_org;	//!< ガイドの位置とサイズ(縮尺前)
 	///////////////////////////////////
 
 private:
-	//! p[^
+	//! パラメータ初期化
 	void Init();
 
-	//! }EXvR[obN֐
+	//! マウス操作要コールバック関数
 	static void on_mouse(int event, int x, int y, int flag, void* param);	
 
-	//! 摜gŐ`폜
+	//! 画像枠外の矩形を削除
 	static std::vector<cv::Rect> removeOutRangeRect(const std::vector<cv::Rect>& objects, const cv::Size& img_size);
 
-	//! EBhE̍ĕ`
+	//! ウィンドウの再描画
 	void RedrawImage();
 
-	//! `̂PI
+	//! 表示画像上の矩形を原画像の座標へ変換
+	cv::Rect ToOriginal(const cv::Rect& rect) const;
+
+	//! 矩形の１つを選択
 	/*!
-	\return x,yɍł߂IuWFNgID
+	\return x,yに最も近いオブジェクトのID
 	*/
 	int SelectObject(int x, int y);
 };
@@ -0,0 +1,192 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "MatPool.h"
+#include <iostream>
+
+namespace{
+	const size_t LARGE_ALLOCATION = 64 * 1024;	// これ以上の確保を「大きな確保」として数える
+}
+
+
+MatPool& MatPool::Instance()
+{
+	static MatPool pool;
+	return pool;
+}
+
+
+MatPool::MatPool()
+{
+	_free_bytes = 0;
+	_capacity = 512 * 1024 * 1024;
+	ResetCounters();
+}
+
+
+cv::Mat MatPool::Acquire(const cv::Size& size, int type)
+{
+	Key key;
+	key.rows = size.height;
+	key.cols = size.width;
+	key.type = type;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_num_acquire++;
+		std::list<std::pair<Key, cv::Mat>>::iterator it;
+		for (it = _free.begin(); it != _free.end(); it++){
+			if (!(it->first < key) && !(key < it->first)){
+				cv::Mat mat = it->second;
+				_free_bytes -= ByteSize(mat);
+				_free.erase(it);
+				_num_reuse++;
+				return mat;
+			}
+		}
+	}
+
+	cv::Mat mat(size, type);
+	CountAllocation(mat);
+	return mat;
+}
+
+
+void MatPool::Release(cv::Mat& mat)
+{
+	if (mat.empty())
+		return;
+
+	// ROIや外部データ、他の行列と共有しているデータは返却しない
+	// （共有中のバッファを再利用すると、他の参照先の内容が書き換わる）
+	cv::Size whole;
+	cv::Point ofs;
+	mat.locateROI(whole, ofs);
+#if CV_MAJOR_VERSION >= 3
+	bool own_data = (mat.u != NULL);
+#else
+	bool own_data = (mat.refcount != NULL);
+#endif
+	if (!own_data || IsShared(mat) || whole != mat.size()){
+		mat.release();
+		return;
+	}
+
+	Key key;
+	key.rows = mat.rows;
+	key.cols = mat.cols;
+	key.type = mat.type();
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_free.push_back(std::make_pair(key, mat));
+		_free_bytes += ByteSize(mat);
+		// 上限を超えた分は古いものから解放
+		while (_free_bytes > _capacity && !_free.empty()){
+			_free_bytes -= ByteSize(_free.front().second);
+			_free.pop_front();
+		}
+	}
+	mat.release();
+}
+
+
+void MatPool::Recreate(cv::Mat& mat, const cv::Size& size, int type)
+{
+	// 他の行列と共有しているバッファは書き換えられないため取り直す
+	if (!mat.empty() && mat.size() == size && mat.type() == type && !IsShared(mat))
+		return;
+
+	Release(mat);
+	mat = Acquire(size, type);
+}
+
+
+bool MatPool::IsShared(const cv::Mat& mat)
+{
+#if CV_MAJOR_VERSION >= 3
+	return (mat.u != NULL && mat.u->refcount > 1);
+#else
+	return (mat.refcount != NULL && *mat.refcount > 1);
+#endif
+}
+
+
+void MatPool::CountAllocation(const cv::Mat& mat)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	size_t bytes = ByteSize(mat);
+	_num_alloc++;
+	_alloc_bytes += bytes;
+	if (bytes >= LARGE_ALLOCATION)
+		_num_large_alloc++;
+}
+
+
+void MatPool::SetCapacity(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_capacity = bytes;
+	while (_free_bytes > _capacity && !_free.empty()){
+		_free_bytes -= ByteSize(_free.front().second);
+		_free.pop_front();
+	}
+}
+
+
+void MatPool::ResetCounters()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_num_acquire = 0;
+	_num_reuse = 0;
+	_num_alloc = 0;
+	_num_large_alloc = 0;
+	_alloc_bytes = 0;
+}
+
+
+size_t MatPool::num_large_allocations() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _num_large_alloc;
+}
+
+
+void MatPool::PrintStatus() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::cout << "バッファ取得： " << _num_acquire << " (再利用 " << _num_reuse << ")" << std::endl;
+	std::cout << "バッファ確保： " << _num_alloc << " (64KB以上 " << _num_large_alloc << ", "
+		<< _alloc_bytes / 1024 << " KB)" << std::endl;
+	std::cout << "プール内の未使用バッファ： " << _free.size() << " (" << _free_bytes / 1024 << " KB)" << std::endl;
+}
@@ -0,0 +1,126 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __MAT_POOL__
+#define __MAT_POOL__
+
+#include <opencv2/core/core.hpp>
+#include <map>
+#include <list>
+#include <mutex>
+
+//! 画像バッファの再利用プール
+/*!
+サイズと型が一致するcv::Matのバッファを使い回し、画像の切り替えや再描画毎の確保を避ける。
+全スレッドで共有する
+*/
+class MatPool
+{
+public:
+	//! 共有インスタンスの取得
+	static MatPool& Instance();
+
+	//! バッファの取得
+	/*!
+	同じサイズと型のバッファがプールにあれば再利用し、なければ新しく確保する
+	\param[in] size 画像サイズ
+	\param[in] type 画像の型
+	\return 画像バッファ（内容は不定）
+	*/
+	cv::Mat Acquire(const cv::Size& size, int type);
+
+	//! バッファの返却
+	/*!
+	ROIや外部データを参照している行列、他の行列とデータを共有している行列は返却しない。呼び出し後、matは空になる
+	\param[in,out] mat 返却するバッファ
+	*/
+	void Release(cv::Mat& mat);
+
+	//! サイズと型が異なる場合、または他の行列とバッファを共有している場合のみバッファを取り直す
+	void Recreate(cv::Mat& mat, const cv::Size& size, int type);
+
+	//! プール外で確保されたバッファを計上
+	/*!
+	imdecode等がバッファを確保し直した場合に使用
+	*/
+	void CountAllocation(const cv::Mat& mat);
+
+	//! 保持するバッファの上限(byte)
+	void SetCapacity(size_t bytes);
+
+	//! カウンタのリセット
+	void ResetCounters();
+
+	//! 統計の表示
+	void PrintStatus() const;
+
+	//! 大きな確保の回数
+	size_t num_large_allocations() const;
+
+private:
+	MatPool();
+
+	struct Key{
+		int rows, cols, type;
+		bool operator<(const Key& k) const{
+			if (rows != k.rows) return rows < k.rows;
+			if (cols != k.cols) return cols < k.cols;
+			return type < k.type;
+		}
+	};
+
+	mutable std::mutex _mutex;
+	std::list<std::pair<Key, cv::Mat>> _free;	//!< 未使用バッファ（古い順）
+	size_t _free_bytes;	//!< 未使用バッファの合計サイズ
+	size_t _capacity;	//!< 保持するバッファの上限
+
+	////// カウンタ //////
+	size_t _num_acquire;	//!< 取得回数
+	size_t _num_reuse;	//!< 再利用回数
+	size_t _num_alloc;	//!< 確保回数
+	size_t _num_large_alloc;	//!< 大きなバッファの確保回数
+	size_t _alloc_bytes;	//!< 確保したバイト数
+	//////////////////////
+
+	static size_t ByteSize(const cv::Mat& mat){
+		return mat.step * mat.rows;
+	}
+
+	//! 他の行列とデータを共有しているかどうか
+	static bool IsShared(const cv::Mat& mat);
+
+	MatPool(const MatPool&);
+	MatPool& operator=(const MatPool&);
+};
+
+#endif
@@ -0,0 +1,202 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "NavigationIndex.h"
+#include <algorithm>
+
+namespace{
+	const int NUM_SIZE_BUCKETS = 32;
+}
+
+
+NavigationIndex::NavigationIndex()
+{
+	_num_unannotated = 0;
+	_size_buckets.resize(NUM_SIZE_BUCKETS);
+}
+
+
+void NavigationIndex::Build(const std::vector<std::vector<cv::Rect>>& rectlist)
+{
+	int num = rectlist.size();
+	_counts.assign(num, 0);
+	_min_sizes.assign(num, -1);
+	_unannotated.assign((num + 63) / 64, 0);
+	_num_unannotated = 0;
+	_count_buckets.clear();
+	_size_buckets.assign(NUM_SIZE_BUCKETS, std::set<int>());
+	for (int i = 0; i < num; i++){
+		_counts[i] = rectlist[i].size();
+		_min_sizes[i] = MinMarkerSize(rectlist[i]);
+		Insert(i);
+	}
+}
+
+
+void NavigationIndex::Update(int idx, const std::vector<cv::Rect>& rects)
+{
+	if (idx < 0 || idx >= _counts.size())
+		return;
+	Remove(idx);
+	_counts[idx] = rects.size();
+	_min_sizes[idx] = MinMarkerSize(rects);
+	Insert(idx);
+}
+
+
+int NavigationIndex::MinMarkerSize(const std::vector<cv::Rect>& rects)
+{
+	int min_size = -1;
+	for (size_t i = 0; i < rects.size(); i++){
+		int size = std::max(rects[i].width, rects[i].height);
+		if (min_size < 0 || size < min_size)
+			min_size = size;
+	}
+	return min_size;
+}
+
+
+int NavigationIndex::SizeBucket(int size)
+{
+	int bucket = 0;
+	while (size > 1 && bucket < NUM_SIZE_BUCKETS - 1){
+		size >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+
+void NavigationIndex::Insert(int idx)
+{
+	if (_counts[idx] == 0){
+		_unannotated[idx / 64] |= (1ULL << (idx % 64));
+		_num_unannotated++;
+		return;
+	}
+	_count_buckets[_counts[idx]].insert(idx);
+	_size_buckets[SizeBucket(_min_sizes[idx])].insert(idx);
+}
+
+
+void NavigationIndex::Remove(int idx)
+{
+	if (_counts[idx] == 0){
+		_unannotated[idx / 64] &= ~(1ULL << (idx % 64));
+		_num_unannotated--;
+		return;
+	}
+	std::map<int, std::set<int>>::iterator it = _count_buckets.find(_counts[idx]);
+	if (it != _count_buckets.end()){
+		it->second.erase(idx);
+		if (it->second.empty())
+			_count_buckets.erase(it);
+	}
+	_size_buckets[SizeBucket(_min_sizes[idx])].erase(idx);
+}
+
+
+int NavigationIndex::NextUnannotated(int from) const
+{
+	int num = _counts.size();
+	if (from >= num)
+		return -1;
+	// 64画像ずつまとめて調べる
+	int w = from / 64;
+	uint64 bits = _unannotated[w] & (~0ULL << (from % 64));
+	while (true){
+		if (bits){
+			int b = 0;
+			while (!(bits & (1ULL << b)))
+				b++;
+			int idx = w * 64 + b;
+			return (idx < num) ? idx : -1;
+		}
+		if (++w >= _unannotated.size())
+			return -1;
+		bits = _unannotated[w];
+	}
+}
+
+
+int NavigationIndex::Find(int from, int to, int filter, int min_val, int max_val) const
+{
+	if (from >= to)
+		return -1;
+
+	if (filter == FILTER_UNANNOTATED){
+		int idx = NextUnannotated(from);
+		return (idx >= 0 && idx < to) ? idx : -1;
+	}
+
+	int found = -1;
+	if (filter == FILTER_COUNT){
+		// マーカー数0は未アノテーションのビット列から探す
+		if (min_val <= 0)
+			found = Find(from, to, FILTER_UNANNOTATED, 0, 0);
+		std::map<int, std::set<int>>::const_iterator it = _count_buckets.lower_bound(std::max(min_val, 1));
+		for (; it != _count_buckets.end() && it->first <= max_val; it++){
+			std::set<int>::const_iterator s = it->second.lower_bound(from);
+			if (s != it->second.end() && *s < to && (found < 0 || *s < found))
+				found = *s;
+		}
+	}
+	else if (filter == FILTER_SMALL){
+		// しきい値を含む区分のみ、各画像の大きさを確かめる
+		for (int b = 0; b <= SizeBucket(min_val); b++){
+			std::set<int>::const_iterator s = _size_buckets[b].lower_bound(from);
+			for (; s != _size_buckets[b].end() && *s < to && (found < 0 || *s < found); s++){
+				if (_min_sizes[*s] < min_val){
+					found = *s;
+					break;
+				}
+			}
+		}
+	}
+	return found;
+}
+
+
+int NavigationIndex::Next(int from, int filter, int min_val, int max_val) const
+{
+	int num = _counts.size();
+	if (num == 0)
+		return -1;
+	from = std::max(-1, std::min(from, num - 1));
+
+	// 現在の画像より後ろ、なければ先頭から現在の画像まで
+	int idx = Find(from + 1, num, filter, min_val, max_val);
+	if (idx < 0)
+		idx = Find(0, from + 1, filter, min_val, max_val);
+	return idx;
+}
@@ -0,0 +1,109 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __NAVIGATION_INDEX__
+#define __NAVIGATION_INDEX__
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+#include <map>
+#include <set>
+
+//! マーカーの数や大きさによる画像の索引
+/*!
+各画像のマーカー数と最小マーカーの大きさを保持し、条件に合う次の画像を画像を読み込まずに探す。
+未アノテーションの画像はビット列、マーカー数と大きさは区分ごとの画像IDの集合で管理し、マーカーの変更時に差分で更新する
+*/
+class NavigationIndex
+{
+public:
+	//////////// 絞り込み条件 //////////////
+	const static int FILTER_UNANNOTATED = 0;	//!< マーカーのない画像
+	const static int FILTER_COUNT = 1;	//!< マーカー数が範囲内の画像
+	const static int FILTER_SMALL = 2;	//!< 一辺がしきい値未満のマーカーを含む画像
+	////////////////////////////////////////
+
+	NavigationIndex();
+
+	//! 全画像のマーカーから作成
+	void Build(const std::vector<std::vector<cv::Rect>>& rectlist);
+
+	//! 1画像のマーカーの変更を反映
+	void Update(int idx, const std::vector<cv::Rect>& rects);
+
+	//! 条件に合う次の画像を検索
+	/*!
+	fromより後ろを探し、なければ先頭から探す
+	\param[in] from 現在の画像ID
+	\param[in] filter 絞り込み条件
+	\param[in] min_val FILTER_COUNTの場合はマーカー数の下限、FILTER_SMALLの場合はマーカーの大きさのしきい値
+	\param[in] max_val FILTER_COUNTの場合はマーカー数の上限
+	\return 画像ID。なければ-1
+	*/
+	int Next(int from, int filter, int min_val = 0, int max_val = 0) const;
+
+	//! マーカーのない画像の数
+	int num_unannotated() const{
+		return _num_unannotated;
+	}
+
+	int size() const{
+		return _counts.size();
+	}
+
+private:
+	std::vector<uint64> _unannotated;	//!< マーカーのない画像のビット列
+	int _num_unannotated;	//!< マーカーのない画像の数
+	std::vector<int> _counts;	//!< 各画像のマーカー数
+	std::vector<int> _min_sizes;	//!< 各画像の最小マーカーの長辺（マーカーがなければ-1）
+	std::map<int, std::set<int>> _count_buckets;	//!< マーカー数ごとの画像ID（1以上）
+	std::vector<std::set<int>> _size_buckets;	//!< 最小マーカーの長辺の2の対数ごとの画像ID
+
+	//! 最小マーカーの長辺
+	static int MinMarkerSize(const std::vector<cv::Rect>& rects);
+
+	//! 大きさの区分
+	static int SizeBucket(int size);
+
+	//! 索引へ追加/削除
+	void Insert(int idx);
+	void Remove(int idx);
+
+	//! from以上で最初のマーカーのない画像（なければ-1）
+	int NextUnannotated(int from) const;
+
+	//! [from, to)で条件に合う最初の画像（なければ-1）
+	int Find(int from, int to, int filter, int min_val, int max_val) const;
+};
+
+#endif
@@ -33,14 +33,26 @@
 #include "ObjectMarker.h"
 #include "util_functions.h"
 #include "util_cv_functions.h"
+#include "MatPool.h"
+#include "LatencyProfiler.h"
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 
 using namespace std;
 
 ObjectMarker::ObjectMarker(){
+	_waiting_proposal = false;
+	_nav_filter = NavigationIndex::FILTER_UNANNOTATED;
+	_nav_min = _nav_max = 0;
+	_image_loader.SetThumbnailCache(&_thumbnails);
+	_dedup.SetThumbnailCache(&_thumbnails);
 }
 
 
@@ -50,8 +62,7 @@ ObjectMarker::~ObjectMarker(void){
 
 
 bool ObjectMarker::saveConfiguration(const std::string& config_name,
-	const std::string& input_dir, const std::string& outputname,
-	const MarkerViewer& marker_viewer)
+	const std::string& input_dir, const std::string& outputname) const
 {
 	cv::FileStorage fs(config_name, cv::FileStorage::WRITE);
 
@@ -59,30 +70,60 @@ bool ObjectMarker::saveConfiguration(const std::string& config_name,
 		return false;
 
 	fs << "image_folder" << input_dir;
+	fs << "image_list" << _input_list;
 	fs << "output_file" << outputname;
-	marker_viewer.Write(fs, "Viewer");
+	_marker_viewer.Write(fs, "Viewer");
+	_image_loader.Write(fs, "Loader");
+	_scanner.Write(fs, "Scanner");
+	_content_index.Write(fs, "ContentIndex");
+	_dedup.Write(fs, "Dedup");
+	_thumbnails.Write(fs, "Thumbnail");
+	_probe.Write(fs, "Probe");
+	_validator.Write(fs, "Validator");
+	_contact_sheet.Write(fs, "ContactSheet");
+	_tracker.Write(fs, "Tracker");
+	_pre_annotator.Write(fs, "PreAnnotator");
+	_work_queue.Write(fs, "WorkQueue");
+	_server.Write(fs, "Server");
+	LatencyProfiler::Instance().Write(fs, "Profiler");
 
 	return true;
 }
 
 
 bool ObjectMarker::loadConfiguration(const std::string& config_name,
-	std::string& input_dir, std::string& outputname,
-	MarkerViewer& marker_viewer)
+	std::string& input_dir, std::string& outputname)
 {
 	cv::FileStorage fs(config_name, cv::FileStorage::READ);
 	if (!fs.isOpened())
 		return false;
 
 	fs["image_folder"] >> input_dir;
+	fs["image_list"] >> _input_list;
 	fs["output_file"] >> outputname;
-	marker_viewer.Read(fs["Viewer"]);
+	_marker_viewer.Read(fs["Viewer"]);
+	_image_loader.Read(fs["Loader"]);
+	_scanner.Read(fs["Scanner"]);
+	_content_index.Read(fs["ContentIndex"]);
+	_dedup.Read(fs["Dedup"]);
+	_thumbnails.Read(fs["Thumbnail"]);
+	_probe.Read(fs["Probe"]);
+	_validator.Read(fs["Validator"]);
+	_contact_sheet.Read(fs["ContactSheet"]);
+	_tracker.Read(fs["Tracker"]);
+	_pre_annotator.Read(fs["PreAnnotator"]);
+	_work_queue.Read(fs["WorkQueue"]);
+	_server.Read(fs["Server"]);
+	LatencyProfiler::Instance().Read(fs["Profiler"]);
+
+	// 縮小画像を保存しない場合、重複検出は原画像を縮小デコードする方が速い
+	_dedup.SetThumbnailCache(_thumbnails.is_persistent() ? &_thumbnails : NULL);
 	return true;
 }
 
 
 void ObjectMarker::printHelp() {
-	printf("\nObject Marker: \n\t 摜̃IuWFNgʒuL^邽߂̃c[\n");
+	printf("\nObject Marker: \n\t 画像中のオブジェクト位置を記録するためのツール\n");
 	printf("\tGunawan Herman, April 2006\n");
 	printf("\tAdapted from ObjectMarker.cpp by A.Florian\n");
 	printf("\tModified and localized by Takuya MINAGAWA in 2014\n");
@@ -90,97 +131,203 @@ void ObjectMarker::printHelp() {
 	printf("------------------------------------------------------------\n");
 	printf("|  btn  |               function                           |\n");
 	printf("|-------|--------------------------------------------------|\n");
-	printf("|Enter  | ݂̃}[J[t@CɋLqA               |\n");
-	printf("|       | ̉摜ǂݍ                               |\n");
-	printf("|Space  | EnterƓ                                      |\n");
-	printf("|BS     | ЂƂỎ摜ɖ߂                             |\n");
-	printf("|ESC    | vOI                                 |\n");
-	printf("|d      | ԐV}[J[                         |\n");
-	printf("|r      | Ot[̃}[J[PĂяo               |\n");
-	printf("|8      | ԐV}[J[1 px֓               |\n");
-	printf("|9      | ԐV}[J[10px֓               |\n");
-	printf("|2      | ԐV}[J[1 px֓               |\n");
-	printf("|3      | ԐV}[J[10px֓               |\n");
-	printf("|4      | ԐV}[J[1 px֓               |\n");
-	printf("|5      | ԐV}[J[10px֓               |\n");
-	printf("|6      | ԐV}[J[1 pxE֓               |\n");
-	printf("|7      | ԐV}[J[10pxE֓               |\n");
-	printf("|w      | ԐV}[J[̕1 pxg傷             |\n");
-	printf("|W      | ԐV}[J[̕1 pxk             |\n");
-	printf("|h      | ԐV}[J[̍1 pxg傷           |\n");
-	printf("|H      | ԐV}[J[̍1 pxk           |\n");
-	printf("|z      | ԐV}[J[̂傫2%%g傷         |\n");
-	printf("|Z      | ԐV}[J[̂傫2%%k         |\n");
-	printf("|m      | }[J[̏cŒ^Œ             |\n");
-	printf("|a      | }[J[̏cw肷                       |\n");
-	printf("|s      | 摜̕\TCYύX                       |\n");
-	printf("|c      | }[J[̈̉摜؂ăt@Cۑ       |\n");
-	printf("|p      | }[J[`łȂ_             |\n");
-	printf("|e      | t[ɂ}[J[Wʏo         |\n");
-	printf("|g      | KCh̕\/\                              |\n");
-	printf("|G      | KCh̐ݒ                                     |\n");
-	printf("|f      | 摜̃tH_ύX                           |\n");
-	printf("|o      | o̓t@CύX                               |\n");
-	printf("|O      | o̓t@C𐬌`ĐVɍ쐬                 |\n");
-	printf("|j      | wԍ̉摜փWv                         |\n");
-	printf("|t      | ̃wv\                                 |\n");
+	printf("|Enter  | 現在のマーカーをファイルに記述し、               |\n");
+	printf("|       | 次の画像を読み込む                               |\n");
+	printf("|Space  | Enterと同じ                                      |\n");
+	printf("|BS     | ひとつ前の画像に戻る                             |\n");
+	printf("|ESC    | プログラムを終了                                 |\n");
+	printf("|d      | 一番新しいマーカーを消去                         |\n");
+	printf("|r      | 前フレームのマーカーを１つ呼び出す               |\n");
+	printf("|R      | 前フレームのマーカーを追跡して呼び出す           |\n");
+	printf("|y      | 検出器のマーカー候補（水色）を採用する           |\n");
+	printf("|i      | 指定範囲のマーカーを前後の画像から補間           |\n");
+	printf("|u      | 直前のマーカー編集を元に戻す（Ctrl+Zも可）       |\n");
+	printf("|U      | 元に戻した編集をやり直す（Ctrl+Yも可）           |\n");
+	printf("|8      | 一番新しいマーカーを1 px上へ動かす               |\n");
+	printf("|9      | 一番新しいマーカーを10px上へ動かす               |\n");
+	printf("|2      | 一番新しいマーカーを1 px下へ動かす               |\n");
+	printf("|3      | 一番新しいマーカーを10px下へ動かす               |\n");
+	printf("|4      | 一番新しいマーカーを1 px左へ動かす               |\n");
+	printf("|5      | 一番新しいマーカーを10px左へ動かす               |\n");
+	printf("|6      | 一番新しいマーカーを1 px右へ動かす               |\n");
+	printf("|7      | 一番新しいマーカーを10px右へ動かす               |\n");
+	printf("|w      | 一番新しいマーカーの幅を1 px拡大する             |\n");
+	printf("|W      | 一番新しいマーカーの幅を1 px縮小する             |\n");
+	printf("|h      | 一番新しいマーカーの高さを1 px拡大する           |\n");
+	printf("|H      | 一番新しいマーカーの高さを1 px縮小する           |\n");
+	printf("|z      | 一番新しいマーカーのを大きさを2%%拡大する         |\n");
+	printf("|Z      | 一番新しいマーカーのを大きさを2%%縮小する         |\n");
+	printf("|b      | 一番新しいマーカーを物体の輪郭に合わせる         |\n");
+	printf("|m      | マーカーの縦横比を固定／固定解除する             |\n");
+	printf("|a      | マーカーの縦横比を指定する                       |\n");
+	printf("|s      | 画像の表示サイズを変更する                       |\n");
+	printf("|c      | マーカー領域の画像を切り取ってファイル保存       |\n");
+	printf("|p      | マーカーを矩形だけでなく点を許可する             |\n");
+	printf("|e      | 現フレームにつけたマーカー座標を画面出力         |\n");
+	printf("|g      | ガイドの表示/非表示                              |\n");
+	printf("|G      | ガイドの設定                                     |\n");
+	printf("|f      | 画像のフォルダ名を変更                           |\n");
+	printf("|o      | 出力ファイルを変更                               |\n");
+	printf("|O      | 出力ファイルを成形して新たに作成                 |\n");
+	printf("|j      | 指定番号の画像へジャンプ                         |\n");
+	printf("|/      | ファイル名で検索して一致した次の画像へ           |\n");
+	printf("|v      | 縮小画像を一覧表示し、クリックした画像へ         |\n");
+	printf("|V      | 出力ファイルを検査（修正したファイルも出力可）   |\n");
+	printf("|n      | 条件（初期はマーカーなし）に合う次の画像へ       |\n");
+	printf("|N      | 次の画像を探す条件を設定してジャンプ             |\n");
+	printf("|Q      | 作業キューの全作業者の出力を統合                 |\n");
+	printf("|D      | ほぼ同じ画像を検出                               |\n");
+	printf("|x      | バックグラウンド処理（c, f, O, Q）を中断         |\n");
+	printf("|M      | 画像バッファの確保回数を表示してリセット         |\n");
+	printf("|L      | 処理段階ごとの所要時間を表示                     |\n");
+	printf("|t      | このヘルプを表示                                 |\n");
 	printf("------------------------------------------------------------\n");
-	printf("IuWFNgENbNőI\n");
+	printf("オブジェクトを右クリックで選択\n");
 	printf("\n");
 }
 
 void ObjectMarker::printStatus() const
 {
-	std::cout << "̃vO͓͉摜'" << _input_dir << "'tH_̒T܂\n";
-	std::cout << "IuWFNg̈ʒu̓t@C'" << _annotation_file << "'ɃeLXgo͂܂\n";
+	if (_input_list.empty())
+		std::cout << "このプログラムは入力画像を'" << _input_dir << "'フォルダの中から探します\n";
+	else
+		std::cout << "このプログラムは入力画像を" << (_file_list.is_video() ? "動画" : "画像リスト") << "'" << _input_list << "'から読み込みます\n";
+	std::cout << "オブジェクトの位置はファイル'" << _annotation_file << "'にテキスト出力されます\n";
 	_marker_viewer.PrintStatus();
+	_image_loader.PrintStatus();
+	_scanner.PrintStatus();
+	_content_index.PrintStatus();
+	_dedup.PrintStatus();
+	_thumbnails.PrintStatus();
+	_probe.PrintStatus();
+	_validator.PrintStatus();
+	_contact_sheet.PrintStatus();
+	_pre_annotator.PrintStatus();
+	_work_queue.PrintStatus();
+	_server.PrintStatus();
+	_task_executor.PrintStatus();
 }
 
 
-//! Ame[V̕ёւ
+//! アノテーションの並び替え
 /*!
-[hꂽAme[VɑΉ摜t@CAQƉ摜t@CƑΉ悤ɕёւ
-\param[in] loaded_img_list ͉摜Xg
-\param[in] loaded_annotation ǂݍ܂ꂽAme[V
-\param[in] ref_img_list QƃAme[V
-\return ꂽAme[V
+ロードされたアノテーションに対応する画像ファイル名が、参照画像ファイル名と対応するように並び替え
+\param[in] loaded_img_list 入力画像リスト
+\param[in] loaded_annotation 読み込まれたアノテーション
+\param[in] ref_img_list 参照アノテーション
+\return 整理されたアノテーション
 */
 std::vector<std::vector<cv::Rect>> ObjectMarker::reorderAnnotation(
 	const std::vector<std::string>& loaded_img_list,
 	const std::vector<std::vector<cv::Rect>>& loaded_annotation,
-	const std::vector<std::string>& ref_img_list)
+	const ImageList& ref_img_list, const ContentIndex::HashTable* hashes)
 {
 	assert(loaded_img_list.size() == loaded_annotation.size());
-	using namespace boost::filesystem;
 
 	std::vector<std::vector<cv::Rect>> annotation(ref_img_list.size());
 
+	// 読み込んだ画像パスの索引（同じ画像が複数回記録されている場合は最新のものを使う）
+	std::unordered_map<std::string, int> loaded_index;
 	int num_loaded = loaded_img_list.size();
+	for (int i = 0; i < num_loaded; i++){
+		loaded_index[NormalizePath(loaded_img_list[i])] = i;
+	}
+
+	if (loaded_index.empty())
+		return annotation;
+
 	int num_ref = ref_img_list.size();
+	std::string ref_path;
+	std::vector<int> unmatched;
+	for (int j = 0; j < num_ref; j++){
+		ref_img_list.Get(j, ref_path);
+		std::unordered_map<std::string, int>::const_iterator it = loaded_index.find(NormalizePath(ref_path));
+		if (it != loaded_index.end())
+			annotation[j] = loaded_annotation[it->second];
+		else
+			unmatched.push_back(j);
+	}
 
-	int i,j;
-	for (i = 0; i < num_loaded; i++){
-		path loaded_img_path = path(loaded_img_list[i]);
-		for (j = 0; j < num_ref; j++){
-			if (loaded_img_path.compare(ref_img_list[j]) == 0)
-				break;
-		}
+	if (!hashes || unmatched.empty())
+		return annotation;
 
-		if (j < num_ref)
-			annotation[j] = loaded_annotation[i];
+	// パスの一致しなかった画像は、記録された画像と内容が一致すれば対応付ける
+	std::unordered_map<uint64, int> hash_index;
+	for (int i = 0; i < num_loaded; i++){
+		ContentIndex::HashTable::const_iterator h = hashes->find(ContentIndex::NormalizePath(loaded_img_list[i]));
+		if (h != hashes->end())
+			hash_index[h->second] = i;
+	}
+	for (size_t k = 0; k < unmatched.size(); k++){
+		ref_img_list.Get(unmatched[k], ref_path);
+		ContentIndex::HashTable::const_iterator h = hashes->find(ContentIndex::NormalizePath(ref_path));
+		if (h == hashes->end())
+			continue;
+		std::unordered_map<uint64, int>::const_iterator it = hash_index.find(h->second);
+		if (it != hash_index.end())
+			annotation[unmatched[k]] = loaded_annotation[it->second];
 	}
 
 	return annotation;
 }
 
 
+bool ObjectMarker::IsAnnotationFile(const std::string& filename) const
+{
+	// 出力ファイルは読み込み時にヘッダを書き込んで作成済みのため、実体で比較できる
+	boost::system::error_code ec;
+	return boost::filesystem::equivalent(filename, _annotation_file, ec) && !ec;
+}
+
+
+//! 比較用にパスの区切り文字を統一
+const std::string& ObjectMarker::NormalizePath(std::string& path)
+{
+#ifdef WIN32
+	std::replace(path.begin(), path.end(), '\\', '/');
+#endif
+	return path;
+}
+
+
+std::string ObjectMarker::NormalizePath(const std::string& path)
+{
+	std::string dst = path;
+	NormalizePath(dst);
+	return dst;
+}
+
+
+bool ObjectMarker::ReadImageList(const std::string& source, const DirectoryScanner& scanner,
+	ImageList& file_list, const util::ProgressCallback& progress)
+{
+	// 動画ファイルであれば各フレーム、それ以外のファイルであれば画像リスト、フォルダであれば走査
+	if (boost::filesystem::is_regular_file(source)){
+		if (VideoSource::IsVideoFile(source)){
+			VideoSource video;
+			if (!video.Open(source, progress))
+				return false;
+			file_list.AssignVideo(source, video.num_frames());
+			return true;
+		}
+		return file_list.LoadManifest(source) && !file_list.empty();
+	}
+
+	std::vector<std::string> files;
+	if (!scanner.Scan(source, files, progress) || files.empty())
+		return false;
+	file_list.Assign(files);
+	return true;
+}
+
+
 bool ObjectMarker::Load(const std::string& image_dir, const std::string& anno_file)
 {
-	// tH_摜ꗗ擾
+	// フォルダ、または画像リストファイルから画像一覧を取得
 	std::string input_dir = image_dir;
 	_file_list.clear();
-	while (!util::ReadImageFilesInDirectory(input_dir, _file_list)){
-		std::cout << "no appropriate input files in directory " << input_dir << std::endl;
+	while (!ReadImageList(input_dir, _scanner, _file_list)){
+		std::cout << "no appropriate input files in " << input_dir << std::endl;
 		std::string flag = util::AskQuestionGetString("Quit?(1:Yes, 0:No): ");
 		if (flag == "1")
 			return false;
@@ -188,69 +335,392 @@ bool ObjectMarker::Load(const std::string& image_dir, const std::string& anno_fi
 	}
 
 	_image_idx = 0;
+	_pre_annotator.SetFileList(_file_list);
+	_work_queue.SetImageCount(_file_list.size());
+	ResetDuplicates();
+	BuildNameIndex();
+	if (_thumbnails.is_prefetch())
+		GenerateThumbnails();
 
-	_input_dir = input_dir;
+	SetInputSource(input_dir);
 
 	return LoadAnnotationFile(anno_file);
 }
 
 
+void ObjectMarker::SetInputSource(const std::string& source)
+{
+	if (_file_list.is_manifest() || _file_list.is_video())
+		_input_list = source;
+	else{
+		_input_dir = source;
+		_input_list.clear();
+	}
+}
+
+
 bool ObjectMarker::LoadAnnotationFile(const std::string& anno_file)
 {
-	// Ame[Vt@Cǂݍ
+	// アノテーションファイルを読み込み
 	std::vector<std::string> anno_file_list;
 	std::vector<std::vector<cv::Rect>> anno_rect_list;
 	util::LoadAnnotationFile(anno_file, anno_file_list, anno_rect_list);
 
-	// tH_̉摜ꗗƃAme[Vt@CRÂ
+	// フォルダの画像一覧とアノテーションファイルを紐づけ
 	_rectlist = reorderAnnotation(anno_file_list, anno_rect_list, _file_list);
+	_nav_index.Build(_rectlist);
+	_marker_viewer.ClearHistory();
+	_server.SetDataset(_file_list, _rectlist);
+	if (_content_index.is_enabled() && !_file_list.is_video())
+		MatchAnnotationByContent(anno_file_list, anno_rect_list);
 	anno_file_list.clear();
 	anno_rect_list.clear();
 
 	_annotation_file = anno_file;
+	_work_queue.SetOutputFile(anno_file);
 
-	// wb_̏
+	// ヘッダの書き込み
 	return !util::AddHeaderLine(anno_file);
 }
 
 
 
-bool ObjectMarker::jump(int idx)
+void ObjectMarker::SaveCurrentMarkers()
 {
 	if (_marker_viewer.is_changed()){
+		LATENCY_SCOPE(STAGE_SAVE_MARKERS);
 		_rectlist[_image_idx] = _marker_viewer.GetMarkers();
 		util::AddAnnotationLine(_annotation_file, _file_list[_image_idx], _rectlist[_image_idx]);
+		_server.SetAnnotation(_image_idx, _rectlist[_image_idx]);
+		_nav_index.Update(_image_idx, _rectlist[_image_idx]);
 		_marker_viewer.reset_change();
+		CopyToDuplicates(_image_idx);
+	}
+}
+
+
+bool ObjectMarker::begin()
+{
+	if (_work_queue.is_enabled())
+		return nextChunk();
+	return jump(0);
+}
+
+
+bool ObjectMarker::next()
+{
+	int idx = skipDuplicates(_image_idx + 1);
+	if (!_work_queue.is_enabled())
+		return jump(idx);
+
+	if (_work_queue.contains(idx) && idx < _file_list.size()){
+		if (_work_queue.Renew())
+			return jump(idx);
+		std::cout << "The lease has expired and was taken over by another annotator." << std::endl;
 	}
+	return nextChunk();
+}
+
+
+bool ObjectMarker::nextChunk()
+{
+	// チャンクを完了として記録する前に、現在の画像のマーカーを書き込む
+	SaveCurrentMarkers();
+
+	int begin, end;
+	if (!_work_queue.Acquire(begin, end)){
+		std::cout << "No more images left in the work queue." << std::endl;
+		return false;
+	}
+
+	// 再開したチャンクでは、まだマーカーのない画像から始める
+	int idx = begin;
+	while (idx < end - 1 && !_rectlist[idx].empty())
+		idx++;
+	std::cout << "Images " << begin + 1 << " - " << end << " are assigned." << std::endl;
+	return jump(idx);
+}
+
+
+bool ObjectMarker::jump(int idx)
+{
+	LATENCY_SCOPE(STAGE_JUMP);
+	SaveCurrentMarkers();
 
 	if (idx < 0 || idx >= _file_list.size())
 		return false;
 
+	// 追跡用に現在の表示画像を記録
+	if (_marker_viewer.is_open())
+		_tracker.SetReference(_marker_viewer.GetImage(), _image_idx);
+
 	std::string load_img_file = _file_list[idx];
-	cv::Mat img = cv::imread(load_img_file);
-	if (img.empty()){
+	cv::Mat img;
+	cv::Size org_size;
+	if (!_image_loader.Load(load_img_file, _marker_viewer.GetDisplayScale(), img, org_size)){
 		std::cerr << "Fail to read file " << load_img_file << "." << std::endl;
 		return false;
 	}
 
-	// }[J[Zbg
-	_marker_viewer.SetMarkers(_rectlist[idx]);
-	_marker_viewer.reset_change();
+	// マーカーをセット
+	_marker_viewer.LoadMarkers(_rectlist[idx], idx);
+
+	// マーカーのない画像には検出器の候補を表示（"y"キーで採用するまで記録しない）
+	_pre_annotator.Request(idx);
+	_waiting_proposal = false;
+	if (_rectlist[idx].empty() && _pre_annotator.is_enabled()){
+		std::vector<cv::Rect> proposals;
+		if (!_pre_annotator.Fetch(idx, proposals))
+			_waiting_proposal = true;
+		else if (!proposals.empty())
+			_marker_viewer.SetSuggestions(proposals);
+	}
 	
 	std::ostringstream oss;
 	oss << idx + 1 << " - " << load_img_file;
-	_marker_viewer.Open(img, oss.str());
+	_marker_viewer.Open(img, oss.str(), org_size);
+	MatPool::Instance().Release(img);
 
 	_image_idx = idx;
+	if (idx < _duplicate_of.size() && _duplicate_of[idx] >= 0)
+		std::cout << "Image " << idx + 1 << " is a near-duplicate of image " << _duplicate_of[idx] + 1 << "." << std::endl;
 
 	return true;
 }
 
 
-//! Ame[Vt@C𐮌`ďo
-inline bool ObjectMarker::ExportAnnotationFile(const std::string& filename){
-	return util::SaveAnnotationFile(filename, _file_list, _rectlist);
-};
+bool ObjectMarker::jumpToMatch()
+{
+	// 現在の画像の編集を索引に反映してから探す
+	SaveCurrentMarkers();
+	int idx = _nav_index.Next(_image_idx, _nav_filter, _nav_min, _nav_max);
+	if (idx < 0)
+		return false;
+	return jump(idx);
+}
+
+
+bool ObjectMarker::searchFileName(const std::string& pattern, bool prefix)
+{
+	if (!_name_index){
+		std::cout << "The file name index is not ready yet." << std::endl;
+		return false;
+	}
+	std::vector<int> indices;
+	_name_index->Search(pattern, prefix, indices);
+	std::cout << indices.size() << " images match \"" << pattern << "\"." << std::endl;
+	if (indices.empty())
+		return false;
+
+	std::vector<int>::const_iterator it = std::upper_bound(indices.begin(), indices.end(), _image_idx);
+	if (it == indices.end())
+		it = indices.begin();
+	SaveCurrentMarkers();
+	return jump(*it);
+}
+
+
+void ObjectMarker::ReviewContactSheet()
+{
+	if (_file_list.is_video()){
+		std::cout << "The contact sheet is not available for video frames." << std::endl;
+		return;
+	}
+	SaveCurrentMarkers();
+
+	if (!_thumbnail_list.shares(_file_list))
+		GenerateThumbnails();
+
+	// 一覧表示中もHTTPでの更新とバックグラウンド処理の完了は処理する
+	_marker_viewer.Close();
+	int idx = _contact_sheet.Review(_file_list, _rectlist, _image_idx, _thumbnails, [this](){
+		ApplyServerUpdates();
+		_task_executor.ProcessEvents();
+		return _task_executor.is_busy() || _server.is_running();
+	});
+	jump(idx >= 0 ? idx : _image_idx);
+}
+
+
+void ObjectMarker::ValidateAnnotation(const std::string& repaired_file)
+{
+	// 検査中も出力ファイルへの追記は続くため、出力ファイル自体は置き換えない
+	if (!repaired_file.empty() && IsAnnotationFile(repaired_file)){
+		std::cerr << "Can't overwrite the output file " << _annotation_file << " while annotating." << std::endl;
+		return;
+	}
+
+	// 現在の画像の編集をファイルへ書き込んでから検査
+	SaveCurrentMarkers();
+	std::string anno_file = _annotation_file;
+	ImageProbe probe = _probe;
+	AnnotationValidator validator = _validator;
+	std::shared_ptr<std::vector<AnnotationIssue>> issues = std::make_shared<std::vector<AnnotationIssue>>();
+	_task_executor.Post("validate " + anno_file,
+		[anno_file, probe, validator, issues, repaired_file](TaskContext& ctx){
+			return validator.Validate(anno_file, probe, *issues, repaired_file, ctx.ProgressCallback());
+		},
+		[this, anno_file, issues](bool success){
+			if (!success){
+				std::cerr << "Fail to validate annotation file " << anno_file << "." << std::endl;
+				return;
+			}
+			ReportValidation(anno_file, *issues);
+		});
+}
+
+
+void ObjectMarker::ReportValidation(const std::string& anno_file, const std::vector<AnnotationIssue>& issues) const
+{
+	const std::string& report_file = _validator.report_file();
+	std::ofstream ofs(report_file);
+	if (ofs.is_open())
+		AnnotationValidator::WriteReport(ofs, anno_file, issues);
+	else
+		std::cerr << "Fail to write lint report " << report_file << "." << std::endl;
+
+	// コンソールには先頭の数件のみ
+	const size_t num_print = 10;
+	std::vector<AnnotationIssue> head(issues.begin(), issues.begin() + std::min(issues.size(), num_print));
+	AnnotationValidator::WriteReport(std::cout, anno_file, head);
+	if (issues.size() > num_print)
+		std::cout << "... (see " << report_file << ")" << std::endl;
+	AnnotationValidator::PrintSummary(std::cout, issues);
+}
+
+
+int ObjectMarker::lint(const std::string& conf_file, const std::string& repaired_file)
+{
+	std::string annotation_file;
+	std::string input_dir;
+	loadConfiguration(conf_file, input_dir, annotation_file);
+	if (annotation_file.empty())
+		annotation_file = "annotation.txt";
+
+	std::vector<AnnotationIssue> issues;
+	if (!_validator.Validate(annotation_file, _probe, issues, repaired_file)){
+		std::cerr << "Fail to validate annotation file " << annotation_file << "." << std::endl;
+		return 2;
+	}
+	ReportValidation(annotation_file, issues);
+	return issues.empty() ? 0 : 1;
+}
+
+
+void ObjectMarker::GenerateThumbnails()
+{
+	if (!_thumbnails.is_persistent() || _file_list.is_video())
+		return;
+
+	// 画像一覧全体の縮小画像を現在の画像から順に作成してキャッシュへ保存
+	_thumbnail_list = _file_list;
+	ImageList file_list = _file_list;
+	ThumbnailCache* thumbnails = &_thumbnails;
+	int start = _image_idx;
+	_task_executor.Post("thumbnails",
+		[file_list, thumbnails, start](TaskContext& ctx){
+			return thumbnails->Generate(file_list, start, ctx.ProgressCallback());
+		},
+		[this, file_list](bool success){
+			if (!success && _thumbnail_list.shares(file_list))
+				_thumbnail_list.clear();
+		});
+}
+
+
+void ObjectMarker::SetNavigationFilter(int filter, int min_val, int max_val)
+{
+	_nav_filter = filter;
+	_nav_min = min_val;
+	_nav_max = max_val;
+}
+
+
+int ObjectMarker::WaitKey()
+{
+	while (true){
+		// 原寸画像のデコード待ちやバックグラウンド処理の実行中はキー入力をポーリング
+		int delay = 0;
+		if (_image_loader.is_pending())
+			delay = 10;
+		else if (_task_executor.is_busy() || _waiting_proposal || _server.is_running())
+			delay = 30;
+		else if (_work_queue.is_assigned())
+			delay = 1000;	// 同じ画像を開いたままでもリースを延長する
+
+		int key = _marker_viewer.GetWindowKey(delay);
+
+		// 画像の移動の有無にかかわらず、割り当て中のチャンクのリースを延長
+		if (_work_queue.is_assigned() && !_work_queue.Renew())
+			std::cout << "The lease has expired and was taken over by another annotator." << std::endl;
+
+		if (key >= 0)
+			return key;
+
+		cv::Mat img;
+		if (_image_loader.Fetch(img)){
+			_marker_viewer.UpdateImage(img);
+			MatPool::Instance().Release(img);
+		}
+
+		if (_waiting_proposal && !_pre_annotator.is_pending(_image_idx)){
+			_waiting_proposal = false;
+			// 候補は表示するだけなので、待っている間に編集したマーカーはそのまま残る
+			std::vector<cv::Rect> proposals;
+			if (_pre_annotator.Fetch(_image_idx, proposals) && !proposals.empty())
+				_marker_viewer.SetSuggestions(proposals);
+		}
+
+		ApplyServerUpdates();
+		_task_executor.ProcessEvents();
+	}
+}
+
+
+void ObjectMarker::ApplyServerUpdates()
+{
+	std::vector<int> indices;
+	std::vector<std::vector<cv::Rect>> rectlist;
+	if (!_server.PopUpdates(indices, rectlist))
+		return;
+
+	bool current = false;
+	for (int i = 0; i < indices.size(); i++){
+		_rectlist[indices[i]] = rectlist[i];
+		_nav_index.Update(indices[i], rectlist[i]);
+		_marker_viewer.ClearHistory(indices[i]);
+		current |= (indices[i] == _image_idx);
+	}
+	if (!util::AddAnnotationLines(_annotation_file, _file_list, indices, rectlist))
+		std::cerr << "Fail to write annotation to file " << _annotation_file << "." << std::endl;
+
+	// 表示中の画像が更新された場合、手元で編集していなければ表示に反映
+	if (current && !_marker_viewer.is_changed())
+		_marker_viewer.LoadMarkers(_rectlist[_image_idx], _image_idx);
+}
+
+
+//! アノテーションファイルを整形して出力
+void ObjectMarker::ExportAnnotationFile(const std::string& filename)
+{
+	// 出力中も出力ファイルへの追記は続くため、出力ファイル自体は置き換えない
+	if (IsAnnotationFile(filename)){
+		std::cerr << "Can't overwrite the output file " << _annotation_file << " while annotating." << std::endl;
+		return;
+	}
+
+	// 処理中も編集を続けられるよう、現時点のアノテーションを複製して渡す
+	ImageList file_list = _file_list;
+	std::vector<std::vector<cv::Rect>> rectlist = _rectlist;
+	_user_tasks.push_back(_task_executor.Post("export " + filename,
+		[filename, file_list, rectlist](TaskContext& ctx){
+			return util::SaveAnnotationFile(filename, file_list, rectlist, " ", ctx.ProgressCallback());
+		},
+		[filename](bool success){
+			if (!success)
+				std::cerr << "Fail to export annotation to file " << filename << "." << std::endl;
+		}));
+}
 
 
 void ObjectMarker::CopyFormerMarkers()
@@ -262,37 +732,336 @@ void ObjectMarker::CopyFormerMarkers()
 	}
 }
 
-//! Ame[Vŉ摜؂ĕۑ
-inline void ObjectMarker::CropAndSaveImages(const std::string& dir_name){
-	util::CropAnnotatedImageRegions(dir_name, _file_list, _rectlist);
+void ObjectMarker::TrackFormerMarkers()
+{
+	if (_image_idx <= 0 || _rectlist[_image_idx - 1].empty())
+		return;
+
+	std::vector<cv::Rect> rects;
+	int64 start = cv::getTickCount();
+	if (_tracker.reference_idx() != _image_idx - 1 ||
+		!_tracker.Track(_marker_viewer.GetImage(), _rectlist[_image_idx - 1], _marker_viewer.GetDisplayScale(), rects)){
+		std::cout << "No reference image to track from. Markers are copied." << std::endl;
+		CopyFormerMarkers();
+		return;
+	}
+	double msec = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+	_marker_viewer.SetMarkers(rects);
+	std::cout << rects.size() << " markers tracked in " << msec << " ms." << std::endl;
+}
+
+void ObjectMarker::InterpolateMarkers(int begin, int end, bool spline)
+{
+	SaveCurrentMarkers();
+
+	// 画像を読み込まずに座標だけで補間する
+	std::vector<int> filled;
+	util::InterpolateMarkers(_rectlist, begin, end, spline, filled);
+	std::cout << filled.size() << " images interpolated." << std::endl;
+	if (filled.empty())
+		return;
+
+	// 補間した画像の分だけを追記
+	std::vector<std::vector<cv::Rect>> rectlist;
+	for (int i = 0; i < filled.size(); i++){
+		rectlist.push_back(_rectlist[filled[i]]);
+		// 履歴の外で書き換えたため、補間した画像の履歴は使えない
+		_marker_viewer.ClearHistory(filled[i]);
+		_server.SetAnnotation(filled[i], _rectlist[filled[i]]);
+		_nav_index.Update(filled[i], _rectlist[filled[i]]);
+	}
+	// 中断されて表示と出力ファイルが食い違わないよう、他の追記と同じくこのスレッドで書き込む
+	if (!util::AddAnnotationLines(_annotation_file, _file_list, filled, rectlist))
+		std::cerr << "Fail to write interpolated markers to " << _annotation_file << "." << std::endl;
+
+	if (std::find(filled.begin(), filled.end(), _image_idx) != filled.end())
+		this->reload();
+}
+
+
+void ObjectMarker::MergeWorkQueueOutputs()
+{
+	std::vector<std::string> outputs;
+	if (!_work_queue.GetCompletedOutputs(outputs)){
+		std::cout << "Work queue is not enabled." << std::endl;
+		return;
+	}
+	int chunk_size = _work_queue.chunk_size();
+
+	ImageList file_list = _file_list;
+	std::string merged_file = _work_queue.merged_file();
+	if (IsAnnotationFile(merged_file)){
+		std::cerr << "Can't overwrite the output file " << _annotation_file << " while annotating." << std::endl;
+		return;
+	}
+	_user_tasks.push_back(_task_executor.Post("merge " + merged_file,
+		[outputs, chunk_size, file_list, merged_file](TaskContext& ctx){
+			// 各チャンクの画像には、そのチャンクの完了を記録した作業者のアノテーションのみを使う
+			// （期限切れで割り当て直されたチャンクを、元の作業者の古い出力で上書きしないため）
+			std::map<std::string, std::vector<std::vector<cv::Rect>>> worker_rects;
+			for (int c = 0; c < outputs.size(); c++){
+				if (outputs[c].empty() || worker_rects.count(outputs[c]))
+					continue;
+				std::vector<std::string> files;
+				std::vector<std::vector<cv::Rect>> rects;
+				if (!util::LoadAnnotationFile(outputs[c], files, rects))
+					std::cerr << "Fail to read annotation file " << outputs[c] << "." << std::endl;
+				worker_rects[outputs[c]] = reorderAnnotation(files, rects, file_list);
+				if (!ctx.Progress(c + 1, outputs.size()))
+					return false;
+			}
+
+			std::vector<std::vector<cv::Rect>> rectlist(file_list.size());
+			for (int i = 0; i < rectlist.size(); i++){
+				int c = i / chunk_size;
+				if (c < outputs.size() && !outputs[c].empty())
+					rectlist[i] = worker_rects[outputs[c]][i];
+			}
+			return util::SaveAnnotationFile(merged_file, file_list, rectlist, " ", ctx.ProgressCallback());
+		},
+		[merged_file](bool success){
+			if (!success)
+				std::cerr << "Fail to merge annotation to file " << merged_file << "." << std::endl;
+		}));
+}
+
+
+void ObjectMarker::MatchAnnotationByContent(const std::vector<std::string>& loaded_img_list,
+	const std::vector<std::vector<cv::Rect>>& loaded_annotation)
+{
+	// 読み込んだアノテーションは大きいので複製せずに共有する
+	std::shared_ptr<std::vector<std::string>> loaded_files = std::make_shared<std::vector<std::string>>(loaded_img_list);
+	std::shared_ptr<std::vector<std::vector<cv::Rect>>> loaded_rects = std::make_shared<std::vector<std::vector<cv::Rect>>>(loaded_annotation);
+	std::shared_ptr<std::vector<std::vector<cv::Rect>>> matched = std::make_shared<std::vector<std::vector<cv::Rect>>>();
+	ImageList file_list = _file_list;
+	ContentIndex content_index = _content_index;
+	std::string anno_file = _annotation_file;
+	_task_executor.Post("content hash",
+		[content_index, file_list, loaded_files, loaded_rects, matched](TaskContext& ctx){
+			ContentIndex::HashTable hashes;
+			if (!content_index.Update(file_list, hashes, ctx.ProgressCallback()))
+				return false;
+			*matched = reorderAnnotation(*loaded_files, *loaded_rects, file_list, &hashes);
+			return true;
+		},
+		[this, file_list, anno_file, matched](bool success){
+			// 計算中に画像一覧や出力ファイルが変わっていれば使わない
+			if (!success || !_file_list.shares(file_list) || _annotation_file != anno_file)
+				return;
+
+			// パスでは対応付かず、まだマーカーのない画像のみに設定
+			std::vector<int> indices;
+			std::vector<std::vector<cv::Rect>> rectlist;
+			for (int i = 0; i < matched->size(); i++){
+				if (_rectlist[i].empty() && !(*matched)[i].empty()){
+					_rectlist[i] = (*matched)[i];
+					_marker_viewer.ClearHistory(i);
+					_server.SetAnnotation(i, _rectlist[i]);
+					_nav_index.Update(i, _rectlist[i]);
+					indices.push_back(i);
+					rectlist.push_back(_rectlist[i]);
+				}
+			}
+			if (indices.empty())
+				return;
+			std::cout << indices.size() << " images were matched to annotations by content." << std::endl;
+
+			// 新しいパスで記録し、次回からはパスで対応付ける
+			if (!util::AddAnnotationLines(_annotation_file, _file_list, indices, rectlist))
+				std::cerr << "Fail to write annotation to file " << _annotation_file << "." << std::endl;
+			if (!_marker_viewer.is_changed() && std::find(indices.begin(), indices.end(), _image_idx) != indices.end())
+				_marker_viewer.LoadMarkers(_rectlist[_image_idx], _image_idx);
+		});
+}
+
+
+void ObjectMarker::FindDuplicates()
+{
+	if (_file_list.is_video()){
+		std::cout << "Duplicate detection is not available for video frames." << std::endl;
+		return;
+	}
+	ImageList file_list = _file_list;
+	DuplicateFinder dedup = _dedup;
+	std::shared_ptr<std::vector<std::vector<int>>> groups = std::make_shared<std::vector<std::vector<int>>>();
+	_task_executor.Post("duplicates",
+		[dedup, file_list, groups](TaskContext& ctx){
+			return dedup.Find(file_list, *groups, ctx.ProgressCallback());
+		},
+		[this, file_list, groups](bool success){
+			// 検出中に画像一覧が変わっていれば使わない
+			if (!success || !_file_list.shares(file_list))
+				return;
+
+			_duplicate_of.assign(_file_list.size(), -1);
+			_duplicates.clear();
+			int num_duplicates = 0;
+			for (size_t g = 0; g < groups->size(); g++){
+				const std::vector<int>& group = (*groups)[g];
+				for (size_t k = 1; k < group.size(); k++){
+					_duplicate_of[group[k]] = group[0];
+					_duplicates[group[0]].push_back(group[k]);
+					num_duplicates++;
+				}
+			}
+			std::cout << num_duplicates << " near-duplicate images in " << groups->size() << " groups." << std::endl;
+
+			// マーカーをつけ済みの代表画像は、その場で重複画像へ複製
+			std::unordered_map<int, std::vector<int>>::const_iterator it;
+			for (it = _duplicates.begin(); it != _duplicates.end(); it++)
+				CopyToDuplicates(it->first);
+		});
+}
+
+
+void ObjectMarker::ResetDuplicates()
+{
+	_duplicate_of.clear();
+	_duplicates.clear();
+	if (_dedup.mode() != DuplicateFinder::DEDUP_NONE)
+		FindDuplicates();
+}
+
+
+void ObjectMarker::BuildNameIndex()
+{
+	_name_index.reset();
+	if (_file_list.is_video())
+		return;
+	ImageList file_list = _file_list;
+	std::shared_ptr<FileNameIndex> name_index = std::make_shared<FileNameIndex>();
+	_task_executor.Post("name index",
+		[file_list, name_index](TaskContext& ctx){
+			return name_index->Build(file_list, ctx.ProgressCallback());
+		},
+		[this, file_list, name_index](bool success){
+			// 作成中に画像一覧が変わっていれば使わない
+			if (success && _file_list.shares(file_list))
+				_name_index = name_index;
+		});
+}
+
+
+int ObjectMarker::skipDuplicates(int idx) const
+{
+	if (_dedup.mode() != DuplicateFinder::DEDUP_SKIP)
+		return idx;
+	while (idx >= 0 && idx < _duplicate_of.size() && _duplicate_of[idx] >= 0)
+		idx++;
+	return idx;
+}
+
+
+void ObjectMarker::CopyToDuplicates(int idx)
+{
+	if (_dedup.mode() != DuplicateFinder::DEDUP_COPY || _rectlist[idx].empty())
+		return;
+	std::unordered_map<int, std::vector<int>>::const_iterator it = _duplicates.find(idx);
+	if (it == _duplicates.end())
+		return;
+
+	// 既にマーカーのある重複画像はそのまま
+	std::vector<int> indices;
+	std::vector<std::vector<cv::Rect>> rectlist;
+	for (size_t k = 0; k < it->second.size(); k++){
+		int dup = it->second[k];
+		if (!_rectlist[dup].empty())
+			continue;
+		_rectlist[dup] = _rectlist[idx];
+		_marker_viewer.ClearHistory(dup);
+		_server.SetAnnotation(dup, _rectlist[dup]);
+		_nav_index.Update(dup, _rectlist[dup]);
+		indices.push_back(dup);
+		rectlist.push_back(_rectlist[dup]);
+	}
+	if (indices.empty())
+		return;
+	if (!util::AddAnnotationLines(_annotation_file, _file_list, indices, rectlist))
+		std::cerr << "Fail to write annotation to file " << _annotation_file << "." << std::endl;
+	if (!_marker_viewer.is_changed() && std::find(indices.begin(), indices.end(), _image_idx) != indices.end())
+		_marker_viewer.LoadMarkers(_rectlist[_image_idx], _image_idx);
+}
+
+
+//! アノテーションで画像を切り取って保存
+void ObjectMarker::CropAndSaveImages(const std::string& dir_name)
+{
+	ImageList file_list = _file_list;
+	std::vector<std::vector<cv::Rect>> rectlist = _rectlist;
+	_user_tasks.push_back(_task_executor.Post("crop " + dir_name,
+		[dir_name, file_list, rectlist](TaskContext& ctx){
+			return util::CropAnnotatedImageRegions(dir_name, file_list, rectlist, ctx.ProgressCallback());
+		}));
+}
+
+
+void ObjectMarker::ReloadFolder(const std::string& image_dir)
+{
+	std::shared_ptr<ImageList> file_list = std::make_shared<ImageList>();
+	DirectoryScanner scanner = _scanner;
+	_user_tasks.push_back(_task_executor.Post("folder " + image_dir,
+		[image_dir, file_list, scanner](TaskContext& ctx){
+			return ReadImageList(image_dir, scanner, *file_list, ctx.ProgressCallback());
+		},
+		[this, image_dir, file_list](bool success){
+			if (!success){
+				std::cout << "no appropriate input files in " << image_dir << std::endl;
+				return;
+			}
+			// 走査中に編集していたマーカーを旧フォルダ側で確定させてから切り替え
+			SaveCurrentMarkers();
+			_file_list = *file_list;
+			_image_idx = 0;
+			_pre_annotator.SetFileList(_file_list);
+			_work_queue.SetImageCount(_file_list.size());
+			ResetDuplicates();
+			BuildNameIndex();
+			if (_thumbnails.is_prefetch())
+				GenerateThumbnails();
+			SetInputSource(image_dir);
+			LoadAnnotationFile(_annotation_file);
+			this->begin();
+		}));
 }
 
 
 int ObjectMarker::run(const std::string& conf_file)
 {
-	///////// p[^ ///////////
-	std::string annotation_file;	// o̓eLXgt@C
-	std::string input_dir = "rawdata";	// ̓tH_
+	///////// パラメータ ///////////
+	std::string annotation_file;	// 出力テキストファイル名
+	std::string input_dir = "rawdata";	// 入力フォルダ
 	///////////////////////////////////
 
-	bool ret = loadConfiguration(conf_file, input_dir, annotation_file, _marker_viewer);
-
+	bool ret = loadConfiguration(conf_file, input_dir, annotation_file);
 	if (annotation_file.empty())
 		annotation_file = "annotation.txt";
 
-	Load(input_dir, annotation_file);
+	if (_replay_report.empty()){
+		_pre_annotator.Start();
+		_server.Start();
+	}
+	else{
+		// 再生は出力ファイルの一時的な複製に書き込み、共有のリースや先読みの結果にも左右されないようにする
+		_work_queue.Disable();
+		_thumbnails.SetPrefetch(false);
+		annotation_file = CreateReplayCopy(annotation_file);
+	}
+
+	// 画像リストファイルの指定があれば、フォルダより優先する
+	Load(_input_list.empty() ? input_dir : _input_list, annotation_file);
 
 	printHelp();
 	printStatus();
 
 	enum KeyBindings {
-		Key_Enter = 13, Key_ESC = 27, Key_Space = 32, Key_BS = 8
+		Key_Enter = 13, Key_ESC = 27, Key_Space = 32, Key_BS = 8, Key_CtrlY = 25, Key_CtrlZ = 26
 	};
 
 	bool loop = this->begin();
 	while(loop){
 		// Get user input
-		int iKey = _marker_viewer.GetWindowKey();
+		int iKey = WaitKey();
 
 		// Press ESC to close this program, any unsaved changes will be discarded
 		if (iKey == Key_ESC){
@@ -357,6 +1126,12 @@ int ObjectMarker::run(const std::string& conf_file)
 			std::string dir_name = util::AskQuestionGetString("Folder name to save images: ");
 			CropAndSaveImages(dir_name);
 		}
+		else if (iKey == 'x'){
+			// 読み込み時に自動で始まる処理（索引や縮小画像の作成等）は中断しない
+			for (size_t i = 0; i < _user_tasks.size(); i++)
+				_task_executor.Cancel(_user_tasks[i]);
+			_user_tasks.clear();
+		}
 		else if (iKey == 'm'){
 			_marker_viewer.SwitchFixAR();
 			printStatus();
@@ -383,7 +1158,16 @@ int ObjectMarker::run(const std::string& conf_file)
 			}
 		}
 		else if (iKey == 'p'){
-			std::cout << "_`̋F " << (_marker_viewer.SwitchAcceptPointShape() ? "YES" : "NO") << std::endl;
+			std::cout << "点形状の許可： " << (_marker_viewer.SwitchAcceptPointShape() ? "YES" : "NO") << std::endl;
+		}
+		else if (iKey == 'M'){
+			// 前回の表示以降の確保回数を表示
+			MatPool::Instance().PrintStatus();
+			MatPool::Instance().ResetCounters();
+		}
+		else if (iKey == 'L'){
+			// 起動してからの所要時間を表示（終了時にはファイルへ出力）
+			LatencyProfiler::Instance().Print(std::cout);
 		}
 		else if (iKey == 't'){
 			printHelp();
@@ -395,9 +1179,55 @@ int ObjectMarker::run(const std::string& conf_file)
 				std::cerr << "Fail to jump #" << target_id << std::endl;
 			}
 		}
+		else if (iKey == '/'){
+			std::string pattern = util::AskQuestionGetString("Search file name (^ for prefix): ");
+			bool prefix = (pattern.size() > 1 && pattern[0] == '^');
+			if (prefix)
+				pattern.erase(0, 1);
+			searchFileName(pattern, prefix);
+		}
+		else if (iKey == 'v'){
+			this->ReviewContactSheet();
+		}
+		else if (iKey == 'V'){
+			std::string repaired_file = util::AskQuestionGetString("Repaired file name (0: none): ");
+			if (repaired_file == "0")
+				repaired_file.clear();
+			this->ValidateAnnotation(repaired_file);
+		}
 		else if (iKey == 'r'){
 			this->CopyFormerMarkers();
 		}
+		else if (iKey == 'R'){
+			this->TrackFormerMarkers();
+		}
+		else if (iKey == 'y'){
+			if (!_marker_viewer.AcceptSuggestions())
+				std::cout << "No suggested markers" << std::endl;
+		}
+		else if (iKey == 'u' || iKey == Key_CtrlZ){
+			if (!_marker_viewer.Undo())
+				std::cout << "Nothing to undo" << std::endl;
+		}
+		else if (iKey == 'U' || iKey == Key_CtrlY){
+			if (!_marker_viewer.Redo())
+				std::cout << "Nothing to redo" << std::endl;
+		}
+		else if (iKey == 'b'){
+			if (!_marker_viewer.SnapMarker())
+				std::cout << "No marker to snap" << std::endl;
+		}
+		else if (iKey == 'i'){
+			int begin_id = util::AskQuestionGetInt("Interpolate from image#: ");
+			int end_id = util::AskQuestionGetInt("Interpolate to image#: ");
+			int method = util::AskQuestionGetInt("Choose method (0:LINEAR, 1:SPLINE): ");
+			if (begin_id < end_id && (method == 0 || method == 1)){
+				this->InterpolateMarkers(begin_id - 1, end_id - 1, method == 1);
+			}
+			else{
+				std::cout << "Wrong Input" << std::endl;
+			}
+		}
 		else if (iKey == 'g'){
 			std::cout << "GUIDE: " << (_marker_viewer.SwitchShowGuide() ? "ON" : "OFF") << std::endl;
 		}
@@ -422,26 +1252,119 @@ int ObjectMarker::run(const std::string& conf_file)
 		// change work folder (= reboot)
 		else if (iKey == 'f'){
 			input_dir = util::AskQuestionGetString("New Image Directory Name: ");
-			Load(input_dir, _annotation_file);
-			this->begin();
+			ReloadFolder(input_dir);
 		}
 		else if (iKey == 'o'){
 			std::string outputname = util::AskQuestionGetString("New Output File Name: ");
+			if (!_replay_report.empty())
+				outputname = CreateReplayCopy(outputname);
 			LoadAnnotationFile(outputname);
 			this->reload();
 		}
+		else if (iKey == 'Q'){
+			MergeWorkQueueOutputs();
+		}
+		else if (iKey == 'n'){
+			if (!jumpToMatch())
+				std::cout << "No image matches the filter." << std::endl;
+		}
+		else if (iKey == 'N'){
+			int filter = util::AskQuestionGetInt("Choose filter (0:NO MARKER, 1:MARKER COUNT, 2:SMALL MARKER): ");
+			bool valid = true;
+			if (filter == NavigationIndex::FILTER_UNANNOTATED){
+				SetNavigationFilter(filter, 0, 0);
+				std::cout << _nav_index.num_unannotated() << " images have no marker." << std::endl;
+			}
+			else if (filter == NavigationIndex::FILTER_COUNT){
+				int min_count = util::AskQuestionGetInt("Minimum number of markers: ");
+				int max_count = util::AskQuestionGetInt("Maximum number of markers: ");
+				SetNavigationFilter(filter, min_count, max_count);
+			}
+			else if (filter == NavigationIndex::FILTER_SMALL){
+				int size = util::AskQuestionGetInt("Marker size smaller than (px): ");
+				SetNavigationFilter(filter, size, 0);
+			}
+			else{
+				std::cout << "Wrong Input" << std::endl;
+				valid = false;
+			}
+			if (valid && !jumpToMatch())
+				std::cout << "No image matches the filter." << std::endl;
+		}
+		else if (iKey == 'D'){
+			FindDuplicates();
+		}
 		else if (iKey == 'O'){
 			std::string save_file = util::AskQuestionGetString("Export Annotation File Name: ");
-			if (!ExportAnnotationFile(save_file))
-				std::cerr << "Fail to export annotation to file " << save_file << "." << std::endl;
+			ExportAnnotationFile(save_file);
 		}
 		else{
 			std::cout << "Unrecognised command" << std::endl;
 		}
 	};
 
-	saveConfiguration(conf_file, _input_dir, _annotation_file, _marker_viewer);
+	if (_replay_report.empty()){
+		saveConfiguration(conf_file, _input_dir, _annotation_file);
+	}
+	else{
+		std::ofstream ofs(_replay_report.c_str());
+		if (ofs.is_open())
+			_replayer.WriteReport(ofs, _file_list, _rectlist);
+		else
+			std::cerr << "Fail to write replay report " << _replay_report << "." << std::endl;
+
+		// 再生中の出力は結果の出力ファイルにまとめたので、複製は削除
+		for (size_t i = 0; i < _replay_copies.size(); i++){
+			boost::system::error_code ec;
+			boost::filesystem::remove(_replay_copies[i], ec);
+		}
+		_replay_copies.clear();
+	}
+	_recorder.Close();
+	if (_replay_report.empty())
+		LatencyProfiler::Instance().Dump();
 
 	return 0;
 }
 
+
+bool ObjectMarker::RecordSession(const std::string& log_file)
+{
+	if (!_recorder.Open(log_file, &HighGuiBackend::Instance()))
+		return false;
+	_marker_viewer.SetBackend(&_recorder);
+	_contact_sheet.SetBackend(&_recorder);
+	return true;
+}
+
+
+std::string ObjectMarker::CreateReplayCopy(const std::string& anno_file)
+{
+	namespace fs = boost::filesystem;
+	boost::system::error_code ec;
+	fs::path copy_dir = fs::temp_directory_path(ec);
+	if (ec)
+		copy_dir = fs::path(_replay_report).parent_path();
+	fs::path copy_file = copy_dir / fs::unique_path("om_replay_%%%%-%%%%-%%%%.txt");
+
+	// 複製できなくても元のファイルには書き込まず、空の出力ファイルから再生する
+	ec.clear();
+	if (fs::exists(anno_file))
+		fs::copy_file(anno_file, copy_file, ec);
+	if (ec)
+		std::cerr << "Fail to copy annotation file " << anno_file << " for replay." << std::endl;
+	_replay_copies.push_back(copy_file.string());
+	return copy_file.string();
+}
+
+
+bool ObjectMarker::ReplaySession(const std::string& log_file, const std::string& report_file)
+{
+	if (!_replayer.Load(log_file))
+		return false;
+	_replay_report = report_file;
+	_marker_viewer.SetBackend(&_replayer);
+	_contact_sheet.SetBackend(&_replayer);
+	return true;
+}
+
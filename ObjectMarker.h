@@ -34,7 +34,25 @@
 #define __OBJECT_MARKER__
 
 #include <opencv2/core/core.hpp>
+#include <unordered_map>
 #include "MarkerViewer.h"
+#include "ImageLoader.h"
+#include "TaskExecutor.h"
+#include "DirectoryScanner.h"
+#include "ImageList.h"
+#include "MarkerTracker.h"
+#include "PreAnnotator.h"
+#include "WorkQueue.h"
+#include "AnnotationServer.h"
+#include "SessionLog.h"
+#include "ContentIndex.h"
+#include "DuplicateFinder.h"
+#include "NavigationIndex.h"
+#include "FileNameIndex.h"
+#include "ThumbnailCache.h"
+#include "ContactSheet.h"
+#include "ImageProbe.h"
+#include "AnnotationValidator.h"
 
 
 class ObjectMarker
@@ -43,82 +61,274 @@ public:
 	ObjectMarker();
 	~ObjectMarker();
 
-	//! vON
+	//! プログラム起動
 	int run(const std::string& conf_file);
 
-	bool begin(){ return jump(0); };
-	bool next(){ return jump(_image_idx + 1); };
+	//! 操作の記録を開始（runの前に呼ぶ）
+	/*!
+	キー入力、マウス操作、コンソールでの回答を時刻付きで記録する
+	\param[in] log_file 記録ファイル名
+	\return 記録ファイルを開けたかどうか
+	*/
+	bool RecordSession(const std::string& log_file);
+
+	//! 記録した操作をウィンドウを開かずに再生（runの前に呼ぶ）
+	/*!
+	HTTPサービス、事前アノテーション、作業キュー、縮小画像の先読みは使わず、設定ファイルも保存しない。
+	マーカーは出力ファイルの一時的な複製に書き込む。終了時に各入力の処理時間と最終的なマーカーをreport_fileへ出力する
+	\param[in] log_file 記録ファイル名
+	\param[in] report_file 再生結果の出力ファイル名
+	\return 記録ファイルの読み込みの成否
+	*/
+	bool ReplaySession(const std::string& log_file, const std::string& report_file);
+
+	//! ウィンドウを開かずに出力ファイルを検査
+	/*!
+	問題の一覧を設定ファイルの<lint_report_file>へ出力し、種類ごとの件数をコンソールに表示する
+	\param[in] conf_file 設定ファイル名
+	\param[in] repaired_file 修正したファイルの出力先（空の場合は出力しない）
+	\return 終了コード（問題がなければ0、問題があれば1、検査できなければ2）
+	*/
+	int lint(const std::string& conf_file, const std::string& repaired_file);
+
+	bool begin();
+	bool next();
 	bool prev(){ return jump(_image_idx - 1); };
 	bool reload(){ return jump(_image_idx); };
 	bool jump(int idx);
 
-	//! wv\
+	//! 絞り込み条件に合う次の画像へ移動
+	/*!
+	間の画像は読み込まずに索引から探す
+	\return 条件に合う画像があったかどうか
+	*/
+	bool jumpToMatch();
+
+	//! 次の画像を探す絞り込み条件を設定
+	/*!
+	\param[in] filter NavigationIndexの絞り込み条件
+	\param[in] min_val マーカー数の下限、またはマーカーの大きさのしきい値
+	\param[in] max_val マーカー数の上限
+	*/
+	void SetNavigationFilter(int filter, int min_val, int max_val);
+
+	//! ファイル名で検索し、現在の画像より後で最初に一致した画像へ移動
+	/*!
+	最後の画像まで見つからなければ先頭から探す
+	\param[in] pattern 検索する文字列（大文字と小文字は区別しない）
+	\param[in] prefix trueの場合は前方一致、falseの場合は部分一致
+	\return 一致する画像があったかどうか
+	*/
+	bool searchFileName(const std::string& pattern, bool prefix);
+
+	//! 出力ファイルをバックグラウンドで検査
+	/*!
+	\param[in] repaired_file 修正したファイルの出力先（空の場合は出力しない）
+	*/
+	void ValidateAnnotation(const std::string& repaired_file);
+
+	//! 縮小画像を一覧表示し、クリックした画像へ移動
+	/*!
+	初回は画像一覧全体の縮小画像の作成をバックグラウンドで開始する
+	*/
+	void ReviewContactSheet();
+
+	//! ヘルプを表示
 	static void printHelp();
 
-	//! Xe[^X\
+	//! ステータス表示
 	void printStatus() const;
 
-	//! ݒt@C̕ۑ
+	//! アノテーションの並び替え
 	/*!
-	\param[in] config_name ݒt@C
-	\param[in] input_dir 摜i[tH_
-	\param[in] outputname o̓eLXgt@C
-	\param[in] display_scale 摜̕\XP[
-	\return t@C݂̐
+	ロードされたアノテーションに対応する画像ファイル名が、参照画像ファイル名と対応するように並び替え
+	\param[in] loaded_img_list 入力画像リスト
+	\param[in] loaded_annotation 読み込まれたアノテーション
+	\param[in] ref_img_list 参照アノテーション
+	\param[in] hashes 画像ファイルの内容のハッシュ。指定した場合、パスの一致しない画像は内容の一致するアノテーションに対応付ける
+	\return 整理されたアノテーション
 	*/
-	static bool saveConfiguration(const std::string& config_name,
-		const std::string& input_dir, const std::string& outputname,
-		const MarkerViewer& marker_viewer
-		);
+	static std::vector<std::vector<cv::Rect>> reorderAnnotation(const std::vector<std::string>& loaded_img_list,
+		const std::vector<std::vector<cv::Rect>>& loaded_annotation,
+		const ImageList& ref_img_list, const ContentIndex::HashTable* hashes = 0);
+
+	//! 設定ファイルの保存
+	/*!
+	画像の表示や読み込み等の各パラメータもあわせて保存する
+	\param[in] config_name 設定ファイル名
+	\param[in] input_dir 画像格納フォルダ名
+	\param[in] outputname 出力テキストファイル名
+	\return ファイル書き込みの成否
+	*/
+	bool saveConfiguration(const std::string& config_name,
+		const std::string& input_dir, const std::string& outputname
+		) const;
 
 
-	//! ݒt@C̓ǂݍ
+	//! 設定ファイルの読み込み
 	/*!
-	\param[in] config_name ݒt@C
-	\param[out] input_dir 摜i[tH_
-	\param[out] outputname o̓eLXgt@C
-	\param[out] display_scale 摜̕\XP[
-	\return t@Cǂݍ݂̐
+	画像の表示や読み込み等の各パラメータもあわせて読み込む
+	\param[in] config_name 設定ファイル名
+	\param[out] input_dir 画像格納フォルダ名
+	\param[out] outputname 出力テキストファイル名
+	\return ファイル読み込みの成否
 	*/
-	static bool loadConfiguration(const std::string& config_name,
-		std::string& input_dir, std::string& outputname,
-		MarkerViewer& marker_viewer
+	bool loadConfiguration(const std::string& config_name,
+		std::string& input_dir, std::string& outputname
 		);
 
 	bool Load(const std::string& image_dir, const std::string& anno_file);
 	bool LoadAnnotationFile(const std::string& anno_file);
 
-	//! Õt[̃}[J[t[ɃRs[
+	//! 画像フォルダの読み直し（バックグラウンド処理）
+	/*!
+	フォルダの走査が完了した時点で新しいフォルダの先頭画像へ移動する
+	*/
+	void ReloadFolder(const std::string& image_dir);
+
+	//! 前のフレームのマーカーを現フレームにコピー
 	void CopyFormerMarkers();
 
-	//! Ame[Vŉ摜؂ĕۑ
+	//! 前のフレームのマーカーを現フレームへ追跡して設定
+	/*!
+	直前に前のフレームを表示していなかった場合はそのままコピーする
+	*/
+	void TrackFormerMarkers();
+
+	//! 指定範囲のマーカーのない画像をキーフレーム間で補間
+	/*!
+	補間した結果は出力ファイルへ追記する
+	\param[in] begin 範囲の先頭の画像ID
+	\param[in] end 範囲の末尾の画像ID
+	\param[in] spline trueの場合はスプライン補間、falseの場合は線形補間
+	*/
+	void InterpolateMarkers(int begin, int end, bool spline);
+
+	//! パスの一致しなかった画像を内容でアノテーションに対応付け（バックグラウンド処理）
+	/*!
+	画像ファイルのハッシュの計算後、マーカーのない画像に内容の一致するアノテーションを設定して出力ファイルへ追記する
+	\param[in] loaded_img_list アノテーションファイルに記録された画像パス
+	\param[in] loaded_annotation 読み込まれたアノテーション
+	*/
+	void MatchAnnotationByContent(const std::vector<std::string>& loaded_img_list,
+		const std::vector<std::vector<cv::Rect>>& loaded_annotation);
+
+	//! ほぼ同じ画像のグループを検出（バックグラウンド処理）
+	/*!
+	検出後は設定に応じて、次の画像へ進む際に重複画像を飛ばすか、代表画像のマーカーを重複画像へ複製する
+	*/
+	void FindDuplicates();
+
+	//! 作業キューの全作業者の出力を統合（バックグラウンド処理）
+	void MergeWorkQueueOutputs();
+
+	//! アノテーションで画像を切り取って保存（バックグラウンド処理）
 	void CropAndSaveImages(const std::string& dir_name);
 
-	//! Ame[Vt@C𐮌`ďo
-	bool ExportAnnotationFile(const std::string& filename);
+	//! アノテーションファイルを整形して出力（バックグラウンド処理）
+	void ExportAnnotationFile(const std::string& filename);
 
 private:
-	std::string _input_dir;	// ̓tH_
-	std::string _annotation_file;	// o̓t@C
+	std::string _input_dir;	// 入力フォルダ
+	std::string _input_list;	// 入力画像リストファイル（フォルダより優先）
+	std::string _annotation_file;	// 出力ファイル
+
+	ImageList _file_list;	// 画像ファイルへのパス
+	std::vector<std::vector<cv::Rect>>	_rectlist;	// 各画像のアノテーション
+	SessionRecorder _recorder;	// 操作の記録クラス（_marker_viewerより先に破棄しない）
+	SessionReplayer _replayer;	// 操作の再生クラス（同上）
+	std::string _replay_report;	// 再生結果の出力ファイル（再生しない場合は空）
+	std::vector<std::string> _replay_copies;	// 再生中に書き込む出力ファイルの一時的な複製
+	MarkerViewer _marker_viewer;	// Viewerクラス
+	ImageLoader _image_loader;	// 画像読み込みクラス
+	DirectoryScanner _scanner;	// 画像フォルダ走査クラス
+	ContentIndex _content_index;	// 画像の内容による対応付けクラス
+	DuplicateFinder _dedup;	// 重複画像の検出クラス
+	ThumbnailCache _thumbnails;	// 縮小画像のキャッシュ
+	ImageProbe _probe;	// 画像サイズの取得クラス
+	AnnotationValidator _validator;	// 出力ファイルの検査クラス
+	ContactSheet _contact_sheet;	// 縮小画像の一覧表示クラス
+	MarkerTracker _tracker;	// マーカー追跡クラス
+	PreAnnotator _pre_annotator;	// 事前アノテーションクラス
+	WorkQueue _work_queue;	// 複数作業者での分担クラス
+	AnnotationServer _server;	// HTTPでのアノテーション公開クラス
+	TaskExecutor _task_executor;	// バックグラウンド処理の実行クラス
+	std::vector<int> _user_tasks;	// "x"キーで中断できる処理（c, f, O, Q）のID
+
+	int _image_idx;		// 現在参照している画像ID
+	bool _waiting_proposal;	// 現在の画像のマーカー候補の検出待ち
+	NavigationIndex _nav_index;	// マーカーの数や大きさによる画像の索引
+	int _nav_filter;	// 次の画像を探す絞り込み条件
+	int _nav_min, _nav_max;	// 絞り込み条件のパラメータ
+	std::vector<int> _duplicate_of;	// 各画像が重複する代表画像のID（重複でなければ-1、未検出なら空）
+	std::unordered_map<int, std::vector<int>> _duplicates;	// 代表画像IDから重複画像IDへの対応
+	ImageList _thumbnail_list;	// 縮小画像の作成を開始した画像一覧
+	std::shared_ptr<const FileNameIndex> _name_index;	// ファイル名の検索索引（作成中は空）
+
+	//! キー入力待ち
+	/*!
+	待ちの間にバックグラウンドでデコードされた原寸画像が届けば表示を差し替え、
+	現在の画像のマーカー候補が届けばマーカーとして設定し、HTTPで届いた更新を反映し、
+	バックグラウンド処理の進捗や完了を処理する
+	\return 入力されたキー
+	*/
+	int WaitKey();
+
+	//! 現在の画像のマーカーに変更があればアノテーションファイルへ書き込み
+	void SaveCurrentMarkers();
+
+	//! HTTPで届いたアノテーションの更新を反映してアノテーションファイルへ書き込み
+	void ApplyServerUpdates();
+
+	//! 作業キューから次のチャンクを取得し、その中の未アノテーションの画像へ移動
+	bool nextChunk();
+
+	//! 重複画像を飛ばす設定であれば、idx以降で最初の重複でない画像IDを返す
+	int skipDuplicates(int idx) const;
+
+	//! 代表画像のマーカーを、まだマーカーのない重複画像へ複製して出力ファイルへ追記
+	void CopyToDuplicates(int idx);
+
+	//! 画像一覧の変更に伴い重複画像の検出結果を破棄し、設定されていれば検出し直す
+	void ResetDuplicates();
 
-	std::vector<std::string> _file_list;	// 摜t@Cւ̃pX
-	std::vector<std::vector<cv::Rect>>	_rectlist;	// e摜̃Ame[V
-	MarkerViewer _marker_viewer;	// ViewerNX
+	//! 画像一覧の変更に伴いファイル名の索引をバックグラウンドで作り直す
+	void BuildNameIndex();
 
-	int _image_idx;		// ݎQƂĂ摜ID
+	//! 画像一覧全体の縮小画像をバックグラウンドで作成
+	void GenerateThumbnails();
 
+	//! 出力ファイルの検査結果をファイルとコンソールへ出力
+	void ReportValidation(const std::string& anno_file, const std::vector<AnnotationIssue>& issues) const;
 
-	//! Ame[V̕ёւ
+	//! 出力ファイルと同じファイルを指すかどうか
+	bool IsAnnotationFile(const std::string& filename) const;
+
+	//! 比較用にパスの区切り文字を統一
+	static const std::string& NormalizePath(std::string& path);
+	static std::string NormalizePath(const std::string& path);
+
+	//! 画像一覧の取得
 	/*!
-	[hꂽAme[VɑΉ摜t@CAQƉ摜t@CƑΉ悤ɕёւ
-	\param[in] loaded_img_list ͉摜Xg
-	\param[in] loaded_annotation ǂݍ܂ꂽAme[V
-	\param[in] ref_img_list QƃAme[V
-	\return ꂽAme[V
+	\param[in] source 画像フォルダ、または画像リストファイル
+	\param[in] scanner フォルダ走査クラス
+	\param[out] file_list 画像ファイルへのパス
+	\param[in] progress 進捗通知関数
+	\return 1枚以上の画像が得られたかどうか
 	*/
-	static std::vector<std::vector<cv::Rect>> reorderAnnotation(const std::vector<std::string>& loaded_img_list,
-		const std::vector<std::vector<cv::Rect>>& loaded_annotation,
-		const std::vector<std::string>& ref_img_list);
+	static bool ReadImageList(const std::string& source, const DirectoryScanner& scanner,
+		ImageList& file_list, const util::ProgressCallback& progress = util::ProgressCallback());
+
+	//! 再生用に出力ファイルを一時フォルダへ複製
+	/*!
+	複製は再生の終了時に削除する
+	\param[in] anno_file 出力ファイル名
+	\return 複製のファイル名（複製できなかった場合は空のファイルとなる）
+	*/
+	std::string CreateReplayCopy(const std::string& anno_file);
+
+	//! 読み込んだ画像フォルダ、または画像リストファイル名を記録
+	void SetInputSource(const std::string& source);
 
 
 };
@@ -0,0 +1,253 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "PreAnnotator.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+#include <algorithm>
+#include <iostream>
+
+
+PreAnnotator::PreAnnotator()
+{
+	_generation = 0;
+	_quit = false;
+
+	_lookahead = 8;
+	_num_threads = 2;
+	_scale_factor = 1.1;
+	_min_neighbors = 3;
+	_min_size = 24;
+}
+
+
+PreAnnotator::~PreAnnotator()
+{
+	Stop();
+}
+
+
+bool PreAnnotator::Start()
+{
+	Stop();
+	if (_cascade_file.empty())
+		return false;
+
+	// 読み込めるかどうかを先に確認
+	cv::CascadeClassifier cascade;
+	if (!cascade.load(_cascade_file)){
+		std::cerr << "Fail to load cascade " << _cascade_file << "." << std::endl;
+		return false;
+	}
+
+	_quit = false;
+	int num_threads = std::max(1, _num_threads);
+	for (int i = 0; i < num_threads; i++)
+		_workers.push_back(std::thread(&PreAnnotator::WorkerLoop, this));
+	return true;
+}
+
+
+void PreAnnotator::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+		_queue.clear();
+	}
+	_cond.notify_all();
+	for (int i = 0; i < _workers.size(); i++)
+		_workers[i].join();
+	_workers.clear();
+}
+
+
+void PreAnnotator::SetFileList(const ImageList& file_list)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_file_list = file_list;
+	_generation++;
+	_queue.clear();
+	_running.clear();
+	_proposals.clear();
+}
+
+
+void PreAnnotator::Request(int image_idx)
+{
+	if (!is_enabled())
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	int end = std::min(image_idx + _lookahead, (int)_file_list.size() - 1);
+
+	// 遠ざかった画像の候補を破棄
+	std::map<int, std::vector<cv::Rect>>::iterator it = _proposals.begin();
+	while (it != _proposals.end()){
+		if (it->first < image_idx - _lookahead || it->first > end)
+			it = _proposals.erase(it);
+		else
+			++it;
+	}
+
+	// 現在の画像に近い順に検出待ちへ並べる
+	_queue.clear();
+	for (int i = image_idx; i <= end; i++){
+		if (_proposals.find(i) == _proposals.end() && _running.find(i) == _running.end())
+			_queue.push_back(i);
+	}
+	_cond.notify_all();
+}
+
+
+bool PreAnnotator::is_pending(int image_idx) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _running.find(image_idx) != _running.end() ||
+		std::find(_queue.begin(), _queue.end(), image_idx) != _queue.end();
+}
+
+
+bool PreAnnotator::Fetch(int image_idx, std::vector<cv::Rect>& rects) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::map<int, std::vector<cv::Rect>>::const_iterator it = _proposals.find(image_idx);
+	if (it == _proposals.end())
+		return false;
+	rects = it->second;
+	return true;
+}
+
+
+cv::Mat PreAnnotator::LoadGray(const std::string& filename, VideoSource& video)
+{
+	std::string video_file;
+	int frame;
+	if (!ImageList::ParseVideoFrame(filename, video_file, frame))
+		return cv::imread(filename, cv::IMREAD_GRAYSCALE);
+
+	cv::Mat img, gray;
+	if (video.path() != video_file && !video.Open(video_file))
+		return cv::Mat();
+	if (!video.Read(frame, img))
+		return cv::Mat();
+	cv::cvtColor(img, gray, CV_BGR2GRAY);
+	return gray;
+}
+
+
+void PreAnnotator::WorkerLoop()
+{
+	// CascadeClassifierはスレッド間で共有できないため、スレッドごとに読み込む
+	cv::CascadeClassifier cascade;
+	if (!cascade.load(_cascade_file))
+		return;
+	VideoSource video;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true){
+		_cond.wait(lock, [this]{ return _quit || !_queue.empty(); });
+		if (_quit)
+			break;
+
+		int idx = _queue.front();
+		_queue.pop_front();
+		_running.insert(idx);
+		int generation = _generation;
+		std::string filename = _file_list[idx];
+		lock.unlock();
+
+		std::vector<cv::Rect> rects;
+		cv::Mat gray = LoadGray(filename, video);
+		if (!gray.empty()){
+			cv::equalizeHist(gray, gray);
+			cascade.detectMultiScale(gray, rects, _scale_factor, _min_neighbors, 0, cv::Size(_min_size, _min_size));
+		}
+
+		lock.lock();
+		// 検出中に画像リストが切り替わっていれば結果は破棄
+		if (generation == _generation){
+			_running.erase(idx);
+			_proposals[idx] = rects;
+		}
+	}
+}
+
+
+//! パラメータ読み込み
+void PreAnnotator::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	fn["cascade"] >> _cascade_file;
+	if (!fn["lookahead"].empty())
+		fn["lookahead"] >> _lookahead;
+	if (!fn["detect_threads"].empty())
+		fn["detect_threads"] >> _num_threads;
+	if (!fn["scale_factor"].empty())
+		fn["scale_factor"] >> _scale_factor;
+	if (!fn["min_neighbors"].empty())
+		fn["min_neighbors"] >> _min_neighbors;
+	if (!fn["min_size"].empty())
+		fn["min_size"] >> _min_size;
+	_lookahead = std::max(1, _lookahead);
+	if (_scale_factor <= 1.0)
+		_scale_factor = 1.1;
+}
+
+
+//! パラメータ書き込み
+void PreAnnotator::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "cascade" << _cascade_file;
+	fs << "lookahead" << _lookahead;
+	fs << "detect_threads" << _num_threads;
+	fs << "scale_factor" << _scale_factor;
+	fs << "min_neighbors" << _min_neighbors;
+	fs << "min_size" << _min_size;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void PreAnnotator::PrintStatus() const{
+	if (is_enabled())
+		std::cout << "事前アノテーション： " << _cascade_file << " (" << _lookahead << "枚先まで)" << std::endl;
+	else
+		std::cout << "事前アノテーション： OFF" << std::endl;
+}
@@ -0,0 +1,131 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __PRE_ANNOTATOR__
+#define __PRE_ANNOTATOR__
+
+#include <opencv2/core/core.hpp>
+#include "ImageList.h"
+#include "VideoSource.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <set>
+#include <map>
+#include <vector>
+
+//! 検出器による事前アノテーション
+/*!
+現在の画像から先のlookahead枚の画像に対して、ワーカースレッドでカスケード検出器を実行し、
+検出結果をマーカーの候補として画像ごとに保持する。検出器はスレッドごとに読み込む
+*/
+class PreAnnotator
+{
+public:
+	PreAnnotator();
+	~PreAnnotator();
+
+	//! ワーカースレッドの開始
+	/*!
+	\return 開始の成否（検出器が指定されていない、または読み込めない場合はfalse）
+	*/
+	bool Start();
+
+	//! ワーカースレッドの停止
+	void Stop();
+
+	//! 事前アノテーションが有効かどうか
+	bool is_enabled() const{
+		return !_workers.empty();
+	}
+
+	//! 対象の画像リストを設定（保持している候補は破棄）
+	void SetFileList(const ImageList& file_list);
+
+	//! 指定した画像から先の画像の検出を要求
+	/*!
+	要求範囲外の画像の検出待ちは取り消す
+	\param[in] image_idx 現在の画像ID
+	*/
+	void Request(int image_idx);
+
+	//! 指定した画像の検出待ちかどうか
+	bool is_pending(int image_idx) const;
+
+	//! 指定した画像のマーカー候補を取得
+	/*!
+	\param[in] image_idx 画像ID
+	\param[out] rects マーカー候補（原画像の座標）
+	\return 検出済みかどうか
+	*/
+	bool Fetch(int image_idx, std::vector<cv::Rect>& rects) const;
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	std::vector<std::thread> _workers;	//!< 検出用スレッド
+	mutable std::mutex _mutex;
+	std::condition_variable _cond;
+
+	ImageList _file_list;	//!< 対象の画像リスト
+	int _generation;	//!< 画像リストの世代（切り替え前の検出結果を破棄するため）
+	std::deque<int> _queue;	//!< 検出待ちの画像ID
+	std::set<int> _running;	//!< 検出中の画像ID
+	std::map<int, std::vector<cv::Rect>> _proposals;	//!< 検出済みのマーカー候補
+	bool _quit;	//!< スレッド終了フラグ
+
+	/////// パラメータ /////////////
+	std::string _cascade_file;	//!< カスケード検出器のファイル名（空の場合は無効）
+	int _lookahead;	//!< 先読みする画像数
+	int _num_threads;	//!< 検出用スレッド数
+	double _scale_factor;	//!< 検出窓の拡大率
+	int _min_neighbors;	//!< 検出の統合に必要な近傍数
+	int _min_size;	//!< 検出する最小サイズ（原画像の画素数）
+	///////////////////////////////////
+
+	//! 検出用スレッドのループ
+	void WorkerLoop();
+
+	//! 画像を読み込んでグレースケールで返す
+	static cv::Mat LoadGray(const std::string& filename, VideoSource& video);
+};
+
+#endif
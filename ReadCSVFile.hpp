@@ -54,7 +54,7 @@ namespace util{
 	};
 
 
-	// input_stringseparaterŕ
+	// input_stringをseparaterで分離
 	template <typename T>
 	std::vector<T> TokenizeString(const std::string& input_string, const std::vector<std::string>& separater_vec)
 	{
@@ -91,7 +91,7 @@ namespace util{
 	}
 
 
-	// CSVt@CXgOXg擾
+	// CSVファイルからストリングリストを取得
 	template <typename T>
 	bool ReadCSVFile(const std::string& input_file, std::vector<std::vector<T>>& output_strings,
 		const std::vector<std::string>& separater_vec = std::vector<std::string>())
@@ -118,7 +118,7 @@ namespace util{
 	}
 
 
-	//! CSVt@Cstd::vectorƂēǂݍ
+	//! CSVファイルをstd::vectorとして読み込み
 	template<typename T> void ReadList(const std::string& filename, std::vector<T>& dst_vector)
 	{
 		std::ifstream ifs(filename);
@@ -0,0 +1,314 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "SessionLog.h"
+#include "util_functions.h"
+#include <opencv2/highgui/highgui.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace{
+	const char* SESSION_HEADER = "#OMSESSION 1";
+	const int KEY_ESC = 27;
+
+	double TicksToMsec(int64 ticks)
+	{
+		return ticks * 1000.0 / cv::getTickFrequency();
+	}
+}
+
+
+SessionRecorder::SessionRecorder()
+{
+	_backend = 0;
+	_callback = 0;
+	_callback_param = 0;
+	_start_tick = 0;
+}
+
+
+SessionRecorder::~SessionRecorder()
+{
+	Close();
+}
+
+
+bool SessionRecorder::Open(const std::string& log_file, DisplayBackend* backend)
+{
+	Close();
+	_ofs.open(log_file.c_str());
+	if (!_ofs.is_open()){
+		std::cerr << "Fail to open session log " << log_file << "." << std::endl;
+		return false;
+	}
+	_ofs << SESSION_HEADER << std::endl;
+	_ofs << std::fixed << std::setprecision(1);
+	_backend = backend;
+	_start_tick = cv::getTickCount();
+
+	util::SetAnswerObserver([this](const std::string& answer){
+		_ofs << elapsed() << " A " << answer << std::endl;
+	});
+	return true;
+}
+
+
+void SessionRecorder::Close()
+{
+	if (!_ofs.is_open())
+		return;
+	util::SetAnswerObserver(util::AnswerObserver());
+	_ofs.close();
+}
+
+
+double SessionRecorder::elapsed() const
+{
+	return TicksToMsec(cv::getTickCount() - _start_tick);
+}
+
+
+void SessionRecorder::OpenWindow(const std::string& window_name, MouseCallback callback, void* param)
+{
+	_callback = callback;
+	_callback_param = param;
+	_backend->OpenWindow(window_name, SessionRecorder::on_mouse, this);
+}
+
+
+void SessionRecorder::CloseWindow(const std::string& window_name)
+{
+	_backend->CloseWindow(window_name);
+}
+
+
+void SessionRecorder::ShowImage(const std::string& window_name, const cv::Mat& image)
+{
+	_backend->ShowImage(window_name, image);
+}
+
+
+int SessionRecorder::WaitKey(int delay)
+{
+	int key = _backend->WaitKey(delay);
+	if (key >= 0 && _ofs.is_open())
+		_ofs << elapsed() << " K " << key << std::endl;
+	return key;
+}
+
+
+int SessionRecorder::WaitInput(int delay)
+{
+	int key = _backend->WaitInput(delay);
+	if (key >= 0 && _ofs.is_open())
+		_ofs << elapsed() << " K " << key << std::endl;
+	return key;
+}
+
+
+void SessionRecorder::on_mouse(int event, int x, int y, int flag, void* param)
+{
+	SessionRecorder* recorder = (SessionRecorder*)param;
+
+	// ボタンを押していない間の移動は処理されないため記録しない
+	bool ignored = (event == CV_EVENT_MOUSEMOVE && !(flag & CV_EVENT_FLAG_LBUTTON));
+	if (!ignored && recorder->_ofs.is_open())
+		recorder->_ofs << recorder->elapsed() << " M " << event << " " << x << " " << y << " " << flag << std::endl;
+
+	if (recorder->_callback)
+		recorder->_callback(event, x, y, flag, recorder->_callback_param);
+}
+
+
+SessionReplayer::SessionReplayer()
+{
+	_cursor = 0;
+	_handling = -1;
+	_settling = -1;
+	_key_tick = 0;
+	_cin_buf = 0;
+}
+
+
+SessionReplayer::~SessionReplayer()
+{
+	if (_cin_buf)
+		std::cin.rdbuf(_cin_buf);
+}
+
+
+bool SessionReplayer::Load(const std::string& log_file)
+{
+	std::ifstream ifs(log_file.c_str());
+	std::string line;
+	if (!ifs.is_open() || !std::getline(ifs, line) || line.compare(0, strlen(SESSION_HEADER), SESSION_HEADER) != 0){
+		std::cerr << "Fail to read session log " << log_file << "." << std::endl;
+		return false;
+	}
+
+	_records.clear();
+	std::string answers;
+	while (std::getline(ifs, line)){
+		std::istringstream iss(line);
+		Record rec;
+		std::string type;
+		if (!(iss >> rec.recorded_msec >> type))
+			continue;
+		rec.code = rec.x = rec.y = rec.flag = 0;
+		rec.latency_msec = rec.settle_msec = 0;
+		if (type == "K"){
+			rec.type = KEY_EVENT;
+			iss >> rec.code;
+		}
+		else if (type == "M"){
+			rec.type = MOUSE_EVENT;
+			iss >> rec.code >> rec.x >> rec.y >> rec.flag;
+		}
+		else if (type == "A"){
+			std::string answer;
+			iss >> answer;
+			answers += answer + "\n";
+			continue;
+		}
+		else{
+			continue;
+		}
+		if (!iss){
+			std::cerr << "Illegal line in session log: " << line << std::endl;
+			return false;
+		}
+		_records.push_back(rec);
+	}
+	_cursor = 0;
+	_handling = -1;
+	_settling = -1;
+
+	// コンソールでの質問には記録された回答を返す
+	_answers.str(answers);
+	_answers.clear();
+	if (!_cin_buf)
+		_cin_buf = std::cin.rdbuf(_answers.rdbuf());
+	return true;
+}
+
+
+int SessionReplayer::WaitKey(int delay)
+{
+	return NextInput(delay, false);
+}
+
+
+int SessionReplayer::WaitInput(int delay)
+{
+	return NextInput(delay, true);
+}
+
+
+int SessionReplayer::NextInput(int delay, bool stop_at_mouse)
+{
+	int64 now = cv::getTickCount();
+	if (_handling >= 0){
+		_records[_handling].latency_msec = TicksToMsec(now - _key_tick);
+		_settling = _handling;
+		_handling = -1;
+	}
+
+	// バックグラウンド処理の完了を待ってから次の入力を渡す
+	if (delay > 0){
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		return -1;
+	}
+	if (_settling >= 0){
+		_records[_settling].settle_msec = TicksToMsec(now - _key_tick);
+		_settling = -1;
+	}
+
+	while (_cursor < _records.size()){
+		Record& rec = _records[_cursor];
+		_cursor++;
+		int64 start = cv::getTickCount();
+		if (rec.type == KEY_EVENT){
+			_handling = _cursor - 1;
+			_key_tick = start;
+			return rec.code;
+		}
+		DispatchMouse(rec);
+		rec.latency_msec = rec.settle_msec = TicksToMsec(cv::getTickCount() - start);
+		if (stop_at_mouse)
+			return -1;
+	}
+	return KEY_ESC;
+}
+
+
+void SessionReplayer::WriteReport(std::ostream& os, const ImageList& file_list, const std::vector<std::vector<cv::Rect>>& rectlist) const
+{
+	os << "#OMREPLAY 1" << std::endl;
+	os << "# id type code x y flag recorded_ms latency_ms settle_ms" << std::endl;
+	os << std::fixed << std::setprecision(3);
+	int num_keys = 0, num_mouse = 0;
+	double key_sum = 0, key_max = 0, mouse_sum = 0, mouse_max = 0;
+	for (size_t i = 0; i < _cursor && i < _records.size(); i++){
+		const Record& rec = _records[i];
+		bool key = (rec.type == KEY_EVENT);
+		os << i << (key ? " K " : " M ") << rec.code << " " << rec.x << " " << rec.y << " " << rec.flag << " "
+			<< rec.recorded_msec << " " << rec.latency_msec << " " << rec.settle_msec << std::endl;
+		if (key){
+			num_keys++;
+			key_sum += rec.latency_msec;
+			key_max = std::max(key_max, rec.latency_msec);
+		}
+		else{
+			num_mouse++;
+			mouse_sum += rec.latency_msec;
+			mouse_max = std::max(mouse_max, rec.latency_msec);
+		}
+	}
+	os << "# keys " << num_keys << " mean_ms " << (num_keys ? key_sum / num_keys : 0) << " max_ms " << key_max << std::endl;
+	os << "# mouse " << num_mouse << " mean_ms " << (num_mouse ? mouse_sum / num_mouse : 0) << " max_ms " << mouse_max << std::endl;
+
+	// 最終的なマーカー（アノテーションファイルと同じ形式）
+	os << "#annotations" << std::endl;
+	for (size_t i = 0; i < file_list.size() && i < rectlist.size(); i++){
+		os << file_list[i] << " " << rectlist[i].size();
+		for (size_t j = 0; j < rectlist[i].size(); j++){
+			const cv::Rect& r = rectlist[i][j];
+			os << " " << r.x << " " << r.y << " " << r.width << " " << r.height;
+		}
+		os << std::endl;
+	}
+}
@@ -0,0 +1,165 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __SESSION_LOG__
+#define __SESSION_LOG__
+
+#include "DisplayBackend.h"
+#include "ImageList.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+//! 操作の記録
+/*!
+表示先への入力を中継しながら、キー入力、マウス操作、コンソールでの回答を時刻付きで記録する。
+記録形式は1行1操作で、
+  時刻(ms) K キー
+  時刻(ms) M イベント x y フラグ
+  時刻(ms) A 回答
+*/
+class SessionRecorder : public DisplayBackend
+{
+public:
+	SessionRecorder();
+	~SessionRecorder();
+
+	//! 記録の開始
+	/*!
+	\param[in] log_file 記録ファイル名
+	\param[in] backend 入力を中継する表示先
+	\return 記録ファイルを開けたかどうか
+	*/
+	bool Open(const std::string& log_file, DisplayBackend* backend);
+
+	//! 記録の終了
+	void Close();
+
+	bool is_open() const{
+		return _ofs.is_open();
+	}
+
+	void OpenWindow(const std::string& window_name, MouseCallback callback, void* param);
+	void CloseWindow(const std::string& window_name);
+	void ShowImage(const std::string& window_name, const cv::Mat& image);
+	int WaitKey(int delay);
+	int WaitInput(int delay);
+
+private:
+	std::ofstream _ofs;	//!< 記録ファイル
+	DisplayBackend* _backend;	//!< 中継先
+	MouseCallback _callback;	//!< MarkerViewerのコールバック関数
+	void* _callback_param;	//!< コールバック関数の引数
+	int64 _start_tick;	//!< 記録開始時刻
+
+	//! 記録開始からの時刻(ms)
+	double elapsed() const;
+
+	//! マウス操作を記録して中継
+	static void on_mouse(int event, int x, int y, int flag, void* param);
+};
+
+
+//! 記録した操作の再生
+/*!
+記録ファイルの入力を順に渡し、各入力の処理時間を計測する。ウィンドウは開かない。
+画像のデコードやバックグラウンド処理の完了を待ってから次の入力を渡すため、結果は実行環境によらず一定になる
+*/
+class SessionReplayer : public OffscreenBackend
+{
+public:
+	SessionReplayer();
+	~SessionReplayer();
+
+	//! 記録ファイルの読み込み
+	/*!
+	記録されたコンソールでの回答は標準入力の代わりに使われる
+	\param[in] log_file 記録ファイル名
+	\return 読み込みの成否
+	*/
+	bool Load(const std::string& log_file);
+
+	//! 次の入力を渡す
+	/*!
+	delayが0でない（バックグラウンド処理の完了待ち）間は入力を渡さない。
+	マウス操作はその場でコールバック関数へ渡し、記録の終わりではESCを返す
+	*/
+	int WaitKey(int delay);
+
+	//! 次の入力を渡す
+	/*!
+	WaitKeyと同様だが、マウス操作を1つ渡すたびに-1を返す
+	*/
+	int WaitInput(int delay);
+
+	//! 全ての入力を渡し終えたかどうか
+	bool is_finished() const{
+		return _cursor >= _records.size();
+	}
+
+	//! 再生結果の出力
+	/*!
+	各入力の処理時間と、最終的な全画像のマーカーを出力する
+	\param[in] os 出力先
+	\param[in] file_list 画像ファイルへのパス
+	\param[in] rectlist 各画像のマーカー
+	*/
+	void WriteReport(std::ostream& os, const ImageList& file_list, const std::vector<std::vector<cv::Rect>>& rectlist) const;
+
+private:
+	//! 記録された入力と計測結果
+	struct Record : public InputEvent{
+		double recorded_msec;	//!< 記録時の時刻
+		double latency_msec;	//!< 次の入力待ちまでの時間
+		double settle_msec;	//!< バックグラウンド処理の完了までの時間
+	};
+
+	std::vector<Record> _records;	//!< 記録された入力
+	size_t _cursor;	//!< 次に渡す入力
+	int _handling;	//!< 処理中のキー入力（なければ-1）
+	int _settling;	//!< バックグラウンド処理の完了待ちのキー入力（なければ-1）
+	int64 _key_tick;	//!< キー入力を渡した時刻
+
+	std::istringstream _answers;	//!< 記録されたコンソールでの回答
+	std::streambuf* _cin_buf;	//!< 差し替え前の標準入力
+
+	//! 次の入力を渡す
+	/*!
+	\param[in] delay 待ち時間(ms)。0でない間は入力を渡さない
+	\param[in] stop_at_mouse trueの場合はマウス操作を1つ渡すたびに-1を返す
+	\return 入力されたキー
+	*/
+	int NextInput(int delay, bool stop_at_mouse);
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "TaskExecutor.h"
+#include <chrono>
+#include <iostream>
+
+namespace{
+	long long GetTickMSec(){
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	const long long PROGRESS_INTERVAL = 200;	// 進捗を通知する間隔(ms)
+}
+
+
+TaskContext::TaskContext(int task_id, util::LockFreeQueue<TaskEvent>* events)
+	: _task_id(task_id), _cancel(false), _events(events), _last_tick(0)
+{
+}
+
+
+bool TaskContext::Progress(int done, int total)
+{
+	long long tick = GetTickMSec();
+	if (tick - _last_tick >= PROGRESS_INTERVAL){
+		// 進捗はキューが満杯なら捨てても問題ない
+		if (_events->Push(TaskEvent(TaskEvent::PROGRESS, _task_id, done, total)))
+			_last_tick = tick;
+	}
+	return !is_cancelled();
+}
+
+
+std::function<bool(int, int)> TaskContext::ProgressCallback()
+{
+	return [this](int done, int total){ return this->Progress(done, total); };
+}
+
+
+TaskExecutor::TaskExecutor(int num_threads) : _quit(false), _events(1024), _next_id(0)
+{
+	if (num_threads <= 0)
+		num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+	for (int i = 0; i < num_threads; i++)
+		_workers.push_back(std::thread(&TaskExecutor::WorkerLoop, this));
+}
+
+
+TaskExecutor::~TaskExecutor()
+{
+	CancelAll();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_cond.notify_all();
+	for (size_t i = 0; i < _workers.size(); i++)
+		_workers[i].join();
+}
+
+
+int TaskExecutor::Post(const std::string& name, const Work& work, const Completion& on_complete)
+{
+	int id = _next_id++;
+
+	Task task;
+	task.id = id;
+	task.work = work;
+	task.context = std::make_shared<TaskContext>(id, &_events);
+
+	TaskEntry entry;
+	entry.name = name;
+	entry.on_complete = on_complete;
+	entry.context = task.context;
+	_tasks[id] = entry;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_queue.push_back(task);
+	}
+	_cond.notify_one();
+
+	std::cout << "[" << name << "] started in background ('x' to cancel)." << std::endl;
+	return id;
+}
+
+
+void TaskExecutor::PushEvent(const TaskEvent& ev)
+{
+	while (!_events.Push(ev))
+		std::this_thread::yield();
+}
+
+
+void TaskExecutor::WorkerLoop()
+{
+	while (true){
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cond.wait(lock, [this]{ return _quit || !_queue.empty(); });
+			if (_queue.empty())
+				break;
+			task = _queue.front();
+			_queue.pop_front();
+		}
+
+		TaskContext& ctx = *task.context;
+		if (ctx.is_cancelled()){
+			PushEvent(TaskEvent(TaskEvent::CANCELLED, task.id, 0, 0));
+			continue;
+		}
+
+		bool ret = false;
+		try{
+			ret = task.work(ctx);
+		}
+		catch (std::exception& e){
+			std::cerr << e.what() << std::endl;
+			ret = false;
+		}
+
+		int type = ctx.is_cancelled() ? TaskEvent::CANCELLED : (ret ? TaskEvent::DONE : TaskEvent::FAILED);
+		PushEvent(TaskEvent(type, task.id, 0, 0));
+	}
+}
+
+
+int TaskExecutor::ProcessEvents()
+{
+	int count = 0;
+	TaskEvent ev;
+	while (_events.Pop(ev)){
+		count++;
+		std::map<int, TaskEntry>::iterator it = _tasks.find(ev.task_id);
+		if (it == _tasks.end())
+			continue;
+
+		const std::string& name = it->second.name;
+		if (ev.type == TaskEvent::PROGRESS){
+			std::cout << "[" << name << "] " << ev.done;
+			if (ev.total > 0)
+				std::cout << " / " << ev.total;
+			std::cout << std::endl;
+			continue;
+		}
+
+		if (ev.type == TaskEvent::CANCELLED){
+			std::cout << "[" << name << "] cancelled." << std::endl;
+		}
+		else{
+			std::cout << "[" << name << "] " << (ev.type == TaskEvent::DONE ? "done." : "failed.") << std::endl;
+			if (it->second.on_complete)
+				it->second.on_complete(ev.type == TaskEvent::DONE);
+		}
+		_tasks.erase(ev.task_id);
+	}
+	return count;
+}
+
+
+bool TaskExecutor::Cancel(int task_id)
+{
+	std::map<int, TaskEntry>::iterator it = _tasks.find(task_id);
+	if (it == _tasks.end())
+		return false;
+	it->second.context->Cancel();
+	return true;
+}
+
+
+void TaskExecutor::CancelAll()
+{
+	std::map<int, TaskEntry>::iterator it;
+	for (it = _tasks.begin(); it != _tasks.end(); it++)
+		it->second.context->Cancel();
+}
+
+
+void TaskExecutor::PrintStatus() const
+{
+	std::map<int, TaskEntry>::const_iterator it;
+	for (it = _tasks.begin(); it != _tasks.end(); it++)
+		std::cout << "実行中の処理： " << it->second.name << std::endl;
+}
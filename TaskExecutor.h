@@ -0,0 +1,187 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __TASK_EXECUTOR__
+#define __TASK_EXECUTOR__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "LockFreeQueue.hpp"
+
+//! バックグラウンド処理からUIスレッドへ通知されるイベント
+struct TaskEvent
+{
+	enum Type { PROGRESS, DONE, FAILED, CANCELLED };
+
+	int type;	//!< イベントの種類
+	int task_id;	//!< 処理ID
+	int done;	//!< 処理済みの数
+	int total;	//!< 全体の数（不明な場合は0）
+
+	TaskEvent() : type(PROGRESS), task_id(-1), done(0), total(0){}
+	TaskEvent(int t, int id, int d, int n) : type(t), task_id(id), done(d), total(n){}
+};
+
+
+//! 実行中の処理から参照する進捗通知と中断フラグ
+class TaskContext
+{
+public:
+	TaskContext(int task_id, util::LockFreeQueue<TaskEvent>* events);
+
+	//! 中断要求があったかどうか
+	bool is_cancelled() const{
+		return _cancel.load();
+	}
+
+	//! 中断要求
+	void Cancel(){
+		_cancel.store(true);
+	}
+
+	//! 進捗の通知
+	/*!
+	通知は一定間隔に間引かれる
+	\return 処理を継続してよいか（中断要求があればfalse）
+	*/
+	bool Progress(int done, int total);
+
+	//! util関数に渡すための進捗通知関数
+	std::function<bool(int, int)> ProgressCallback();
+
+	int task_id() const{
+		return _task_id;
+	}
+
+private:
+	int _task_id;
+	std::atomic<bool> _cancel;
+	util::LockFreeQueue<TaskEvent>* _events;
+	long long _last_tick;	//!< 最後に進捗を通知した時刻(ms)
+};
+
+
+//! バックグラウンド処理の実行クラス
+/*!
+処理をワーカースレッドで実行し、進捗と完了をロックフリーキュー経由でUIスレッドへ通知する。
+Post/ProcessEvents/Cancel/CancelAllはUIスレッドからのみ呼び出すこと
+*/
+class TaskExecutor
+{
+public:
+	typedef std::function<bool(TaskContext&)> Work;	//!< ワーカースレッドで実行する処理（成否を返す）
+	typedef std::function<void(bool)> Completion;	//!< UIスレッドで実行する完了処理
+
+	//! コンストラクタ
+	/*!
+	\param[in] num_threads ワーカースレッド数（0の場合はCPU数）
+	*/
+	explicit TaskExecutor(int num_threads = 0);
+	~TaskExecutor();
+
+	//! 処理の登録
+	/*!
+	\param[in] name 処理名（進捗表示用）
+	\param[in] work ワーカースレッドで実行する処理
+	\param[in] on_complete 処理が成功/失敗した時にUIスレッドで呼ばれる関数（中断時は呼ばれない）
+	\return 処理ID
+	*/
+	int Post(const std::string& name, const Work& work, const Completion& on_complete = Completion());
+
+	//! 届いたイベントの処理
+	/*!
+	進捗を表示し、完了した処理の完了関数を呼び出す
+	\return 処理したイベント数
+	*/
+	int ProcessEvents();
+
+	//! 実行中/待機中の処理があるかどうか
+	bool is_busy() const{
+		return !_tasks.empty();
+	}
+
+	//! 処理の中断
+	/*!
+	\param[in] task_id 処理ID
+	\return 未完了の処理だったかどうか
+	*/
+	bool Cancel(int task_id);
+
+	//! 全ての処理を中断
+	void CancelAll();
+
+	//! 処理状況の表示
+	void PrintStatus() const;
+
+private:
+	struct Task{
+		int id;
+		Work work;
+		std::shared_ptr<TaskContext> context;
+	};
+
+	struct TaskEntry{
+		std::string name;
+		Completion on_complete;
+		std::shared_ptr<TaskContext> context;
+	};
+
+	std::vector<std::thread> _workers;	//!< ワーカースレッド
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	std::deque<Task> _queue;	//!< 実行待ちの処理
+	bool _quit;
+
+	util::LockFreeQueue<TaskEvent> _events;	//!< ワーカーからUIスレッドへのイベント
+	std::map<int, TaskEntry> _tasks;	//!< 未完了の処理（UIスレッドのみが参照）
+	int _next_id;
+
+	//! ワーカースレッドのループ
+	void WorkerLoop();
+
+	//! イベントを確実に通知（キューが満杯の場合は空くまで待つ）
+	void PushEvent(const TaskEvent& ev);
+
+	TaskExecutor(const TaskExecutor&);
+	TaskExecutor& operator=(const TaskExecutor&);
+};
+
+#endif
@@ -0,0 +1,416 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "ThumbnailCache.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "ContentIndex.h"
+#include "ImageProbe.h"
+
+// 縮小デコード(IMREAD_REDUCED_*)はOpenCV 3.1以降で利用可能
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 1)
+#define HAVE_REDUCED_DECODE
+#endif
+
+namespace{
+	const char* INDEX_SIGNATURE = "#OMTHUMB 3";
+}
+
+
+ThumbnailCache::ThumbnailCache()
+{
+	_loaded = false;
+	_dirty = false;
+	_cache_dir = "thumbnails";
+	_thumb_size = 160;
+	_num_threads = 0;
+	_PREFETCH = false;
+}
+
+
+ThumbnailCache::~ThumbnailCache()
+{
+	if (!Flush())
+		std::cerr << "Fail to write thumbnail index " << IndexFile() << "." << std::endl;
+}
+
+
+std::string ThumbnailCache::IndexSignature() const
+{
+	std::ostringstream oss;
+	oss << INDEX_SIGNATURE << " " << _thumb_size;
+	return oss.str();
+}
+
+
+std::string ThumbnailCache::IndexFile() const
+{
+	return (boost::filesystem::path(_cache_dir) / "index.txt").string();
+}
+
+
+std::string ThumbnailCache::PackFile() const
+{
+	return (boost::filesystem::path(_cache_dir) / "thumbs.pack").string();
+}
+
+
+void ThumbnailCache::LoadIndex()
+{
+	_loaded = true;
+	if (!is_persistent())
+		return;
+
+	std::ifstream ifs(IndexFile());
+	std::string buf;
+	if (!ifs.is_open() || !std::getline(ifs, buf) || buf != IndexSignature()){
+		// 索引のないパックファイルや、縮小画像の大きさが異なるパックファイルは作り直す
+		ifs.close();
+		boost::system::error_code ec;
+		boost::filesystem::remove(PackFile(), ec);
+		return;
+	}
+
+	// 1行に「ハッシュ(16進) サイズ 更新時刻 位置 バイト数 縮小画像の長辺 幅 高さ パス」
+	while (std::getline(ifs, buf)){
+		std::istringstream iss(buf);
+		Entry entry;
+		Blob blob;
+		long long mtime;
+		iss >> std::hex >> entry.hash >> std::dec >> entry.size >> mtime
+			>> blob.offset >> blob.length >> blob.thumb_size >> blob.org_size.width >> blob.org_size.height;
+		iss.ignore(1);
+		std::string path;
+		if (!iss || !std::getline(iss, path) || path.empty() || blob.thumb_size != _thumb_size)
+			continue;
+		entry.mtime = (std::time_t)mtime;
+		_entries[path] = entry;
+		_blobs[entry.hash] = blob;
+	}
+}
+
+
+bool ThumbnailCache::FindBlob(const std::string& path, uintmax_t size, std::time_t mtime, Blob& blob) const
+{
+	std::unordered_map<std::string, Entry>::const_iterator it = _entries.find(path);
+	if (it == _entries.end() || it->second.size != size || it->second.mtime != mtime)
+		return false;
+	std::unordered_map<uint64, Blob>::const_iterator bit = _blobs.find(it->second.hash);
+	if (bit == _blobs.end() || bit->second.thumb_size != _thumb_size)
+		return false;
+	blob = bit->second;
+	return true;
+}
+
+
+bool ThumbnailCache::ReadBlob(const Blob& blob, cv::Mat& thumb) const
+{
+	if (blob.length <= 0)
+		return false;
+	std::ifstream ifs(PackFile(), std::ios::binary);
+	if (!ifs.is_open())
+		return false;
+	std::vector<uchar> data(blob.length);
+	ifs.seekg(blob.offset);
+	if (!ifs.read((char*)&data[0], blob.length))
+		return false;
+	thumb = cv::imdecode(data, cv::IMREAD_COLOR);
+	return !thumb.empty();
+}
+
+
+bool ThumbnailCache::AppendBlob(const std::vector<uchar>& data, Blob& blob)
+{
+	if (!_pack.is_open()){
+		boost::system::error_code ec;
+		boost::filesystem::create_directories(_cache_dir, ec);
+		_pack.open(PackFile(), std::ios::binary | std::ios::app);
+		if (!_pack.is_open())
+			return false;
+	}
+	_pack.seekp(0, std::ios::end);
+	blob.offset = (long long)_pack.tellp();
+	blob.length = data.size();
+	// 他のスレッドがすぐに読めるよう書き出しておく
+	_pack.write((const char*)&data[0], data.size());
+	_pack.flush();
+	if (!_pack){
+		_pack.close();
+		return false;
+	}
+	return true;
+}
+
+
+bool ThumbnailCache::Lookup(const std::string& filename, Blob& blob)
+{
+	if (!is_persistent())
+		return false;
+	boost::system::error_code ec;
+	uintmax_t size = boost::filesystem::file_size(filename, ec);
+	std::time_t mtime = 0;
+	if (!ec)
+		mtime = boost::filesystem::last_write_time(filename, ec);
+	if (ec)
+		return false;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_loaded)
+		LoadIndex();
+	return FindBlob(ContentIndex::NormalizePath(filename), size, mtime, blob);
+}
+
+
+bool ThumbnailCache::Find(const std::string& filename, cv::Mat& thumb, cv::Size& org_size)
+{
+	Blob blob;
+	if (!Lookup(filename, blob) || !ReadBlob(blob, thumb))
+		return false;
+	org_size = blob.org_size;
+	return true;
+}
+
+
+bool ThumbnailCache::Get(const std::string& filename, cv::Mat& thumb, cv::Size& org_size)
+{
+	if (Find(filename, thumb, org_size))
+		return true;
+
+	// サイズか更新時刻が変わった画像や新しいパスは、内容が同じ縮小画像を探す
+	std::string path = ContentIndex::NormalizePath(filename);
+	Entry entry;
+	bool hashed = false;
+	if (is_persistent()){
+		boost::system::error_code ec;
+		entry.size = boost::filesystem::file_size(filename, ec);
+		if (!ec)
+			entry.mtime = boost::filesystem::last_write_time(filename, ec);
+		hashed = !ec && ContentIndex::HashFile(filename, entry.hash);
+	}
+	if (hashed){
+		Blob blob;
+		bool found = false;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			std::unordered_map<uint64, Blob>::const_iterator it = _blobs.find(entry.hash);
+			if (it != _blobs.end() && it->second.thumb_size == _thumb_size){
+				blob = it->second;
+				found = true;
+			}
+		}
+		if (found && ReadBlob(blob, thumb)){
+			org_size = blob.org_size;
+			std::lock_guard<std::mutex> lock(_mutex);
+			_entries[path] = entry;
+			_dirty = true;
+			return true;
+		}
+	}
+
+	// 原画像サイズがヘッダから分かれば、縮小画像の大きさを下回らない範囲で縮小デコードする
+	int flag = cv::IMREAD_COLOR;
+	bool probed = ImageProbe::ReadSize(filename, org_size);
+#ifdef HAVE_REDUCED_DECODE
+	if (probed){
+		int long_side = std::max(org_size.width, org_size.height);
+		if (long_side >= _thumb_size * 8)
+			flag = cv::IMREAD_REDUCED_COLOR_8;
+		else if (long_side >= _thumb_size * 4)
+			flag = cv::IMREAD_REDUCED_COLOR_4;
+		else if (long_side >= _thumb_size * 2)
+			flag = cv::IMREAD_REDUCED_COLOR_2;
+	}
+#endif
+	cv::Mat img = cv::imread(filename, flag);
+	if (img.empty())
+		return false;
+	if (!probed || flag == cv::IMREAD_COLOR)
+		org_size = img.size();
+	double scale = std::min(1.0, (double)_thumb_size / std::max(org_size.width, org_size.height));
+	cv::Size thumb_size(std::max(1, (int)(org_size.width * scale + 0.5)), std::max(1, (int)(org_size.height * scale + 0.5)));
+	cv::resize(img, thumb, thumb_size, 0, 0, cv::INTER_AREA);
+	if (!hashed)
+		return true;
+
+	std::vector<uchar> data;
+	if (!cv::imencode(".jpg", thumb, data))
+		return true;
+	Blob blob;
+	blob.org_size = org_size;
+	blob.thumb_size = _thumb_size;
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (AppendBlob(data, blob)){
+		_blobs[entry.hash] = blob;
+		_entries[path] = entry;
+		_dirty = true;
+	}
+	return true;
+}
+
+
+bool ThumbnailCache::Generate(const ImageList& file_list, int start, const util::ProgressCallback& progress)
+{
+	int num_files = file_list.size();
+	if (num_files == 0)
+		return true;
+	start = std::max(0, std::min(start, num_files - 1));
+
+	std::atomic<int> next(0);
+	std::atomic<int> num_done(0);
+	std::atomic<bool> cancel(false);
+
+	auto worker = [&](){
+		std::string path;
+		cv::Mat thumb;
+		cv::Size org_size;
+		Blob blob;
+		while (!cancel.load()){
+			int k = next++;
+			if (k >= num_files)
+				break;
+			// キャッシュ済みの画像は縮小画像を読み込まずに飛ばす
+			file_list.Get((start + k) % num_files, path);
+			if (!Lookup(path, blob))
+				Get(path, thumb, org_size);
+			num_done++;
+		}
+	};
+
+	int num_threads = (_num_threads > 0) ? _num_threads : std::max(1, (int)std::thread::hardware_concurrency());
+	std::vector<std::thread> threads;
+	for (int i = 0; i < num_threads; i++)
+		threads.push_back(std::thread(worker));
+
+	while (num_done.load() < num_files && !cancel.load()){
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		if (!util::ReportProgress(progress, num_done.load(), num_files))
+			cancel = true;
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	// 中断された場合も作成済みの分は残す
+	if (!Flush())
+		std::cerr << "Fail to write thumbnail index " << IndexFile() << "." << std::endl;
+	return !cancel.load();
+}
+
+
+bool ThumbnailCache::Flush()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_dirty || !is_persistent())
+		return true;
+
+	// 書き込み途中で中断されても索引が壊れないよう、一時ファイルに書いてから置き換える
+	std::string index_file = IndexFile();
+	std::string tmp_file = index_file + ".tmp";
+	{
+		std::ofstream ofs(tmp_file);
+		if (!ofs.is_open())
+			return false;
+
+		ofs << IndexSignature() << "\n";
+		std::unordered_map<std::string, Entry>::const_iterator it;
+		for (it = _entries.begin(); it != _entries.end(); it++){
+			std::unordered_map<uint64, Blob>::const_iterator bit = _blobs.find(it->second.hash);
+			if (bit == _blobs.end())
+				continue;
+			ofs << std::hex << std::setw(16) << std::setfill('0') << it->second.hash << std::dec
+				<< " " << it->second.size << " " << (long long)it->second.mtime
+				<< " " << bit->second.offset << " " << bit->second.length << " " << bit->second.thumb_size
+				<< " " << bit->second.org_size.width << " " << bit->second.org_size.height << " " << it->first << "\n";
+		}
+		if (!ofs)
+			return false;
+	}
+	boost::system::error_code ec;
+	boost::filesystem::rename(tmp_file, index_file, ec);
+	if (ec)
+		return false;
+	_dirty = false;
+	return true;
+}
+
+
+//! パラメータ読み込み
+void ThumbnailCache::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!fn["thumb_cache_dir"].empty())
+		fn["thumb_cache_dir"] >> _cache_dir;
+	if (!fn["thumb_size"].empty())
+		_thumb_size = std::max(16, (int)fn["thumb_size"]);
+	_num_threads = fn["thumb_threads"];
+	_PREFETCH = (int)fn["thumb_prefetch"] != 0;
+
+	// キャッシュフォルダが変わった場合に備えて索引を読み直す
+	_entries.clear();
+	_blobs.clear();
+	_pack.close();
+	_loaded = false;
+	_dirty = false;
+}
+
+
+//! パラメータ書き込み
+void ThumbnailCache::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "thumb_cache_dir" << _cache_dir;
+	fs << "thumb_size" << _thumb_size;
+	fs << "thumb_threads" << _num_threads;
+	fs << "thumb_prefetch" << (int)_PREFETCH;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void ThumbnailCache::PrintStatus() const
+{
+	std::cout << "縮小画像のキャッシュ： " << (is_persistent() ? _cache_dir : "NO") << std::endl;
+}
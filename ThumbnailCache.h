@@ -0,0 +1,178 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __THUMBNAIL_CACHE__
+#define __THUMBNAIL_CACHE__
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <fstream>
+#include <ctime>
+#include "ImageList.h"
+#include "util_functions.h"
+
+//! 画像の縮小版のキャッシュ
+/*!
+各画像を長辺がthumb_sizeになるよう縮小してJPEGに圧縮し、キャッシュフォルダの1つのパックファイルへ追記する。
+縮小画像は画像ファイルの内容のハッシュで識別するため、移動やコピーされた画像も再デコードしない。
+索引ファイルには縮小画像の大きさと、パスごとのサイズ、更新時刻、内容のハッシュ、パックファイル上の位置、原画像サイズを記録し、
+サイズか更新時刻が変わった画像のみハッシュを計算し直す。thumb_sizeを変更した場合はキャッシュを作り直す。複数スレッドから同時に呼び出せる
+*/
+class ThumbnailCache
+{
+public:
+	ThumbnailCache();
+	~ThumbnailCache();
+
+	//! 縮小画像の取得
+	/*!
+	キャッシュになければ原画像をデコードして作成し、キャッシュへ追加する
+	\param[in] filename 画像ファイル名
+	\param[out] thumb 縮小画像
+	\param[out] org_size 原画像のサイズ
+	\return 取得の成否
+	*/
+	bool Get(const std::string& filename, cv::Mat& thumb, cv::Size& org_size);
+
+	//! キャッシュにある縮小画像の取得
+	/*!
+	ハッシュの計算やデコードを行わず、パス、サイズ、更新時刻が一致する縮小画像のみを返す。プレビュー表示用
+	\param[in] filename 画像ファイル名
+	\param[out] thumb 縮小画像
+	\param[out] org_size 原画像のサイズ
+	\return キャッシュにあったかどうか
+	*/
+	bool Find(const std::string& filename, cv::Mat& thumb, cv::Size& org_size);
+
+	//! 画像一覧の縮小画像を複数スレッドで作成
+	/*!
+	\param[in] file_list 画像一覧
+	\param[in] start 最初に作成する画像ID（以降、末尾から先頭へ折り返して作成）
+	\param[in] progress 進捗通知関数
+	\return 作成の成否（中断された場合はfalse）
+	*/
+	bool Generate(const ImageList& file_list, int start, const util::ProgressCallback& progress = util::ProgressCallback());
+
+	//! 追加された縮小画像の索引を保存
+	bool Flush();
+
+	//! 縮小画像の長辺の長さ
+	int thumb_size() const{
+		return _thumb_size;
+	}
+
+	//! 縮小画像をファイルに保存するかどうか
+	bool is_persistent() const{
+		return !_cache_dir.empty();
+	}
+
+	//! 画像一覧の読み込み時に縮小画像を作成するかどうか
+	bool is_prefetch() const{
+		return _PREFETCH && is_persistent();
+	}
+
+	//! 画像一覧の読み込み時に縮小画像を作成するかどうかを設定
+	void SetPrefetch(bool prefetch){
+		_PREFETCH = prefetch;
+	}
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	//! 画像ファイル1つ分の記録
+	struct Entry{
+		uint64 hash;	//!< 内容のハッシュ
+		uintmax_t size;	//!< ファイルサイズ
+		std::time_t mtime;	//!< 更新時刻
+	};
+
+	//! パックファイル上の縮小画像1つ分の記録
+	struct Blob{
+		long long offset;	//!< 先頭位置
+		int length;	//!< JPEGのバイト数
+		int thumb_size;	//!< 作成時の縮小画像の長辺の長さ
+		cv::Size org_size;	//!< 原画像のサイズ
+	};
+
+	std::mutex _mutex;
+	std::unordered_map<std::string, Entry> _entries;	//!< 正規化したパスから画像ファイルの記録への対応
+	std::unordered_map<uint64, Blob> _blobs;	//!< 内容のハッシュから縮小画像の記録への対応
+	std::ofstream _pack;	//!< パックファイルへの追記用
+	bool _loaded;	//!< 索引ファイルを読み込んだかどうか
+	bool _dirty;	//!< 保存していない記録があるかどうか
+
+	/////// パラメータ /////////////
+	std::string _cache_dir;	//!< キャッシュフォルダ（空の場合はファイルに保存しない）
+	int _thumb_size;	//!< 縮小画像の長辺の長さ
+	int _num_threads;	//!< 作成スレッド数（0の場合はCPU数）
+	bool _PREFETCH;	//!< 画像一覧の読み込み時に縮小画像を作成するかどうか
+	///////////////////////////////////
+
+	//! 索引ファイルの先頭行（縮小画像の大きさを含む）
+	std::string IndexSignature() const;
+
+	//! 索引ファイル名
+	std::string IndexFile() const;
+
+	//! パックファイル名
+	std::string PackFile() const;
+
+	//! 索引ファイルの読み込み（ロック中に呼ぶ）
+	void LoadIndex();
+
+	//! 画像ファイルのサイズと更新時刻を調べ、一致する縮小画像の記録を探す
+	bool Lookup(const std::string& filename, Blob& blob);
+
+	//! パスとサイズ、更新時刻が一致する縮小画像の記録を探す（ロック中に呼ぶ）
+	bool FindBlob(const std::string& path, uintmax_t size, std::time_t mtime, Blob& blob) const;
+
+	//! パックファイルから縮小画像を読み込み
+	bool ReadBlob(const Blob& blob, cv::Mat& thumb) const;
+
+	//! パックファイルへ縮小画像を追記（ロック中に呼ぶ）
+	bool AppendBlob(const std::vector<uchar>& data, Blob& blob);
+
+	ThumbnailCache(const ThumbnailCache&);
+	ThumbnailCache& operator=(const ThumbnailCache&);
+};
+
+#endif
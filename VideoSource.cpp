@@ -0,0 +1,291 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "VideoSource.h"
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/algorithm/string.hpp>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+namespace{
+	const char* INDEX_SIGNATURE = "#OMVIDX 1";
+
+	//! メモリ上のフレーム表
+	struct MemoryIndex{
+		long long size;	//!< 作成時の動画ファイルサイズ
+		long long mtime;	//!< 作成時の動画ファイル更新時刻
+		std::vector<double> timestamps;	//!< 各フレームのタイムスタンプ(ms)
+	};
+
+	//! プロセス内で作成・読み込みしたフレーム表（フレーム表ファイルを書けない場合も再走査しないため）
+	std::map<std::string, MemoryIndex>& MemoryIndices()
+	{
+		static std::map<std::string, MemoryIndex> indices;
+		return indices;
+	}
+
+	std::mutex& MemoryIndexMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	//! 動画ファイルのサイズと更新時刻
+	bool GetFileStamp(const std::string& path, long long& size, long long& mtime)
+	{
+		boost::system::error_code ec;
+		size = (long long)boost::filesystem::file_size(path, ec);
+		if (ec)
+			return false;
+		mtime = (long long)boost::filesystem::last_write_time(path, ec);
+		return !ec;
+	}
+
+	std::string MemoryIndexKey(const std::string& path)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::path abs_path = boost::filesystem::canonical(path, ec);
+		return ec ? path : abs_path.generic_string();
+	}
+}
+
+
+VideoSource::VideoSource()
+{
+	_next_frame = 0;
+	_seek_interval = 30;
+	_max_forward = 60;
+}
+
+
+VideoSource::~VideoSource()
+{
+	Close();
+}
+
+
+bool VideoSource::IsVideoFile(const std::string& filename)
+{
+	std::string ext = boost::algorithm::to_lower_copy(boost::filesystem::path(filename).extension().string());
+	return (ext == ".avi" || ext == ".mp4" || ext == ".mov" || ext == ".mkv" || ext == ".wmv" ||
+		ext == ".mpg" || ext == ".mpeg" || ext == ".m4v");
+}
+
+
+bool VideoSource::Open(const std::string& video_file, const util::ProgressCallback& progress)
+{
+	Close();
+
+	if (!_cap.open(video_file))
+		return false;
+	_path = video_file;
+	_frame_size = cv::Size((int)_cap.get(CV_CAP_PROP_FRAME_WIDTH), (int)_cap.get(CV_CAP_PROP_FRAME_HEIGHT));
+
+	if (LoadMemoryIndex())
+		return true;
+
+	if (!LoadIndex()){
+		if (!BuildIndex(progress)){
+			Close();
+			return false;
+		}
+		if (!SaveIndex())
+			std::cerr << "Fail to write frame index " << IndexFileName() << "." << std::endl;
+	}
+	StoreMemoryIndex();
+	return true;
+}
+
+
+void VideoSource::Close()
+{
+	_cap.release();
+	_path.clear();
+	_timestamps.clear();
+	_frame_size = cv::Size();
+	_next_frame = 0;
+}
+
+
+std::string VideoSource::IndexFileName() const
+{
+	return _path + ".omidx";
+}
+
+
+bool VideoSource::LoadMemoryIndex()
+{
+	long long file_size, mtime;
+	if (!GetFileStamp(_path, file_size, mtime))
+		return false;
+
+	std::string key = MemoryIndexKey(_path);
+	std::lock_guard<std::mutex> lock(MemoryIndexMutex());
+	std::map<std::string, MemoryIndex>::const_iterator it = MemoryIndices().find(key);
+	if (it == MemoryIndices().end() || it->second.size != file_size || it->second.mtime != mtime)
+		return false;
+	_timestamps = it->second.timestamps;
+	return true;
+}
+
+
+void VideoSource::StoreMemoryIndex() const
+{
+	MemoryIndex index;
+	if (!GetFileStamp(_path, index.size, index.mtime))
+		return;
+	index.timestamps = _timestamps;
+
+	std::string key = MemoryIndexKey(_path);
+	std::lock_guard<std::mutex> lock(MemoryIndexMutex());
+	MemoryIndices()[key] = index;
+}
+
+
+bool VideoSource::BuildIndex(const util::ProgressCallback& progress)
+{
+	// 先頭から全フレームを走査してタイムスタンプを記録
+	_timestamps.clear();
+	int total = (int)_cap.get(CV_CAP_PROP_FRAME_COUNT);
+	while (_cap.grab()){
+		_timestamps.push_back(_cap.get(CV_CAP_PROP_POS_MSEC));
+		if (!util::ReportProgress(progress, _timestamps.size(), total))
+			return false;
+	}
+
+	// 走査後は先頭に戻す
+	_cap.release();
+	if (!_cap.open(_path))
+		return false;
+	_next_frame = 0;
+	return !_timestamps.empty();
+}
+
+
+bool VideoSource::LoadIndex()
+{
+	std::ifstream ifs(IndexFileName());
+	if (!ifs.is_open())
+		return false;
+
+	std::string buf;
+	if (!std::getline(ifs, buf) || buf != INDEX_SIGNATURE)
+		return false;
+
+	// 動画ファイルが更新されていれば作り直す
+	boost::system::error_code ec;
+	long long file_size = (long long)boost::filesystem::file_size(_path, ec);
+	long long mtime = (long long)boost::filesystem::last_write_time(_path, ec);
+	long long cached_size, cached_mtime;
+	int num;
+	ifs >> cached_size >> cached_mtime >> num;
+	if (!ifs || ec || cached_size != file_size || cached_mtime != mtime || num <= 0)
+		return false;
+
+	_timestamps.resize(num);
+	for (int i = 0; i < num; i++)
+		ifs >> _timestamps[i];
+	if (!ifs){
+		_timestamps.clear();
+		return false;
+	}
+	return true;
+}
+
+
+bool VideoSource::SaveIndex() const
+{
+	std::ofstream ofs(IndexFileName());
+	if (!ofs.is_open())
+		return false;
+
+	boost::system::error_code ec;
+	ofs << INDEX_SIGNATURE << "\n";
+	ofs << (long long)boost::filesystem::file_size(_path, ec) << " "
+		<< (long long)boost::filesystem::last_write_time(_path, ec) << " "
+		<< _timestamps.size() << "\n";
+	ofs.precision(12);
+	for (size_t i = 0; i < _timestamps.size(); i++)
+		ofs << _timestamps[i] << "\n";
+	return true;
+}
+
+
+bool VideoSource::Seek(int idx)
+{
+	// 表のシーク位置へ移動し、実際に到達したフレーム番号を確認する
+	int target = idx - idx % _seek_interval;
+	while (target >= 0){
+		_cap.set(CV_CAP_PROP_POS_MSEC, _timestamps[target]);
+		int pos = (int)_cap.get(CV_CAP_PROP_POS_FRAMES);
+		if (pos >= 0 && pos <= idx){
+			_next_frame = pos;
+			return true;
+		}
+		// 行き過ぎた場合はひとつ前のシーク位置から
+		target -= _seek_interval;
+	}
+
+	// 先頭から読み直す
+	_cap.release();
+	if (!_cap.open(_path))
+		return false;
+	_next_frame = 0;
+	return true;
+}
+
+
+bool VideoSource::Read(int idx, cv::Mat& frame)
+{
+	if (!_cap.isOpened() || idx < 0 || idx >= num_frames())
+		return false;
+
+	if (idx < _next_frame || idx - _next_frame > _max_forward){
+		if (!Seek(idx))
+			return false;
+	}
+
+	// 目的のフレームまで読み進める
+	while (_next_frame < idx){
+		if (!_cap.grab())
+			return false;
+		_next_frame++;
+	}
+	if (!_cap.grab())
+		return false;
+	_next_frame++;
+	return _cap.retrieve(frame);
+}
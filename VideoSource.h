@@ -0,0 +1,127 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __VIDEO_SOURCE__
+#define __VIDEO_SOURCE__
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <string>
+#include <vector>
+#include "util_functions.h"
+
+//! 動画ファイルからのフレーム読み込み
+/*!
+初回に全フレームのタイムスタンプ表を作成して動画ファイルの横に保存し（保存できない場合もプロセス内では保持する）、
+任意のフレームへは表から求めたシーク位置に移動してから順にデコードする。
+連続するフレームの読み込みでは開いたデコーダをそのまま使う
+*/
+class VideoSource
+{
+public:
+	VideoSource();
+	~VideoSource();
+
+	//! 動画ファイルを開く
+	/*!
+	フレーム表がなければ作成する（全フレームを1度走査する）。
+	同じプロセスで開いたことのある動画ファイルは、更新されていなければメモリ上のフレーム表を使う
+	\param[in] video_file 動画ファイル名
+	\param[in] progress 進捗通知関数（フレーム表の作成時）
+	\return 成否
+	*/
+	bool Open(const std::string& video_file, const util::ProgressCallback& progress = util::ProgressCallback());
+
+	void Close();
+
+	//! 開いている動画ファイル名
+	const std::string& path() const{
+		return _path;
+	}
+
+	//! フレーム数
+	int num_frames() const{
+		return (int)_timestamps.size();
+	}
+
+	//! フレームの大きさ
+	const cv::Size& frame_size() const{
+		return _frame_size;
+	}
+
+	//! フレームの読み込み
+	/*!
+	\param[in] idx フレーム番号（0始まり）
+	\param[out] frame 読み込んだ画像（同じサイズであればバッファを再利用する）
+	\return 成否
+	*/
+	bool Read(int idx, cv::Mat& frame);
+
+	//! 動画ファイルの拡張子かどうか
+	static bool IsVideoFile(const std::string& filename);
+
+private:
+	std::string _path;	//!< 動画ファイル名
+	cv::VideoCapture _cap;	//!< デコーダ
+	std::vector<double> _timestamps;	//!< 各フレームのタイムスタンプ(ms)
+	cv::Size _frame_size;	//!< フレームの大きさ
+	int _next_frame;	//!< 次にデコードされるフレーム番号
+
+	/////// パラメータ /////////////
+	int _seek_interval;	//!< シーク位置の間隔（フレーム数）
+	int _max_forward;	//!< シークせずに読み進める最大フレーム数
+	///////////////////////////////////
+
+	//! フレーム表の作成
+	bool BuildIndex(const util::ProgressCallback& progress);
+
+	//! メモリ上のフレーム表の読み込み
+	bool LoadMemoryIndex();
+
+	//! フレーム表をメモリ上に保持
+	void StoreMemoryIndex() const;
+
+	//! フレーム表ファイルの読み込み
+	bool LoadIndex();
+
+	//! フレーム表ファイルの保存
+	bool SaveIndex() const;
+
+	//! フレーム表ファイル名
+	std::string IndexFileName() const;
+
+	//! idx番目のフレームの直前へ移動
+	bool Seek(int idx);
+};
+
+#endif
@@ -0,0 +1,382 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "WorkQueue.h"
+#include <boost/interprocess/sync/file_lock.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/interprocess/sync/sharable_lock.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#ifdef WIN32
+#include <process.h>
+#include <cstdlib>
+#else
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace{
+	const char* LEASE_HEADER = "#OMLEASE";
+	const int LEASE_VERSION = 2;
+
+	//! ロックファイルを開く（なければ作成）
+	std::string LockFileName(const std::string& lease_file)
+	{
+		std::string lock_file = lease_file + ".lock";
+		std::ofstream(lock_file, std::ios::app);
+		return lock_file;
+	}
+}
+
+
+WorkQueue::WorkQueue()
+{
+	_num_images = 0;
+	_chunk = -1;
+	_renewed = 0;
+
+	_chunk_size = 16;
+	_lease_timeout = 600;
+	_merged_file = "merged_annotation.txt";
+	_owner = DefaultWorkerId();
+}
+
+
+std::string WorkQueue::DefaultWorkerId()
+{
+	// 同じ設定ファイルで起動した作業者どうしも区別できるよう、ホスト名とプロセスIDを使う
+	std::ostringstream oss;
+#ifdef WIN32
+	const char* host = getenv("COMPUTERNAME");
+	oss << (host ? host : "localhost") << ":" << _getpid();
+#else
+	char host[256] = { 0 };
+	if (gethostname(host, sizeof(host) - 1) != 0)
+		strcpy(host, "localhost");
+	oss << host << ":" << getpid();
+#endif
+	return oss.str();
+}
+
+
+void WorkQueue::SetOutputFile(const std::string& output_file)
+{
+	std::string output = boost::filesystem::absolute(output_file).generic_string();
+	if (output != _output_file)
+		Release();
+	_output_file = output;
+}
+
+
+void WorkQueue::SetImageCount(int num_images)
+{
+	if (num_images != _num_images)
+		Release();
+	_num_images = num_images;
+}
+
+
+bool WorkQueue::LoadLeases(LeaseMap& leases) const
+{
+	leases.clear();
+	std::ifstream ifs(_lease_file);
+	if (!ifs.is_open())
+		return true;	// 最初の作業者
+
+	std::string line;
+	if (!std::getline(ifs, line))
+		return true;
+	std::istringstream header(line);
+	std::string tag;
+	int version = 0, num_images = 0, chunk_size = 0;
+	header >> tag >> version >> num_images >> chunk_size;
+	if (tag != LEASE_HEADER || version < 1 || version > LEASE_VERSION){
+		std::cerr << "Fail to read lease file " << _lease_file << "." << std::endl;
+		return false;
+	}
+	if (num_images != _num_images || chunk_size != _chunk_size){
+		// 他の作業者と画像一覧が異なると、同じ画像を重複して割り当ててしまう
+		std::cerr << "Lease file " << _lease_file << " is for " << num_images << " images in chunks of "
+			<< chunk_size << "." << std::endl;
+		return false;
+	}
+
+	while (std::getline(ifs, line)){
+		std::istringstream iss(line);
+		int chunk;
+		char state;
+		long long expire;
+		Lease lease;
+		if (!(iss >> chunk >> state >> expire))
+			continue;
+		iss >> std::ws;
+		std::getline(iss, lease.owner);
+		// 作業者名と出力ファイル名はタブ区切り（バージョン1は出力ファイル名のみ）
+		std::string::size_type tab = lease.owner.find('\t');
+		if (tab != std::string::npos){
+			lease.output = lease.owner.substr(tab + 1);
+			lease.owner.erase(tab);
+		}
+		else{
+			lease.output = lease.owner;
+		}
+		lease.done = (state == 'D');
+		lease.expire = (std::time_t)expire;
+		leases[chunk] = lease;
+	}
+	return true;
+}
+
+
+bool WorkQueue::SaveLeases(const LeaseMap& leases) const
+{
+	// 書き込み途中で異常終了してもリースファイルが壊れないよう、一時ファイルから置き換える
+	std::string tmp_file = _lease_file + ".tmp";
+	{
+		std::ofstream ofs(tmp_file, std::ios::trunc);
+		if (!ofs.is_open())
+			return false;
+		ofs << LEASE_HEADER << " " << LEASE_VERSION << " " << _num_images << " " << _chunk_size << "\n";
+		LeaseMap::const_iterator it = leases.begin();
+		for (; it != leases.end(); it++){
+			ofs << it->first << " " << (it->second.done ? 'D' : 'L') << " " << (long long)it->second.expire
+				<< " " << it->second.owner << "\t" << it->second.output << "\n";
+		}
+		ofs.flush();
+		if (!ofs.good())
+			return false;
+	}
+	boost::system::error_code ec;
+	boost::filesystem::rename(tmp_file, _lease_file, ec);
+	return !ec;
+}
+
+
+template<class Func> bool WorkQueue::Update(Func modify)
+{
+	try{
+		boost::interprocess::file_lock flock(LockFileName(_lease_file).c_str());
+		boost::interprocess::scoped_lock<boost::interprocess::file_lock> lock(flock);
+
+		LeaseMap leases;
+		if (!LoadLeases(leases))
+			return false;
+		if (!modify(leases))
+			return false;
+		if (!SaveLeases(leases)){
+			std::cerr << "Fail to write lease file " << _lease_file << "." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	catch (const boost::interprocess::interprocess_exception& e){
+		std::cerr << "Fail to lock " << _lease_file << ": " << e.what() << std::endl;
+		return false;
+	}
+}
+
+
+bool WorkQueue::Acquire(int& begin, int& end)
+{
+	if (!is_enabled() || _num_images <= 0)
+		return false;
+
+	int chunk = -1;
+	int num = num_chunks();
+	bool ret = Update([this, num, &chunk](LeaseMap& leases){
+		std::time_t now = std::time(NULL);
+		LeaseMap::iterator it;
+		if (_chunk >= 0){
+			// 期限切れで他の作業者に割り当てられていた場合は、その作業者に任せる
+			it = leases.find(_chunk);
+			if (it != leases.end() && it->second.owner == _owner)
+				it->second.done = true;
+		}
+		// 前回の起動時に終えられなかった自分のチャンクを優先
+		for (it = leases.begin(); it != leases.end(); it++){
+			if (!it->second.done && it->second.owner == _owner && it->first != _chunk && it->first < num){
+				chunk = it->first;
+				break;
+			}
+		}
+		for (int i = 0; chunk < 0 && i < num; i++){
+			it = leases.find(i);
+			// 未割り当て、または期限切れのチャンク
+			if (it == leases.end() || (!it->second.done && it->second.expire < now))
+				chunk = i;
+		}
+		if (chunk >= 0){
+			Lease lease;
+			lease.done = false;
+			lease.expire = now + _lease_timeout;
+			lease.owner = _owner;
+			lease.output = _output_file;
+			leases[chunk] = lease;
+		}
+		return true;
+	});
+
+	_chunk = -1;
+	if (!ret || chunk < 0)
+		return false;
+
+	_chunk = chunk;
+	_renewed = std::time(NULL);
+	begin = chunk * _chunk_size;
+	end = std::min(begin + _chunk_size, _num_images);
+	return true;
+}
+
+
+bool WorkQueue::Renew()
+{
+	if (_chunk < 0)
+		return false;
+	std::time_t now = std::time(NULL);
+	if (now - _renewed < _lease_timeout / 2)
+		return true;
+
+	bool lost = false;
+	bool ret = Update([this, now, &lost](LeaseMap& leases){
+		LeaseMap::iterator it = leases.find(_chunk);
+		if (it == leases.end() || it->second.owner != _owner){
+			lost = true;
+			return false;
+		}
+		it->second.expire = now + _lease_timeout;
+		return true;
+	});
+	if (lost)
+		_chunk = -1;
+	else if (ret)
+		_renewed = now;
+	return !lost;
+}
+
+
+void WorkQueue::Release()
+{
+	if (_chunk < 0)
+		return;
+
+	Update([this](LeaseMap& leases){
+		LeaseMap::iterator it = leases.find(_chunk);
+		if (it == leases.end() || it->second.owner != _owner || it->second.done)
+			return false;
+		leases.erase(it);
+		return true;
+	});
+	_chunk = -1;
+}
+
+
+bool WorkQueue::contains(int image_idx) const
+{
+	return _chunk >= 0 && image_idx >= _chunk * _chunk_size && image_idx < (_chunk + 1) * _chunk_size;
+}
+
+
+bool WorkQueue::GetCompletedOutputs(std::vector<std::string>& outputs) const
+{
+	outputs.clear();
+	if (!is_enabled())
+		return false;
+
+	LeaseMap leases;
+	try{
+		boost::interprocess::file_lock flock(LockFileName(_lease_file).c_str());
+		boost::interprocess::sharable_lock<boost::interprocess::file_lock> lock(flock);
+		if (!LoadLeases(leases))
+			return false;
+	}
+	catch (const boost::interprocess::interprocess_exception& e){
+		std::cerr << "Fail to lock " << _lease_file << ": " << e.what() << std::endl;
+		return false;
+	}
+
+	outputs.resize(num_chunks());
+	LeaseMap::const_iterator it = leases.begin();
+	for (; it != leases.end(); it++){
+		if (it->second.done && it->first >= 0 && it->first < outputs.size())
+			outputs[it->first] = it->second.output;
+	}
+	return true;
+}
+
+
+//! パラメータ読み込み
+void WorkQueue::Read(const cv::FileNode& fn)
+{
+	if (fn.empty())
+		return;
+
+	fn["lease_file"] >> _lease_file;
+	fn["worker_id"] >> _worker_id;
+	_owner = _worker_id.empty() ? DefaultWorkerId() : _worker_id;
+	if (!fn["merged_file"].empty())
+		fn["merged_file"] >> _merged_file;
+	if (!fn["chunk_size"].empty())
+		fn["chunk_size"] >> _chunk_size;
+	if (!fn["lease_timeout"].empty())
+		fn["lease_timeout"] >> _lease_timeout;
+	_chunk_size = std::max(1, _chunk_size);
+	_lease_timeout = std::max(10, _lease_timeout);
+}
+
+
+//! パラメータ書き込み
+void WorkQueue::Write(cv::FileStorage& fs, const std::string& node_name) const
+{
+	if (!node_name.empty())
+		fs << node_name;
+	fs << "{";
+	fs << "lease_file" << _lease_file;
+	fs << "worker_id" << _worker_id;
+	fs << "merged_file" << _merged_file;
+	fs << "chunk_size" << _chunk_size;
+	fs << "lease_timeout" << _lease_timeout;
+	fs << "}";
+}
+
+
+//! ステータスの表示
+void WorkQueue::PrintStatus() const{
+	if (!is_enabled())
+		return;
+	std::cout << "作業キュー： " << _lease_file << " (" << _chunk_size << "枚ずつ, 作業者 " << _owner << ")" << std::endl;
+	if (_chunk >= 0)
+		std::cout << "割り当て中の画像： " << _chunk * _chunk_size + 1 << " - "
+			<< std::min((_chunk + 1) * _chunk_size, _num_images) << std::endl;
+}
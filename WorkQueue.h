@@ -0,0 +1,179 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __WORK_QUEUE__
+#define __WORK_QUEUE__
+
+#include <opencv2/core/core.hpp>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+//! 複数の作業者での画像の分担
+/*!
+共有フォルダ上のリースファイルを介して、画像をchunk_size枚ずつのチャンクとして各作業者に割り当てる。
+リースファイルの読み書きはロックファイル（リースファイル名.lock）のアドバイザリロックで排他する。
+リースには期限があり、異常終了した作業者のチャンクは期限が切れると他の作業者に割り当てられる。
+作業者は設定した作業者名（未設定の場合はホスト名とプロセスID）で区別し、各リースに作業者の出力ファイルの絶対パスを記録する
+*/
+class WorkQueue
+{
+public:
+	WorkQueue();
+
+	//! 作業キューが有効かどうか
+	bool is_enabled() const{
+		return !_lease_file.empty();
+	}
+
+	//! 作業キューを無効にする（記録した操作の再生用）
+	void Disable(){
+		Release();
+		_lease_file.clear();
+	}
+
+	//! 作業者の出力ファイル名を設定
+	/*!
+	統合時に他の作業者から読めるよう、絶対パスにしてリースに記録する
+	*/
+	void SetOutputFile(const std::string& output_file);
+
+	//! 対象の画像数を設定（割り当て中のチャンクは破棄）
+	void SetImageCount(int num_images);
+
+	//! 未割り当てのチャンクを取得
+	/*!
+	割り当て中のチャンクがあれば完了として記録してから、次のチャンクを取得する。
+	前回の起動時に終えられなかった自分（同じ作業者名）のチャンクがあれば、そのチャンクを再開する
+	\param[out] begin チャンクの先頭の画像ID
+	\param[out] end チャンクの末尾の次の画像ID
+	\return 取得の成否（全てのチャンクが完了または割り当て済みの場合はfalse）
+	*/
+	bool Acquire(int& begin, int& end);
+
+	//! 割り当て中のチャンクのリース期限を延長
+	/*!
+	期限の半分が過ぎるまでは何もしない
+	\return 延長の成否（期限切れで他の作業者に割り当てられていた場合はfalse）
+	*/
+	bool Renew();
+
+	//! 割り当て中のチャンクを未完了のまま返却
+	/*!
+	終了時には返却せず、再起動した時に続きから作業できるようにする
+	*/
+	void Release();
+
+	//! 割り当て中のチャンクに含まれる画像かどうか
+	bool contains(int image_idx) const;
+
+	//! チャンクを割り当てられているかどうか
+	bool is_assigned() const{
+		return _chunk >= 0;
+	}
+
+	//! 完了したチャンクごとの出力ファイル名を取得
+	/*!
+	期限切れで割り当て直されたチャンクは、完了を記録した作業者の出力のみを使うためにチャンク単位で返す
+	\param[out] outputs チャンク番号ごとの、完了を記録した作業者の出力ファイル名（絶対パス、未完了のチャンクは空）
+	\return 成否（作業キューが無効、またはリースファイルを読めない場合はfalse）
+	*/
+	bool GetCompletedOutputs(std::vector<std::string>& outputs) const;
+
+	//! 1チャンクの画像数
+	int chunk_size() const{
+		return _chunk_size;
+	}
+
+	//! 統合したアノテーションの出力ファイル名
+	const std::string& merged_file() const{
+		return _merged_file;
+	}
+
+	//! パラメータ読み込み
+	void Read(const cv::FileNode& fn);
+
+	//! パラメータ書き込み
+	void Write(cv::FileStorage& fs, const std::string& node_name) const;
+
+	//! ステータスの表示
+	void PrintStatus() const;
+
+private:
+	//! チャンクのリース
+	struct Lease{
+		bool done;	//!< 完了したかどうか
+		std::time_t expire;	//!< リース期限
+		std::string owner;	//!< 作業者名
+		std::string output;	//!< 作業者の出力ファイル名（絶対パス）
+	};
+	typedef std::map<int, Lease> LeaseMap;
+
+	std::string _owner;	//!< 作業者名（<worker_id>、未設定の場合はホスト名とプロセスID）
+	std::string _output_file;	//!< 出力ファイル名（絶対パス）
+	int _num_images;	//!< 対象の画像数
+	int _chunk;	//!< 割り当て中のチャンク番号（なしは-1）
+	std::time_t _renewed;	//!< 直前にリースを延長した時刻
+
+	/////// パラメータ /////////////
+	std::string _lease_file;	//!< リースファイル名（空の場合は無効）
+	std::string _worker_id;	//!< 作業者名（空の場合はホスト名とプロセスID）
+	std::string _merged_file;	//!< 統合したアノテーションの出力ファイル名
+	int _chunk_size;	//!< 1チャンクの画像数
+	int _lease_timeout;	//!< リース期限（秒）
+	///////////////////////////////////
+
+	//! ロックを取得してリースを読み込み、変更して書き戻す
+	/*!
+	\param[in] modify リースを変更する関数。falseを返した場合は書き戻さない
+	\return 成否
+	*/
+	template<class Func> bool Update(Func modify);
+
+	//! リースファイルの読み込み（ロック取得後に呼ぶ）
+	bool LoadLeases(LeaseMap& leases) const;
+
+	//! リースファイルの書き込み（ロック取得後に呼ぶ）
+	bool SaveLeases(const LeaseMap& leases) const;
+
+	//! 設定がない場合の作業者名（ホスト名:プロセスID）
+	static std::string DefaultWorkerId();
+
+	//! チャンク数
+	int num_chunks() const{
+		return (_num_images + _chunk_size - 1) / _chunk_size;
+	}
+};
+
+#endif
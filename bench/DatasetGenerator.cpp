@@ -0,0 +1,103 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#include "DatasetGenerator.h"
+#include "util_cv_functions.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+bool GenerateDataset(const DatasetSpec& spec, std::vector<std::string>& files,
+	std::vector<std::vector<cv::Rect>>& rectlist, std::string& anno_file)
+{
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(spec.dir, ec);
+	if (ec){
+		std::cerr << "Fail to create directory " << spec.dir << "." << std::endl;
+		return false;
+	}
+
+	cv::RNG rng(spec.seed);
+	files.clear();
+	rectlist.assign(spec.num_images, std::vector<cv::Rect>());
+	int min_box = std::max(8, std::min(spec.image_size.width, spec.image_size.height) / 16);
+	int max_box = std::max(min_box + 1, std::min(spec.image_size.width, spec.image_size.height) / 3);
+
+	cv::Mat img(spec.image_size, CV_8UC3);
+	for (int i = 0; i < spec.num_images; i++){
+		std::ostringstream oss;
+		oss << spec.dir << "/img" << std::setw(6) << std::setfill('0') << i << ".jpg";
+		files.push_back(oss.str());
+
+		// 背景のノイズとマーカー位置の矩形
+		rng.fill(img, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(64));
+		for (int j = 0; j < spec.boxes_per_image; j++){
+			int w = rng.uniform(min_box, max_box);
+			int h = rng.uniform(min_box, max_box);
+			cv::Rect rect(rng.uniform(0, spec.image_size.width - w), rng.uniform(0, spec.image_size.height - h), w, h);
+			cv::rectangle(img, rect, cv::Scalar(rng.uniform(96, 256), rng.uniform(96, 256), rng.uniform(96, 256)), CV_FILLED);
+			rectlist[i].push_back(rect);
+		}
+		if (!cv::imwrite(files.back(), img)){
+			std::cerr << "Fail to write image " << files.back() << "." << std::endl;
+			return false;
+		}
+	}
+
+	// 修正を重ねた作業履歴として、ずらした位置から順に記録する
+	anno_file = spec.dir + "/annotation.txt";
+	std::remove(anno_file.c_str());
+	util::AddHeaderLine(anno_file);
+	ImageList file_list(files);
+	std::vector<int> indices;
+	for (int i = 0; i < spec.num_images; i++)
+		indices.push_back(i);
+	for (int k = spec.history - 1; k >= 0; k--){
+		std::vector<std::vector<cv::Rect>> shifted = rectlist;
+		for (int i = 0; i < shifted.size(); i++){
+			for (int j = 0; j < shifted[i].size(); j++){
+				shifted[i][j].x += k;
+				shifted[i][j].y += k;
+			}
+		}
+		if (!util::AddAnnotationLines(anno_file, file_list, indices, shifted)){
+			std::cerr << "Fail to write annotation file " << anno_file << "." << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
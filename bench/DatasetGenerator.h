@@ -0,0 +1,68 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+#ifndef __DATASET_GENERATOR__
+#define __DATASET_GENERATOR__
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+//! ベンチマーク用の合成データセットの仕様
+struct DatasetSpec
+{
+	std::string dir;	//!< 出力フォルダ
+	int num_images;	//!< 画像数
+	cv::Size image_size;	//!< 画像サイズ
+	int boxes_per_image;	//!< 1画像あたりのマーカー数
+	int history;	//!< アノテーションファイルへの記録回数（修正の繰り返しを模擬）
+	unsigned int seed;	//!< 乱数の種
+
+	DatasetSpec() : dir("bench_data"), num_images(200), image_size(1280, 720),
+		boxes_per_image(4), history(3), seed(12345){}
+};
+
+//! 合成データセットの作成
+/*!
+ランダムな背景にマーカー位置の矩形を描いた画像と、ObjectMarkerと同じ形式のアノテーションファイルを作成する。
+アノテーションファイルには各画像の行を位置をずらしてhistory回ずつ追記する（最後の記録が正解）
+\param[in] spec データセットの仕様
+\param[out] files 作成した画像ファイルへのパス
+\param[out] rectlist 各画像の最終的なマーカー
+\param[out] anno_file 作成したアノテーションファイル名
+\return 作成の成否
+*/
+bool GenerateDataset(const DatasetSpec& spec, std::vector<std::string>& files,
+	std::vector<std::vector<cv::Rect>>& rectlist, std::string& anno_file);
+
+#endif
@@ -0,0 +1,340 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  By downloading, copying, installing or using the software you agree to this license.
+//  If you do not agree to this license, do not download, install,
+//  copy or use the software.
+//
+//
+//                           License Agreement
+//
+// Copyright (C) 2014 Takuya MINAGAWA, 2006 Gunawan Herman, 2003 Florian Adolf.
+// Third party copyrights are property of their respective owners.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//M*/
+
+// ObjectMarkerの主要な処理のベンチマーク
+//
+// 合成データセットを作成して各処理の所要時間を計測し、結果をCSV形式で出力する。
+//   om_bench [--dir bench_data] [--images 200] [--width 1280] [--height 720]
+//            [--boxes 4] [--history 3] [--repeat 5] [--markers 1,10,100,1000]
+//            [--out results.csv] [--check]
+
+#include "DatasetGenerator.h"
+#include "ObjectMarker.h"
+#include "MarkerViewer.h"
+#include "util_cv_functions.h"
+#include "ReadCSVFile.hpp"
+#include "DisplayBackend.h"
+#include "ImageProbe.h"
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+namespace{
+
+	//! 1つのベンチマークの結果
+	struct BenchResult{
+		std::string name;
+		int items;	//!< 1回あたりの処理件数
+		std::vector<double> msec;	//!< 各回の所要時間
+	};
+
+	//! 処理をrepeat回実行して所要時間を記録
+	BenchResult Measure(const std::string& name, int items, int repeat, const std::function<void()>& func)
+	{
+		BenchResult result;
+		result.name = name;
+		result.items = items;
+		for (int i = 0; i < repeat; i++){
+			int64 start = cv::getTickCount();
+			func();
+			result.msec.push_back((cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency());
+		}
+		std::cerr << name << ": " << *std::min_element(result.msec.begin(), result.msec.end()) << " ms" << std::endl;
+		return result;
+	}
+
+	//! CSV形式で出力
+	void WriteResults(std::ostream& os, const DatasetSpec& spec, const std::vector<BenchResult>& results)
+	{
+		os << "benchmark,images,width,height,boxes,history,items,repeat,min_ms,median_ms,mean_ms,max_ms,items_per_sec" << std::endl;
+		for (int i = 0; i < results.size(); i++){
+			std::vector<double> msec = results[i].msec;
+			std::sort(msec.begin(), msec.end());
+			double sum = 0;
+			for (int j = 0; j < msec.size(); j++)
+				sum += msec[j];
+			double median = msec[msec.size() / 2];
+			os << results[i].name << "," << spec.num_images << "," << spec.image_size.width << "," << spec.image_size.height
+				<< "," << spec.boxes_per_image << "," << spec.history << "," << results[i].items << "," << msec.size()
+				<< "," << msec.front() << "," << median << "," << sum / msec.size() << "," << msec.back()
+				<< "," << (median > 0 ? results[i].items * 1000.0 / median : 0) << std::endl;
+		}
+	}
+
+	//! 表示画像の各画素が期待した色かどうか
+	/*!
+	\param[in] frame 表示された画像
+	\param[in] expected 期待する画像
+	\param[in] name 検査名
+	\return 全画素が一致したかどうか
+	*/
+	bool ComparePixels(const cv::Mat& frame, const cv::Mat& expected, const std::string& name)
+	{
+		if (frame.size() != expected.size() || frame.type() != expected.type()){
+			std::cerr << name << ": unexpected frame size." << std::endl;
+			return false;
+		}
+		cv::Mat diff;
+		cv::absdiff(frame, expected, diff);
+		int num_diff = cv::countNonZero(diff.reshape(1));
+		if (num_diff > 0){
+			std::cerr << name << ": " << num_diff << " pixels differ." << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	//! ウィンドウを開かずに描画し、画素単位で検査
+	bool CheckRendering()
+	{
+		const cv::Scalar red = CV_RGB(255, 0, 0);
+		cv::Mat img = cv::Mat::zeros(48, 64, CV_8UC3);
+		OffscreenBackend backend;
+		MarkerViewer viewer;
+		viewer.SetBackend(&backend);
+		viewer.Open(img, "check");
+		bool ok = true;
+
+		// 矩形のマーカーは幅1の赤枠で、内部と外部は元の画像のまま
+		std::vector<cv::Rect> markers(1, cv::Rect(10, 8, 20, 12));
+		viewer.LoadMarkers(markers, 0);
+		cv::Mat expected = img.clone();
+		cv::rectangle(expected, cv::Point(10, 8), cv::Point(30, 20), red, 1);
+		ok &= ComparePixels(backend.GetFrame(), expected, "marker");
+
+		// ドラッグ中は作成中の矩形も描画する
+		int frames = backend.frame_count();
+		backend.PostDrag(cv::Point(40, 30), cv::Point(50, 40), 4);
+		backend.WaitKey(0);
+		if (backend.frame_count() - frames != 5){
+			std::cerr << "drag: redrawn " << backend.frame_count() - frames << " times, expected 5." << std::endl;
+			ok = false;
+		}
+		cv::rectangle(expected, cv::Point(40, 30), cv::Point(50, 40), red, 1);
+		ok &= ComparePixels(backend.GetFrame(), expected, "drag");
+
+		// ボタンを離すとマーカーとして追加される
+		std::vector<cv::Rect> objects = viewer.GetMarkers();
+		if (objects.size() != 2 || objects[1] != cv::Rect(40, 30, 10, 10)){
+			std::cerr << "drag: marker was not added." << std::endl;
+			ok = false;
+		}
+
+		// 削除すると元の画素に戻る
+		viewer.DeleteMarker();
+		viewer.DeleteMarker();
+		ok &= ComparePixels(backend.GetFrame(), img, "delete");
+
+		std::cerr << "Rendering check " << (ok ? "passed." : "FAILED.") << std::endl;
+		return ok;
+	}
+
+	void PrintUsage()
+	{
+		std::cerr << "usage: om_bench [--dir bench_data] [--images 200] [--width 1280] [--height 720]" << std::endl;
+		std::cerr << "                [--boxes 4] [--history 3] [--repeat 5] [--markers 1,10,100,1000]" << std::endl;
+		std::cerr << "                [--out results.csv] [--check]" << std::endl;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	DatasetSpec spec;
+	int repeat = 5;
+	std::string out_file;
+	std::vector<int> marker_counts;
+	marker_counts.push_back(1);
+	marker_counts.push_back(10);
+	marker_counts.push_back(100);
+	marker_counts.push_back(1000);
+	for (int i = 1; i < argc; i++){
+		std::string arg = argv[i];
+		if (arg == "--check")
+			return CheckRendering() ? 0 : 1;
+		if (i + 1 >= argc){
+			PrintUsage();
+			return 1;
+		}
+		std::string value = argv[++i];
+		if (arg == "--dir")
+			spec.dir = value;
+		else if (arg == "--images")
+			spec.num_images = atoi(value.c_str());
+		else if (arg == "--width")
+			spec.image_size.width = atoi(value.c_str());
+		else if (arg == "--height")
+			spec.image_size.height = atoi(value.c_str());
+		else if (arg == "--boxes")
+			spec.boxes_per_image = atoi(value.c_str());
+		else if (arg == "--history")
+			spec.history = atoi(value.c_str());
+		else if (arg == "--repeat")
+			repeat = atoi(value.c_str());
+		else if (arg == "--out")
+			out_file = value;
+		else if (arg == "--markers"){
+			marker_counts.clear();
+			std::istringstream iss(value);
+			std::string token;
+			while (std::getline(iss, token, ','))
+				marker_counts.push_back(atoi(token.c_str()));
+		}
+		else{
+			PrintUsage();
+			return 1;
+		}
+	}
+	if (spec.num_images <= 0 || spec.image_size.area() <= 0 || spec.boxes_per_image < 0 || spec.history < 1 || repeat < 1){
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<std::string> files;
+	std::vector<std::vector<cv::Rect>> truth;
+	std::string anno_file;
+	std::cerr << "Generating " << spec.num_images << " images in " << spec.dir << std::endl;
+	if (!GenerateDataset(spec, files, truth, anno_file))
+		return 1;
+	ImageList file_list(files);
+	int num_lines = spec.num_images * spec.history;
+
+	std::vector<BenchResult> results;
+
+	// アノテーションファイルの読み込み
+	results.push_back(Measure("ReadCSVFile", num_lines, repeat, [&](){
+		std::vector<std::vector<std::string>> tokens;
+		std::vector<std::string> sep(1, " ");
+		util::ReadCSVFile(anno_file, tokens, sep);
+	}));
+
+	std::vector<std::string> loaded_files;
+	std::vector<std::vector<cv::Rect>> loaded_rects;
+	results.push_back(Measure("LoadAnnotationFile", num_lines, repeat, [&](){
+		util::LoadAnnotationFile(anno_file, loaded_files, loaded_rects);
+	}));
+
+	// 作業履歴から最新のアノテーションを画像一覧に対応付け
+	std::vector<std::vector<cv::Rect>> rectlist;
+	results.push_back(Measure("reorderAnnotation", num_lines, repeat, [&](){
+		rectlist = ObjectMarker::reorderAnnotation(loaded_files, loaded_rects, file_list);
+	}));
+	if (rectlist != truth){
+		std::cerr << "reorderAnnotation returned unexpected annotations." << std::endl;
+		return 1;
+	}
+
+	std::string export_file = spec.dir + "/export.txt";
+	results.push_back(Measure("SaveAnnotationFile", spec.num_images, repeat, [&](){
+		util::SaveAnnotationFile(export_file, file_list, rectlist);
+	}));
+
+	// 全画像の全マーカーを縮尺変換
+	std::vector<cv::Rect> all_rects;
+	for (int i = 0; i < rectlist.size(); i++)
+		all_rects.insert(all_rects.end(), rectlist[i].begin(), rectlist[i].end());
+	std::vector<cv::Rect> scaled;
+	results.push_back(Measure("RescaleRect", all_rects.size(), repeat, [&](){
+		for (int k = 0; k < 100; k++)
+			util::RescaleRect(all_rects, scaled, 0.5 + 0.01 * k);
+	}));
+	results.back().items *= 100;
+
+	// 画像サイズの取得（ヘッダのみとデコード）
+	std::vector<cv::Size> probed(files.size());
+	results.push_back(Measure("ReadImageSize", files.size(), repeat, [&](){
+		for (int i = 0; i < files.size(); i++)
+			ImageProbe::ReadSize(files[i], probed[i]);
+	}));
+	if (std::count(probed.begin(), probed.end(), spec.image_size) != files.size()){
+		std::cerr << "ReadImageSize returned unexpected sizes." << std::endl;
+		return 1;
+	}
+	results.push_back(Measure("DecodeImage", files.size(), repeat, [&](){
+		for (int i = 0; i < files.size(); i++)
+			probed[i] = cv::imread(files[i]).size();
+	}));
+
+	std::string crop_dir = spec.dir + "/crop";
+	boost::filesystem::create_directories(crop_dir);
+	results.push_back(Measure("CropAnnotatedImageRegions", all_rects.size(), repeat, [&](){
+		util::CropAnnotatedImageRegions(crop_dir, file_list, rectlist);
+	}));
+
+	// ウィンドウを開かずに、マーカー数を変えてドラッグ中の再描画を計測
+	OffscreenBackend backend;
+	MarkerViewer viewer;
+	viewer.SetBackend(&backend);
+	cv::Mat img = cv::imread(files[0]);
+	viewer.Open(img, "bench");
+	cv::RNG rng(spec.seed);
+	const int num_moves = 100;
+	for (int i = 0; i < marker_counts.size(); i++){
+		std::vector<cv::Rect> markers;
+		for (int j = 0; j < marker_counts[i]; j++){
+			int w = rng.uniform(8, std::max(9, img.cols / 4));
+			int h = rng.uniform(8, std::max(9, img.rows / 4));
+			markers.push_back(cv::Rect(rng.uniform(0, img.cols - w), rng.uniform(0, img.rows - h), w, h));
+		}
+		auto drag = [&](){
+			viewer.LoadMarkers(markers, 0);
+			backend.PostDrag(cv::Point(10, 10), cv::Point(img.cols / 2, img.rows / 2), num_moves);
+			backend.WaitKey(0);
+		};
+		// 1回の描画回数を数える（初回の確保もここで済ませる）
+		backend.ResetFrameCount();
+		drag();
+		std::ostringstream name;
+		name << "RedrawImage_" << marker_counts[i];
+		results.push_back(Measure(name.str(), backend.frame_count(), repeat, drag));
+	}
+	viewer.Close();
+
+	if (out_file.empty()){
+		WriteResults(std::cout, spec, results);
+	}
+	else{
+		std::ofstream ofs(out_file);
+		if (!ofs.is_open()){
+			std::cerr << "Fail to write results to " << out_file << "." << std::endl;
+			return 1;
+		}
+		WriteResults(ofs, spec, results);
+	}
+	return 0;
+}
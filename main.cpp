@@ -34,10 +34,48 @@
 #include "ObjectMarker.h"
 
 
+#include <iostream>
+
+
+//! 使い方:
+//!   ObjectMarker [config.xml] [--record session.log]
+//!   ObjectMarker [config.xml] --replay session.log [--report replay_report.txt]
+//!   ObjectMarker [config.xml] --validate [--repair repaired.txt]
 int main(int argc, char* argv[])
 {
-	std::string config_file = (argc > 1) ? argv[1] : "config.xml";
+	std::string config_file = "config.xml";
+	std::string record_file, replay_file;
+	std::string report_file = "replay_report.txt";
+	std::string repair_file;
+	bool validate = false;
+	for (int i = 1; i < argc; i++){
+		std::string arg = argv[i];
+		if (arg == "--record" && i + 1 < argc)
+			record_file = argv[++i];
+		else if (arg == "--replay" && i + 1 < argc)
+			replay_file = argv[++i];
+		else if (arg == "--report" && i + 1 < argc)
+			report_file = argv[++i];
+		else if (arg == "--validate")
+			validate = true;
+		else if (arg == "--repair" && i + 1 < argc)
+			repair_file = argv[++i];
+		else
+			config_file = arg;
+	}
+
 	ObjectMarker object_marker;
+	if (validate)
+		return object_marker.lint(config_file, repair_file);
+
+	if (!replay_file.empty()){
+		if (!object_marker.ReplaySession(replay_file, report_file))
+			return 1;
+	}
+	else if (!record_file.empty()){
+		if (!object_marker.RecordSession(record_file))
+			return 1;
+	}
 
 	object_marker.run(config_file);
 }
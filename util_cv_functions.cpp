@@ -34,8 +34,12 @@
 #include "util_cv_functions.h"
 #include "util_functions.h"
 #include "ReadCSVFile.hpp"
+#include "VideoSource.h"
+#include "LatencyProfiler.h"
 #include <time.h>
+#include <boost/filesystem/operations.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
 
 namespace util{
 
@@ -78,14 +82,19 @@ namespace util{
 
 
 
-	bool SaveAnnotationFile(const std::string& anno_file, const std::vector<std::string>& img_files, const std::vector<std::vector<cv::Rect>>& obj_rects, const std::string& sep)
+	bool SaveAnnotationFile(const std::string& anno_file, const ImageList& img_files, const std::vector<std::vector<cv::Rect>>& obj_rects, const std::string& sep,
+		const ProgressCallback& progress)
 	{
 		assert(img_files.size() == obj_rects.size());
+		LATENCY_SCOPE(STAGE_EXPORT);
 
-		std::ofstream ofs(anno_file);
+		// 中断や書き込みの失敗で前回のファイルを壊さないよう、一時ファイルに書き込んでから置き換える
+		std::string tmp_file = anno_file + ".tmp";
+		std::ofstream ofs(tmp_file);
 		if (!ofs.is_open())
 			return false;
 
+		boost::system::error_code ec;
 			int num = img_files.size();
 		for (int i = 0; i < num; i++){
 			ofs << img_files[i] << sep << obj_rects[i].size();
@@ -94,15 +103,30 @@ namespace util{
 				ofs << sep << rect.x << sep << rect.y << sep << rect.width << sep << rect.height;
 			}
 			ofs << std::endl;
+			if (!ReportProgress(progress, i + 1, num)){
+				ofs.close();
+				boost::filesystem::remove(tmp_file, ec);
+				return false;
+			}
 		}
 
+		ofs.close();
+		if (ofs.fail()){
+			boost::filesystem::remove(tmp_file, ec);
+			return false;
+		}
+		boost::filesystem::rename(tmp_file, anno_file, ec);
+		if (ec){
+			boost::filesystem::remove(tmp_file, ec);
+			return false;
+		}
 		return true;
 	}
 
 
 	bool AddHeaderLine(const std::string& anno_file)
 	{
-		// o̓t@CJ
+		// 出力ファイルを開く
 		std::ofstream ofs(anno_file, std::ios::app);
 		if (!ofs.is_open()){
 			return false;
@@ -123,7 +147,7 @@ namespace util{
 
 	bool AddAnnotationLine(const std::string& anno_file, const std::string& img_file, const std::vector<cv::Rect>& obj_rects, const std::string& sep)
 	{
-		// o̓t@CJ
+		// 出力ファイルを開く
 		std::ofstream ofs(anno_file, std::ios::app);
 		if (!ofs.is_open()){
 			return false;
@@ -139,15 +163,63 @@ namespace util{
 	}
 
 
-	//! Ame[Vꂽ摜̗̈؂ĕʃt@CƂĕۑ
-	void CropAnnotatedImageRegions(const std::string& dir_path, const std::vector<std::string>& imgpathlist, const std::vector<std::vector<cv::Rect>>& rectlist)
+	bool AddAnnotationLines(const std::string& anno_file, const ImageList& img_files, const std::vector<int>& indices,
+		const std::vector<std::vector<cv::Rect>>& obj_rects, const std::string& sep, const ProgressCallback& progress)
+	{
+		assert(indices.size() == obj_rects.size());
+
+		// 出力ファイルを開く
+		std::ofstream ofs(anno_file, std::ios::app);
+		if (!ofs.is_open()){
+			return false;
+		}
+
+		int num = indices.size();
+		for (int i = 0; i < num; i++){
+			ofs << img_files[indices[i]] << sep << obj_rects[i].size();
+			for (int j = 0; j < obj_rects[i].size(); j++){
+				cv::Rect rect = obj_rects[i][j];
+				ofs << sep << rect.x << sep << rect.y << sep << rect.width << sep << rect.height;
+			}
+			ofs << "\n";
+			if (!ReportProgress(progress, i + 1, num))
+				return false;
+		}
+		ofs.flush();
+		return ofs.good();
+	}
+
+
+	//! アノテーションをつけられた画像の領域を切り取って別ファイルとして保存
+	bool CropAnnotatedImageRegions(const std::string& dir_path, const ImageList& imgpathlist, const std::vector<std::vector<cv::Rect>>& rectlist,
+		const ProgressCallback& progress)
 	{
 		assert(imgpathlist.size() == rectlist.size());
 
+		VideoSource video;
 		int count = 0;
 		int num_img = imgpathlist.size();
 		for (int i = 0; i<num_img; i++){
-			cv::Mat img = cv::imread(imgpathlist[i]);
+			if (!ReportProgress(progress, i, num_img))
+				return false;
+
+			if (rectlist[i].empty())
+				continue;
+			LATENCY_SCOPE(STAGE_CROP);
+
+			// 動画フレームは開いた動画から順に読み込む
+			cv::Mat img;
+			std::string path = imgpathlist[i];
+			std::string video_file;
+			int frame;
+			if (ImageList::ParseVideoFrame(path, video_file, frame)){
+				if (video.path() != video_file && !video.Open(video_file))
+					continue;
+				video.Read(frame, img);
+			}
+			else{
+				img = cv::imread(path);
+			}
 			if (img.empty())
 				continue;
 
@@ -159,6 +231,7 @@ namespace util{
 				cv::imwrite(strstr.str(), img(rectlist[i][j]));
 			}
 		}
+		return true;
 	}
 
 	void RescaleRect(const cv::Rect& rect, cv::Rect& dst_rect, double scale)
@@ -181,4 +254,241 @@ namespace util{
 		}
 	}
 
+
+	double RectIoU(const cv::Rect& a, const cv::Rect& b)
+	{
+		double inter = (a & b).area();
+		double uni = (double)a.area() + b.area() - inter;
+		return (uni > 0) ? inter / uni : 0;
+	}
+
+
+	namespace{
+
+		//! 隣り合うキーフレームのマーカーの対応付け
+		/*!
+		IoUの大きい組から対応付け、重ならずに残ったものは並び順に対応付ける
+		\return aの各マーカーに対応するbのマーカー番号（対応なしは-1）
+		*/
+		std::vector<int> MatchMarkers(const std::vector<cv::Rect>& a, const std::vector<cv::Rect>& b)
+		{
+			std::vector<int> match(a.size(), -1);
+			std::vector<bool> used(b.size(), false);
+			while (true){
+				double best = 0;
+				int best_i = -1, best_j = -1;
+				for (size_t i = 0; i < a.size(); i++){
+					if (match[i] >= 0)
+						continue;
+					for (size_t j = 0; j < b.size(); j++){
+						if (used[j])
+							continue;
+						double iou = RectIoU(a[i], b[j]);
+						if (iou > best){
+							best = iou;
+							best_i = i;
+							best_j = j;
+						}
+					}
+				}
+				if (best_i < 0)
+					break;
+				match[best_i] = best_j;
+				used[best_j] = true;
+			}
+
+			size_t j = 0;
+			for (size_t i = 0; i < a.size(); i++){
+				if (match[i] >= 0)
+					continue;
+				while (j < b.size() && used[j])
+					j++;
+				if (j >= b.size())
+					break;
+				match[i] = j;
+				used[j] = true;
+			}
+			return match;
+		}
+
+
+		void RectToArray(const cv::Rect& rect, double v[4])
+		{
+			v[0] = rect.x;
+			v[1] = rect.y;
+			v[2] = rect.width;
+			v[3] = rect.height;
+		}
+
+
+		//! Catmull-Romスプライン（キーフレームの間隔が不均一な場合に対応）
+		double CatmullRom(double p0, double p1, double p2, double p3,
+			double t0, double t1, double t2, double t3, double t)
+		{
+			double m1 = (p2 - p0) / (t2 - t0) * (t2 - t1);
+			double m2 = (p3 - p1) / (t3 - t1) * (t2 - t1);
+			double s = (t - t1) / (t2 - t1);
+			double s2 = s * s, s3 = s2 * s;
+			return (2 * s3 - 3 * s2 + 1) * p1 + (s3 - 2 * s2 + s) * m1 + (-2 * s3 + 3 * s2) * p2 + (s3 - s2) * m2;
+		}
+	}
+
+
+	void InterpolateMarkers(std::vector<std::vector<cv::Rect>>& rectlist, int begin, int end, bool spline,
+		std::vector<int>& filled)
+	{
+		filled.clear();
+		begin = std::max(0, begin);
+		end = std::min((int)rectlist.size() - 1, end);
+
+		// キーフレームの列挙
+		std::vector<int> keys;
+		for (int i = begin; i <= end; i++){
+			if (!rectlist[i].empty())
+				keys.push_back(i);
+		}
+
+		int num_keys = keys.size();
+		for (int k = 0; k + 1 < num_keys; k++){
+			int k0 = keys[k], k1 = keys[k + 1];
+			if (k1 - k0 < 2)
+				continue;
+
+			// 補間中に書き換えないよう、キーフレームのマーカーを複製
+			const std::vector<cv::Rect> rects0 = rectlist[k0];
+			const std::vector<cv::Rect> rects1 = rectlist[k1];
+			std::vector<int> match = MatchMarkers(rects0, rects1);
+
+			// スプラインの場合は前後のキーフレームとも対応付け
+			std::vector<int> match_prev, match_next;
+			int kp = (k > 0) ? keys[k - 1] : -1;
+			int kn = (k + 2 < num_keys) ? keys[k + 2] : -1;
+			if (spline && kp >= 0)
+				match_prev = MatchMarkers(rects0, rectlist[kp]);
+			if (spline && kn >= 0)
+				match_next = MatchMarkers(rects1, rectlist[kn]);
+
+			for (int f = k0 + 1; f < k1; f++){
+				double t = (double)(f - k0) / (k1 - k0);
+				std::vector<cv::Rect> rects;
+				for (size_t i = 0; i < rects0.size(); i++){
+					if (match[i] < 0)
+						continue;
+					double v[4], p1[4], p2[4];
+					RectToArray(rects0[i], p1);
+					RectToArray(rects1[match[i]], p2);
+
+					bool has_prev = !match_prev.empty() && match_prev[i] >= 0;
+					bool has_next = !match_next.empty() && match_next[match[i]] >= 0;
+					if (spline && (has_prev || has_next)){
+						// 前後のキーフレームに対応がない場合は端点を延長
+						double p0[4], p3[4];
+						RectToArray(has_prev ? rectlist[kp][match_prev[i]] : rects0[i], p0);
+						RectToArray(has_next ? rectlist[kn][match_next[match[i]]] : rects1[match[i]], p3);
+						double t0 = has_prev ? kp : k0 - 1;
+						double t3 = has_next ? kn : k1 + 1;
+						for (int c = 0; c < 4; c++)
+							v[c] = CatmullRom(p0[c], p1[c], p2[c], p3[c], t0, k0, k1, t3, f);
+					}
+					else{
+						for (int c = 0; c < 4; c++)
+							v[c] = p1[c] + (p2[c] - p1[c]) * t;
+					}
+					cv::Rect rect(cvRound(v[0]), cvRound(v[1]), std::max(1, cvRound(v[2])), std::max(1, cvRound(v[3])));
+					rects.push_back(rect);
+				}
+				if (!rects.empty()){
+					rectlist[f] = rects;
+					filled.push_back(f);
+				}
+			}
+		}
+	}
+
+
+	namespace{
+
+		//! 勾配画像の列（または行）ごとの和が最大となる位置を探す
+		/*!
+		\param[in] grad 勾配の絶対値（CV_32F）
+		\param[in] column trueの場合は列、falseの場合は行を探す
+		\param[in] pos 現在の辺の位置
+		\param[in] band 探索範囲
+		\param[in] begin 辺に沿った和をとる範囲の先頭
+		\param[in] end 辺に沿った和をとる範囲の末尾（含まない）
+		\return エッジの位置（見つからない場合はpos）
+		*/
+		int FindEdge(const cv::Mat& grad, bool column, int pos, int band, int begin, int end)
+		{
+			int length = column ? grad.cols : grad.rows;
+			int span = column ? grad.rows : grad.cols;
+			begin = std::max(0, begin);
+			end = std::min(span, end);
+			if (end <= begin)
+				return pos;
+
+			// 1画素あたりの勾配がこれより弱い場合はエッジとみなさない
+			const double min_strength = 16.0;
+			double best_score = min_strength;
+			int best_pos = pos;
+			for (int p = std::max(0, pos - band); p <= std::min(length - 1, pos + band); p++){
+				double sum = 0;
+				for (int s = begin; s < end; s++)
+					sum += column ? grad.at<float>(s, p) : grad.at<float>(p, s);
+				// 元の位置から離れるほど割り引く
+				double score = sum / (end - begin) * (1.0 - 0.3 * std::abs(p - pos) / band);
+				if (score > best_score){
+					best_score = score;
+					best_pos = p;
+				}
+			}
+			return best_pos;
+		}
+	}
+
+
+	bool SnapRectToEdges(const cv::Mat& image, const cv::Rect& rect, int band, cv::Rect& dst_rect)
+	{
+		if (image.empty() || rect.width < 2 || rect.height < 2 || band < 1)
+			return false;
+
+		// 矩形の周囲band画素だけを解析
+		cv::Rect roi(rect.x - band, rect.y - band, rect.width + 2 * band, rect.height + 2 * band);
+		roi &= cv::Rect(0, 0, image.cols, image.rows);
+		if (roi.width < 3 || roi.height < 3)
+			return false;
+
+		cv::Mat gray;
+		if (image.channels() == 3)
+			cv::cvtColor(image(roi), gray, CV_BGR2GRAY);
+		else
+			gray = image(roi);
+		cv::Mat grad_x, grad_y;
+		cv::Sobel(gray, grad_x, CV_32F, 1, 0);
+		cv::Sobel(gray, grad_y, CV_32F, 0, 1);
+		grad_x = cv::abs(grad_x);
+		grad_y = cv::abs(grad_y);
+
+		// ROI上の座標に変換して各辺を探す
+		int left = rect.x - roi.x;
+		int top = rect.y - roi.y;
+		int right = left + rect.width;
+		int bottom = top + rect.height;
+		int new_left = FindEdge(grad_x, true, left, band, top, bottom);
+		int new_right = FindEdge(grad_x, true, right, band, top, bottom);
+		int new_top = FindEdge(grad_y, false, top, band, left, right);
+		int new_bottom = FindEdge(grad_y, false, bottom, band, left, right);
+		if (new_right <= new_left){
+			new_left = left;
+			new_right = right;
+		}
+		if (new_bottom <= new_top){
+			new_top = top;
+			new_bottom = bottom;
+		}
+
+		dst_rect = cv::Rect(new_left + roi.x, new_top + roi.y, new_right - new_left, new_bottom - new_top);
+		return true;
+	}
+
 }
\ No newline at end of file
@@ -35,62 +35,110 @@
 #define __UTIL_CV_FUNCTIONS__
 
 #include <opencv2/core/core.hpp>
+#include "util_functions.h"
+#include "ImageList.h"
 
 namespace util{
 	
-	//! Ame[Vt@C̓ǂݍ
+	//! アノテーションファイルの読み込み
 	/*!
-	opencv_createsamles.exeƓ`̃Ame[Vt@Cǂݏ
-	\param[in] gt_file Ame[Vt@C
-	\param[out] imgpathlist 摜t@Cւ̃pX
-	\param[out] rectlist e摜ɂꂽAme[ṼXg
-	\return ǂݍ݂̐
+	opencv_createsamles.exeと同形式のアノテーションファイル読み書き
+	\param[in] gt_file アノテーションファイル名
+	\param[out] imgpathlist 画像ファイルへのパス
+	\param[out] rectlist 各画像につけられたアノテーションのリスト
+	\return 読み込みの成否
 	*/
 	bool LoadAnnotationFile(const std::string& gt_file, std::vector<std::string>& imgpathlist, std::vector<std::vector<cv::Rect>>& rectlist);
 
-	//! Ame[Vt@C̕ۑ
+	//! アノテーションファイルの保存
 	/*!
-	opencv_createsamles.exeƓ`̃Ame[Vt@Cǂݏ
-	\param[in] anno_file Ame[Vt@C
-	\param[in] img_files 摜t@Cւ̃pX
-	\param[in] obj_rects e摜ɂꂽAme[ṼXg
-	\return ۑ̐
+	opencv_createsamles.exeと同形式のアノテーションファイル読み書き
+	\param[in] anno_file アノテーションファイル名
+	\param[in] img_files 画像ファイルへのパス
+	\param[in] obj_rects 各画像につけられたアノテーションのリスト
+	\param[in] progress 進捗通知関数
+	\return 保存の成否（中断や失敗の場合、既存のファイルはそのまま残る）
 	*/
-	bool SaveAnnotationFile(const std::string& anno_file, const std::vector<std::string>& img_files, const std::vector<std::vector<cv::Rect>>& obj_rects, const std::string& sep = " ");
+	bool SaveAnnotationFile(const std::string& anno_file, const ImageList& img_files, const std::vector<std::vector<cv::Rect>>& obj_rects, const std::string& sep = " ",
+		const ProgressCallback& progress = ProgressCallback());
 
-	//! Ame[Vt@CւPsǋL
+	//! アノテーションファイルへ１行追記
 	/*!
-	opencv_createsamles.exeƓ`̃Ame[Vt@Cǂݏ
-	\param[in] anno_file Ame[Vt@C
-	\param[in] img_file 摜t@Cւ̃pX
-	\param[in] obj_rects 摜ɂꂽAme[V
-	\return ۑ̐
+	opencv_createsamles.exeと同形式のアノテーションファイル読み書き
+	\param[in] anno_file アノテーションファイル名
+	\param[in] img_file 画像ファイルへのパス
+	\param[in] obj_rects 画像につけられたアノテーション
+	\return 保存の成否
 	*/
 	bool AddAnnotationLine(const std::string& anno_file, const std::string& img_file, const std::vector<cv::Rect>& obj_rects, const std::string& sep = " ");
 
-	//! Ame[Vt@Cփwb_
+	//! アノテーションファイルへ複数行を追記
 	/*!
-	\param[in] anno_file Ame[Vt@C
-	\return ۑ̐
+	\param[in] anno_file アノテーションファイル名
+	\param[in] img_files 画像ファイルへのパス
+	\param[in] indices 追記する画像ID
+	\param[in] obj_rects 各画像につけられたアノテーション（indicesと同じ順）
+	\param[in] progress 進捗通知関数
+	\return 保存の成否
+	*/
+	bool AddAnnotationLines(const std::string& anno_file, const ImageList& img_files, const std::vector<int>& indices,
+		const std::vector<std::vector<cv::Rect>>& obj_rects, const std::string& sep = " ",
+		const ProgressCallback& progress = ProgressCallback());
+
+	//! アノテーションファイルへヘッダを書き込み
+	/*!
+	\param[in] anno_file アノテーションファイル名
+	\return 保存の成否
 	*/
 	bool AddHeaderLine(const std::string& anno_file);
 
-	//! Ame[Vꂽ̈؂ĉ摜Ƃĕۑ
+	//! アノテーションがつけられた領域を切り取って画像として保存
 	/*!
-	\param[in] dir_path ۑfBNg
-	\param[in] imgpathlist 摜t@C̃Xg
-	\param[in] rectlist Ame[ṼXg
+	\param[in] dir_path 保存先ディレクトリ
+	\param[in] imgpathlist 画像ファイルのリスト
+	\param[in] rectlist アノテーションのリスト
+	\param[in] progress 進捗通知関数
+	\return 最後まで処理したかどうか（中断された場合はfalse）
 	*/
-	void CropAnnotatedImageRegions(const std::string& dir_path, const std::vector<std::string>& imgpathlist, const std::vector<std::vector<cv::Rect>>& rectlist);
+	bool CropAnnotatedImageRegions(const std::string& dir_path, const ImageList& imgpathlist, const std::vector<std::vector<cv::Rect>>& rectlist,
+		const ProgressCallback& progress = ProgressCallback());
 
-	//! `XP[
+	//! 矩形をリスケール
 	void RescaleRect(const cv::Rect& rect, cv::Rect& dst_rect, double scale);
 
-	//! `XP[
+	//! 矩形をリスケール
 	void RescaleRect(const std::vector<cv::Rect>& rects, std::vector<cv::Rect>& dst_rects, double scale);
 
 
-	//! `摜̈ƂԂĂ邩mF
+	//! 2つの矩形のIoU (Intersection over Union)
+	double RectIoU(const cv::Rect& a, const cv::Rect& b);
+
+	//! キーフレーム間のマーカー補間
+	/*!
+	範囲内でマーカーのついた画像をキーフレームとし、隣り合うキーフレームのマーカーをIoU、
+	重ならないものは並び順で対応付けて、間のマーカーのない画像を補間する。画像は読み込まない
+	\param[in,out] rectlist 各画像のアノテーション
+	\param[in] begin 範囲の先頭の画像ID
+	\param[in] end 範囲の末尾の画像ID（この画像を含む）
+	\param[in] spline trueの場合はCatmull-Romスプライン、falseの場合は線形補間
+	\param[out] filled 補間した画像ID
+	*/
+	void InterpolateMarkers(std::vector<std::vector<cv::Rect>>& rectlist, int begin, int end, bool spline,
+		std::vector<int>& filled);
+
+	//! 矩形の各辺を近くの強いエッジへ合わせる
+	/*!
+	矩形の各辺から前後band画素の範囲で、辺に沿った輝度勾配の和が最大となる位置を探す。
+	十分な強さのエッジが見つからない辺は動かさない
+	\param[in] image 画像
+	\param[in] rect 矩形
+	\param[in] band 探索範囲（画素数）
+	\param[out] dst_rect エッジに合わせた矩形
+	\return 成否（矩形が小さすぎる、または画像外の場合はfalse）
+	*/
+	bool SnapRectToEdges(const cv::Mat& image, const cv::Rect& rect, int band, cv::Rect& dst_rect);
+
+	//! 矩形が画像領域とかぶっているか確認
 	inline bool CheckRectOverlapSize(const cv::Rect& rect, const cv::Size& size){
 		return (rect.x < size.width && rect.y < size.height && rect.x + rect.width > 0 && rect.y + rect.height > 0);
 	};
@@ -35,13 +35,26 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <iostream>
+#include <cctype>
 
 namespace util{
 
+	namespace{
+		AnswerObserver answer_observer;
+	}
+
+
+	void SetAnswerObserver(const AnswerObserver& observer){
+		answer_observer = observer;
+	}
+
+
 	std::string AskQuestionGetString(const std::string& question){
 		std::cout << question;
 		std::string ans;
 		std::cin >> ans;
+		if (answer_observer)
+			answer_observer(ans);
 		return ans;
 	}
 
@@ -58,8 +71,46 @@ namespace util{
 	}
 
 
-	// fBNg摜t@Cꗗ擾
-	bool ReadImageFilesInDirectory(const std::string& img_dir, std::vector<std::string>& image_lists)
+	//! 自然順の比較（数字部分を数値として比較する）
+	bool NaturalLess(const std::string& a, const std::string& b)
+	{
+		size_t i = 0, j = 0;
+		size_t na = a.size(), nb = b.size();
+		while (i < na && j < nb){
+			unsigned char ca = a[i], cb = b[j];
+			if (isdigit(ca) && isdigit(cb)){
+				// 先頭の0を除いた桁数、続いて各桁で比較
+				size_t si = i, sj = j;
+				while (si < na && a[si] == '0') si++;
+				while (sj < nb && b[sj] == '0') sj++;
+				size_t ei = si, ej = sj;
+				while (ei < na && isdigit((unsigned char)a[ei])) ei++;
+				while (ej < nb && isdigit((unsigned char)b[ej])) ej++;
+				if (ei - si != ej - sj)
+					return (ei - si) < (ej - sj);
+				int cmp = a.compare(si, ei - si, b, sj, ej - sj);
+				if (cmp != 0)
+					return cmp < 0;
+				i = ei;
+				j = ej;
+			}
+			else{
+				int la = tolower(ca), lb = tolower(cb);
+				if (la != lb)
+					return la < lb;
+				i++;
+				j++;
+			}
+		}
+		if (i < na || j < nb)
+			return (na - i) < (nb - j);
+		return a < b;
+	}
+
+
+	// ディレクトリから画像ファイル名一覧を取得
+	bool ReadImageFilesInDirectory(const std::string& img_dir, std::vector<std::string>& image_lists,
+		const ProgressCallback& progress)
 	{
 		using namespace boost::filesystem;
 
@@ -74,6 +125,8 @@ namespace util{
 			std::string ext = file_p.extension().string();
 			if (ext == ".jpg" || ext == ".jpeg" || ext == ".JPG" || ext == ".JPEG" || ext == ".bmp" || ext == ".BMP" || ext == ".png" || ext == ".PNG"){
 				image_lists.push_back(file_p.string());
+				if (!ReportProgress(progress, image_lists.size(), 0))
+					return false;
 			}
 		}
 		return true;
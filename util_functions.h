@@ -36,13 +36,38 @@
 
 #include <string>
 #include <vector>
+#include <functional>
 
 namespace util{
 
 	inline int round(double a){ return (int)(a + 0.5);};
 
-	// fBNg摜t@Cꗗ擾
-	bool ReadImageFilesInDirectory(const std::string& img_dir, std::vector<std::string>& image_lists);
+	//! 進捗通知関数
+	/*!
+	引数は処理済みの数と全体の数（不明な場合は0）。falseを返すと処理を中断する
+	*/
+	typedef std::function<bool(int, int)> ProgressCallback;
+
+	//! 進捗を通知し、処理を継続してよいかを返す
+	inline bool ReportProgress(const ProgressCallback& progress, int done, int total){
+		return !progress || progress(done, total);
+	}
+
+	//! 自然順の比較（数字部分を数値として比較する）
+	/*!
+	例: "img2.jpg" < "img10.jpg"。大文字小文字を区別せずに比較し、同順の場合は文字列として比較する
+	*/
+	bool NaturalLess(const std::string& a, const std::string& b);
+
+	// ディレクトリから画像ファイル名一覧を取得
+	bool ReadImageFilesInDirectory(const std::string& img_dir, std::vector<std::string>& image_lists,
+		const ProgressCallback& progress = ProgressCallback());
+
+	//! 質問への回答を受け取る関数（操作の記録用）
+	typedef std::function<void(const std::string&)> AnswerObserver;
+
+	//! 質問への回答を受け取る関数を設定（空の場合は解除）
+	void SetAnswerObserver(const AnswerObserver& observer);
 
 	std::string AskQuestionGetString(const std::string& question);
 	int AskQuestionGetInt(const std::string& question);